@@ -0,0 +1,283 @@
+/**
+ * @file alarm_engine.c
+ * @brief On-device Threshold Alarms Implementation
+ *
+ * 평가는 재정렬 mutex 안에서 한 번에 하나씩 실행되므로 규칙 상태는 잠금 없이 갱신한다.
+ * 설정 변경은 플래그로 전달되어 다음 평가에서 반영·초기화된다 (mqtt_batch와 같은 방식).
+ * 전이 이벤트는 큐로 발행 태스크에 넘기며, 미연결 중 이벤트는 보관했다가 재연결 후 순서대로 발행한다.
+ */
+
+#include "alarm_engine.h"
+#include "mqtt_handler.h"
+#include "stats.h"
+#include "time_sync.h"
+#include "cJSON.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "Alarm";
+
+#define RETRY_MS            1000
+
+typedef enum {
+    ALARM_KIND_HIGH = 0,
+    ALARM_KIND_LOW,
+    ALARM_KIND_ROC,
+} alarm_kind_t;
+
+static const char *s_kind_names[] = { "high", "low", "roc" };
+
+typedef struct {
+    uint8_t index;
+    uint8_t kind;
+    uint8_t severity;
+    bool raised;
+    uint16_t sequence;
+    double value;
+    float limit;
+    int64_t capture_us;
+    int64_t detect_us;
+    char field[MAX_FIELD_NAME_LEN];
+} alarm_event_t;
+
+typedef struct {
+    uint8_t active;             // ALARM_CHECK_* 비트
+    bool has_last;
+    double last_value;
+    int64_t last_us;
+} rule_state_t;
+
+static alarm_config_t s_config = { .rule_count = 0, .qos = DEFAULT_MQTT_QOS };
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool s_config_changed = false;
+
+// 평가 상태 (재정렬 단계 전용)
+static alarm_config_t s_active_cfg = { .rule_count = 0, .qos = DEFAULT_MQTT_QOS };
+static rule_state_t s_state[ALARM_MAX_RULES];
+
+static QueueHandle_t s_queue = NULL;
+static alarm_event_t s_pending[ALARM_QUEUE_SIZE];     // 미연결 중 보관 (발행 태스크 전용)
+static uint8_t s_pending_count = 0;
+
+static stats_id_t s_stat_raised = STATS_INVALID_ID;
+static stats_id_t s_stat_lost = STATS_INVALID_ID;
+static stats_id_t s_stat_detect = STATS_INVALID_ID;
+static stats_id_t s_stat_publish = STATS_INVALID_ID;
+
+/*******************************************************************************
+ * Publisher Task
+ ******************************************************************************/
+static esp_err_t publish_event(const alarm_event_t *ev, uint8_t qos)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (!root) return ESP_ERR_NO_MEM;
+
+    cJSON_AddStringToObject(root, "field", ev->field);
+    cJSON_AddNumberToObject(root, "index", ev->index);
+    cJSON_AddStringToObject(root, "type", s_kind_names[ev->kind]);
+    cJSON_AddStringToObject(root, "state", ev->raised ? "raised" : "cleared");
+    cJSON_AddNumberToObject(root, "value", ev->value);
+    cJSON_AddNumberToObject(root, "limit", ev->limit);
+    cJSON_AddNumberToObject(root, "severity", ev->severity);
+    cJSON_AddNumberToObject(root, "sequence", ev->sequence);
+    cJSON_AddNumberToObject(root, "timestamp", time_sync_timestamp(ev->capture_us, NULL));
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json) return ESP_ERR_NO_MEM;
+
+    char topic[256];
+    mqtt_handler_build_topic(topic, sizeof(topic), "alarm");
+    esp_err_t ret = mqtt_handler_publish_topic(topic, json, strlen(json), qos, false);
+    free(json);
+
+    if (ret == ESP_OK) {
+        stats_set(s_stat_publish, (uint32_t)(esp_timer_get_time() - ev->detect_us));
+    }
+    return ret;
+}
+
+static void keep_pending(const alarm_event_t *ev)
+{
+    if (s_pending_count >= ALARM_QUEUE_SIZE) {
+        // 가장 오래된 전이를 버림 (이후 전이가 현재 상태를 나타냄)
+        memmove(&s_pending[0], &s_pending[1], sizeof(alarm_event_t) * (ALARM_QUEUE_SIZE - 1));
+        s_pending_count--;
+        stats_inc(s_stat_lost);
+    }
+    s_pending[s_pending_count++] = *ev;
+}
+
+static void alarm_task(void *arg)
+{
+    alarm_event_t ev;
+
+    while (1) {
+        TickType_t wait = s_pending_count > 0 ? pdMS_TO_TICKS(RETRY_MS) : portMAX_DELAY;
+        bool got = (xQueueReceive(s_queue, &ev, wait) == pdTRUE);
+        uint8_t qos = s_config.qos;
+
+        // 보관된 전이 먼저 (순서 유지)
+        uint8_t sent = 0;
+        while (sent < s_pending_count && mqtt_handler_is_connected()) {
+            if (publish_event(&s_pending[sent], qos) != ESP_OK) break;
+            sent++;
+        }
+        if (sent > 0) {
+            memmove(&s_pending[0], &s_pending[sent], sizeof(alarm_event_t) * (s_pending_count - sent));
+            s_pending_count -= sent;
+        }
+
+        if (!got) continue;
+
+        if (s_pending_count > 0 || publish_event(&ev, qos) != ESP_OK) {
+            keep_pending(&ev);
+        }
+    }
+}
+
+/*******************************************************************************
+ * Evaluation
+ ******************************************************************************/
+static void emit(const record_t *rec, const alarm_rule_t *rule, alarm_kind_t kind,
+                 bool raised, double value, float limit, int64_t detect_us)
+{
+    alarm_event_t ev = {
+        .index = rule->field,
+        .kind = kind,
+        .severity = rule->severity,
+        .raised = raised,
+        .sequence = rec->sequence,
+        .value = value,
+        .limit = limit,
+        .capture_us = rec->capture_us,
+        .detect_us = detect_us,
+    };
+    strncpy(ev.field, rec->fields[rule->field].name, sizeof(ev.field) - 1);
+
+    if (raised) stats_inc(s_stat_raised);
+    stats_set(s_stat_detect, (uint32_t)(detect_us - rec->capture_us));
+
+    if (!s_queue || xQueueSend(s_queue, &ev, 0) != pdTRUE) {
+        stats_inc(s_stat_lost);
+        ESP_LOGW(TAG, "Alarm queue full, %s %s dropped", ev.field, s_kind_names[kind]);
+    }
+}
+
+// 한계 비교 + 히스테리시스 - 상태가 바뀌면 true
+static bool update_limit(rule_state_t *st, uint8_t bit, bool over, bool back)
+{
+    if (!(st->active & bit) && over) {
+        st->active |= bit;
+        return true;
+    }
+    if ((st->active & bit) && back) {
+        st->active &= ~bit;
+        return true;
+    }
+    return false;
+}
+
+void alarm_evaluate(const record_t *rec)
+{
+    if (s_config_changed) {
+        portENTER_CRITICAL(&s_lock);
+        memcpy(&s_active_cfg, &s_config, sizeof(alarm_config_t));
+        s_config_changed = false;
+        portEXIT_CRITICAL(&s_lock);
+        memset(s_state, 0, sizeof(s_state));
+    }
+
+    if (s_active_cfg.rule_count == 0 || !rec || !rec->crc_valid) return;
+
+    int64_t now_us = esp_timer_get_time();
+
+    for (uint8_t r = 0; r < s_active_cfg.rule_count; r++) {
+        const alarm_rule_t *rule = &s_active_cfg.rules[r];
+        rule_state_t *st = &s_state[r];
+        if (rule->field >= rec->field_count) continue;
+
+        double v = rec->fields[rule->field].scaled_value;
+
+        if ((rule->checks & ALARM_CHECK_HIGH) &&
+            update_limit(st, ALARM_CHECK_HIGH, v > rule->high, v < rule->high - rule->hysteresis)) {
+            emit(rec, rule, ALARM_KIND_HIGH, st->active & ALARM_CHECK_HIGH, v, rule->high, now_us);
+        }
+
+        if ((rule->checks & ALARM_CHECK_LOW) &&
+            update_limit(st, ALARM_CHECK_LOW, v < rule->low, v > rule->low + rule->hysteresis)) {
+            emit(rec, rule, ALARM_KIND_LOW, st->active & ALARM_CHECK_LOW, v, rule->low, now_us);
+        }
+
+        if ((rule->checks & ALARM_CHECK_ROC) && st->has_last && rec->capture_us > st->last_us) {
+            double dt = (rec->capture_us - st->last_us) / 1000000.0;
+            double rate = fabs(v - st->last_value) / dt;
+            if (update_limit(st, ALARM_CHECK_ROC, rate > rule->roc, rate <= rule->roc)) {
+                emit(rec, rule, ALARM_KIND_ROC, st->active & ALARM_CHECK_ROC, rate, rule->roc, now_us);
+            }
+        }
+        st->has_last = true;
+        st->last_value = v;
+        st->last_us = rec->capture_us;
+    }
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+esp_err_t alarm_init(void)
+{
+    if (s_queue) return ESP_OK;
+
+    s_queue = xQueueCreate(ALARM_QUEUE_SIZE, sizeof(alarm_event_t));
+    if (!s_queue) return ESP_ERR_NO_MEM;
+
+    s_stat_raised = stats_register("alarm.raised", STATS_COUNTER);
+    s_stat_lost = stats_register("alarm.lost", STATS_COUNTER);
+    s_stat_detect = stats_register("alarm.detect_us", STATS_GAUGE);
+    s_stat_publish = stats_register("alarm.publish_us", STATS_GAUGE);
+
+    if (xTaskCreate(alarm_task, "alarm", TASK_STACK_ALARM, NULL,
+                    TASK_PRIORITY_ALARM, NULL) != pdPASS) {
+        vQueueDelete(s_queue);
+        s_queue = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void alarm_set_config(const alarm_config_t *config)
+{
+    alarm_config_t cfg = { .rule_count = 0, .qos = DEFAULT_MQTT_QOS };
+    if (config) {
+        memcpy(&cfg, config, sizeof(alarm_config_t));
+    }
+    if (cfg.rule_count > ALARM_MAX_RULES) cfg.rule_count = ALARM_MAX_RULES;
+    if (cfg.qos > 2) cfg.qos = DEFAULT_MQTT_QOS;
+
+    portENTER_CRITICAL(&s_lock);
+    memcpy(&s_config, &cfg, sizeof(alarm_config_t));
+    s_config_changed = true;
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "Config: %d rules, qos=%d", cfg.rule_count, cfg.qos);
+}
+
+const alarm_config_t* alarm_get_config(void)
+{
+    return &s_config;
+}
+
+void alarm_set_definition(const data_definition_t *def)
+{
+    // 필드 인덱스 의미가 바뀌므로 진행 중 상태를 버림
+    portENTER_CRITICAL(&s_lock);
+    s_config_changed = true;
+    portEXIT_CRITICAL(&s_lock);
+}
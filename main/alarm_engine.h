@@ -0,0 +1,58 @@
+/**
+ * @file alarm_engine.h
+ * @brief On-device Threshold Alarms
+ *
+ * 재정렬 단계에서 순서대로 방출되는 record마다 필드별 규칙(상/하한, 히스테리시스,
+ * 변화율)을 평가하고, 상태가 바뀌면 전용 태스크가 배치/중복억제를 거치지 않고
+ * {base}/alarm 토픽에 즉시 발행한다.
+ *
+ * 메시지:
+ *   {"field":"Pressure","index":2,"type":"high","state":"raised","value":12.5,
+ *    "limit":10,"severity":2,"sequence":1234,"timestamp":...}
+ *
+ * 지연 통계: alarm.detect_us (수신 → 판정), alarm.publish_us (판정 → 발행)
+ */
+
+#ifndef ALARM_ENGINE_H
+#define ALARM_ENGINE_H
+
+#include "protocol_def.h"
+#include "record_bus.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 발행 태스크 시작
+ * @return ESP_OK on success
+ */
+esp_err_t alarm_init(void);
+
+/**
+ * @brief 규칙 적용 (다음 평가에서 상태 초기화)
+ * @param config 설정 (NULL이면 규칙 없음)
+ */
+void alarm_set_config(const alarm_config_t *config);
+
+/**
+ * @brief 현재 설정 반환
+ */
+const alarm_config_t* alarm_get_config(void);
+
+/**
+ * @brief 데이터 정의 변경 알림 (필드 구성이 바뀌면 상태 초기화)
+ */
+void alarm_set_definition(const data_definition_t *def);
+
+/**
+ * @brief Record 평가 (재정렬 단계에서 순서대로 호출, 블록하지 않음)
+ */
+void alarm_evaluate(const record_t *rec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ALARM_ENGINE_H
@@ -0,0 +1,297 @@
+/**
+ * @file backfill.c
+ * @brief Reconnect Backfill Uploader Implementation
+ *
+ * 단절 구간 [from, to) 업로드 순서:
+ * 1. backfill/summary : 필드별 min/max 버킷 (버킷당 2개 값으로 peak 보존)
+ * 2. backfill/data    : 전체 해상도 행 (BACKFILL_MODE_FULL 일 때만)
+ *
+ * 모든 backfill 메시지는 config.rate (msg/s)로 속도 제한되며,
+ * 업로드 중 다시 단절되면 남은 구간은 다음 재연결 때 이어서 전송한다.
+ */
+
+#include "backfill.h"
+#include "sample_store.h"
+#include "data_parser.h"
+#include "mqtt_handler.h"
+#include "stats.h"
+#include "time_sync.h"
+#include "cJSON.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "Backfill";
+
+#define NOTIFY_CONNECTED        BIT0
+#define NOTIFY_DISCONNECTED     BIT1
+#define BACKFILL_DONE           UINT32_MAX
+
+static backfill_config_t s_config = {
+    .mode = DEFAULT_BACKFILL_MODE,
+    .buckets = DEFAULT_BACKFILL_BUCKETS,
+    .rate = DEFAULT_BACKFILL_RATE,
+};
+static TaskHandle_t s_task = NULL;
+static volatile bool s_connected = false;
+static stats_id_t s_stat_msgs = STATS_INVALID_ID;
+static stats_id_t s_stat_truncated = STATS_INVALID_ID;
+
+/*******************************************************************************
+ * Helpers
+ ******************************************************************************/
+static void pace(void)
+{
+    uint16_t rate = s_config.rate ? s_config.rate : DEFAULT_BACKFILL_RATE;
+    vTaskDelay(pdMS_TO_TICKS(1000 / rate));
+}
+
+static void add_identity(cJSON *root)
+{
+    const mqtt_config_data_t *cfg = mqtt_handler_get_config();
+    cJSON_AddStringToObject(root, "device_id", cfg->device_id);
+    if (strlen(cfg->user_id) > 0) {
+        cJSON_AddStringToObject(root, "user_id", cfg->user_id);
+    }
+}
+
+static esp_err_t publish_json(const char *suffix, cJSON *root)
+{
+    esp_err_t ret = ESP_FAIL;
+    char *json_str = cJSON_PrintUnformatted(root);
+    if (json_str) {
+        ret = mqtt_handler_publish(suffix, json_str, strlen(json_str),
+                                   mqtt_handler_get_config()->qos, false);
+        free(json_str);
+        if (ret == ESP_OK) stats_inc(s_stat_msgs);
+    }
+    return ret;
+}
+
+/*******************************************************************************
+ * Phase 1: min/max bucket summary
+ ******************************************************************************/
+static bool publish_summary(uint32_t from, uint32_t to, bool truncated)
+{
+    const data_definition_t *def = data_parser_get_definition();
+    uint8_t width = sample_store_width();
+    uint32_t rows = to - from;
+    uint32_t buckets = s_config.buckets ? s_config.buckets : DEFAULT_BACKFILL_BUCKETS;
+    if (buckets > rows) buckets = rows;
+
+    int64_t first_us = 0, last_us = 0;
+    sample_store_read(from, &first_us, NULL, NULL, 0);
+    sample_store_read(to - 1, &last_us, NULL, NULL, 0);
+
+    for (uint8_t f = 0; f < width; f++) {
+        if (!s_connected) return false;
+
+        cJSON *root = cJSON_CreateObject();
+        if (!root) return false;
+
+        char name[MAX_FIELD_NAME_LEN];
+        data_parser_get_field_name(def, f, name, sizeof(name));
+        if (name[0] == '\0') snprintf(name, sizeof(name), "Field%d", f);
+
+        add_identity(root);
+        cJSON_AddStringToObject(root, "field", name);
+        cJSON_AddNumberToObject(root, "from", time_sync_timestamp(first_us, NULL));
+        cJSON_AddNumberToObject(root, "to", time_sync_timestamp(last_us, NULL));
+        cJSON_AddNumberToObject(root, "samples", rows);
+        cJSON_AddBoolToObject(root, "truncated", truncated);
+
+        cJSON *t_arr = cJSON_CreateArray();
+        cJSON *min_arr = cJSON_CreateArray();
+        cJSON *max_arr = cJSON_CreateArray();
+
+        for (uint32_t b = 0; b < buckets; b++) {
+            uint32_t b_from = from + (uint32_t)(((uint64_t)rows * b) / buckets);
+            uint32_t b_to = from + (uint32_t)(((uint64_t)rows * (b + 1)) / buckets);
+            float vmin, vmax;
+            int64_t t_us;
+
+            if (sample_store_min_max(f, b_from, b_to, &vmin, &vmax) == 0 ||
+                !sample_store_read(b_from, &t_us, NULL, NULL, 0)) {
+                continue;   // ring이 해당 버킷을 덮어씀
+            }
+            cJSON_AddItemToArray(t_arr, cJSON_CreateNumber(time_sync_timestamp(t_us, NULL)));
+            cJSON_AddItemToArray(min_arr, cJSON_CreateNumber(vmin));
+            cJSON_AddItemToArray(max_arr, cJSON_CreateNumber(vmax));
+        }
+
+        cJSON_AddItemToObject(root, "t", t_arr);
+        cJSON_AddItemToObject(root, "min", min_arr);
+        cJSON_AddItemToObject(root, "max", max_arr);
+        cJSON_AddStringToObject(root, "schema_version", SCHEMA_VERSION_STRING);
+
+        esp_err_t ret = publish_json("backfill/summary", root);
+        cJSON_Delete(root);
+        if (ret != ESP_OK) return false;
+
+        pace();
+    }
+
+    ESP_LOGI(TAG, "Summary sent: %lu rows, %lu buckets, %d fields",
+             (unsigned long)rows, (unsigned long)buckets, width);
+    return true;
+}
+
+/*******************************************************************************
+ * Phase 2: full-resolution rows (throttled)
+ * @return BACKFILL_DONE, or the row index to resume from
+ ******************************************************************************/
+static uint32_t publish_full(uint32_t from, uint32_t to)
+{
+    const data_definition_t *def = data_parser_get_definition();
+    float values[MAX_FIELD_COUNT];
+
+    for (uint32_t i = from; (int32_t)(to - i) > 0; i++) {
+        if (!s_connected) return i;
+
+        int64_t t_us;
+        uint16_t seq;
+        if (!sample_store_read(i, &t_us, &seq, values, MAX_FIELD_COUNT)) {
+            continue;   // 이미 덮어쓴 행
+        }
+
+        cJSON *root = cJSON_CreateObject();
+        if (!root) return i;
+
+        add_identity(root);
+        cJSON_AddNumberToObject(root, "timestamp", time_sync_timestamp(t_us, NULL));
+        cJSON_AddNumberToObject(root, "sequence", seq);
+        cJSON_AddBoolToObject(root, "backfill", true);
+
+        cJSON *fields = cJSON_CreateObject();
+        uint8_t width = sample_store_width();
+        for (uint8_t f = 0; f < width; f++) {
+            char name[MAX_FIELD_NAME_LEN];
+            data_parser_get_field_name(def, f, name, sizeof(name));
+            if (name[0] == '\0') snprintf(name, sizeof(name), "Field%d", f);
+            cJSON_AddNumberToObject(fields, name, values[f]);
+        }
+        cJSON_AddItemToObject(root, "fields", fields);
+        cJSON_AddStringToObject(root, "schema_version", SCHEMA_VERSION_STRING);
+
+        esp_err_t ret = publish_json("backfill/data", root);
+        cJSON_Delete(root);
+        if (ret != ESP_OK) return i;
+
+        pace();
+    }
+
+    return BACKFILL_DONE;
+}
+
+/*******************************************************************************
+ * Backfill Run
+ * @return BACKFILL_DONE, or the row index to resume from after reconnect
+ ******************************************************************************/
+static uint32_t run_backfill(uint32_t from, uint32_t to)
+{
+    bool truncated = false;
+    uint32_t oldest = sample_store_oldest();
+    if ((int32_t)(from - oldest) < 0) {
+        from = oldest;
+        truncated = true;   // 단절이 ring 용량보다 길었음
+        stats_inc(s_stat_truncated);
+    }
+    if ((int32_t)(to - from) <= 0) return BACKFILL_DONE;
+
+    ESP_LOGI(TAG, "Backfill start: rows %lu..%lu (mode=%d%s)",
+             (unsigned long)from, (unsigned long)to, s_config.mode,
+             truncated ? ", truncated" : "");
+
+    if (!publish_summary(from, to, truncated)) {
+        ESP_LOGW(TAG, "Summary interrupted, will retry on reconnect");
+        return from;
+    }
+
+    if (s_config.mode == BACKFILL_MODE_FULL) {
+        uint32_t resume = publish_full(from, to);
+        if (resume != BACKFILL_DONE) {
+            ESP_LOGW(TAG, "Full upload interrupted at row %lu", (unsigned long)resume);
+            return resume;
+        }
+    }
+
+    ESP_LOGI(TAG, "Backfill complete");
+    return BACKFILL_DONE;
+}
+
+static void backfill_task(void *arg)
+{
+    // 부팅 직후는 미연결 상태 - 첫 연결 전 데이터도 backfill 대상
+    bool outage_open = true;
+    uint32_t outage_from = sample_store_head();
+
+    while (1) {
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+
+        if ((bits & NOTIFY_DISCONNECTED) && !outage_open) {
+            outage_open = true;
+            outage_from = sample_store_head();
+        }
+
+        if ((bits & NOTIFY_CONNECTED) && outage_open && s_connected) {
+            outage_open = false;
+            if (s_config.mode == BACKFILL_MODE_OFF) continue;
+
+            uint32_t resume = run_backfill(outage_from, sample_store_head());
+            if (resume != BACKFILL_DONE) {
+                outage_open = true;
+                outage_from = resume;
+            }
+        }
+    }
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+esp_err_t backfill_init(void)
+{
+    if (s_task) return ESP_OK;
+
+    s_stat_msgs = stats_register("backfill.messages", STATS_COUNTER);
+    s_stat_truncated = stats_register("backfill.truncated", STATS_COUNTER);
+
+    if (xTaskCreate(backfill_task, "backfill", TASK_STACK_BACKFILL,
+                    NULL, TASK_PRIORITY_BACKFILL, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create task");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Initialized (mode=%d, buckets=%d, rate=%d/s)",
+             s_config.mode, s_config.buckets, s_config.rate);
+    return ESP_OK;
+}
+
+void backfill_set_config(const backfill_config_t *config)
+{
+    if (config) {
+        memcpy(&s_config, config, sizeof(backfill_config_t));
+    } else {
+        s_config.mode = DEFAULT_BACKFILL_MODE;
+        s_config.buckets = DEFAULT_BACKFILL_BUCKETS;
+        s_config.rate = DEFAULT_BACKFILL_RATE;
+    }
+    if (s_config.mode > BACKFILL_MODE_FULL) s_config.mode = BACKFILL_MODE_OFF;
+    if (s_config.buckets == 0) s_config.buckets = DEFAULT_BACKFILL_BUCKETS;
+    if (s_config.rate == 0) s_config.rate = DEFAULT_BACKFILL_RATE;
+}
+
+const backfill_config_t* backfill_get_config(void)
+{
+    return &s_config;
+}
+
+void backfill_on_mqtt_state(bool connected)
+{
+    s_connected = connected;
+    if (s_task) {
+        xTaskNotify(s_task, connected ? NOTIFY_CONNECTED : NOTIFY_DISCONNECTED, eSetBits);
+    }
+}
@@ -0,0 +1,50 @@
+/**
+ * @file backfill.h
+ * @brief Reconnect Backfill Uploader
+ *
+ * MQTT 단절 기간 동안 sample_store에 쌓인 데이터를 재연결 후 업로드한다.
+ * 1) 필드별 min/max 버킷 요약 (peak 보존 다운샘플)을 먼저 전송해
+ *    대시보드가 빠르게 복구되도록 하고,
+ * 2) 설정 시 전체 해상도 데이터를 제한된 속도로 이어서 전송한다.
+ */
+
+#ifndef BACKFILL_H
+#define BACKFILL_H
+
+#include "protocol_def.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Backfill 초기화 (업로드 태스크 생성)
+ * @return ESP_OK on success
+ */
+esp_err_t backfill_init(void);
+
+/**
+ * @brief Backfill 설정 적용
+ * @param config 설정 (NULL이면 기본값)
+ */
+void backfill_set_config(const backfill_config_t *config);
+
+/**
+ * @brief 현재 backfill 설정 반환
+ */
+const backfill_config_t* backfill_get_config(void);
+
+/**
+ * @brief MQTT 연결 상태 변경 알림
+ *
+ * 단절 시 단절 시작 행을 기록하고, 재연결 시 그 구간의 업로드를 시작한다.
+ * @param connected true if connected
+ */
+void backfill_on_mqtt_state(bool connected);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BACKFILL_H
@@ -16,6 +16,7 @@
 #include "esp_gatt_common_api.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
 
@@ -105,6 +106,8 @@ static const uint16_t char_ccc_uuid = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
 
 // Characteristic properties
 static const uint8_t char_prop_write = ESP_GATT_CHAR_PROP_BIT_WRITE;
+// Command: v2 pipelining용 write without response 허용
+static const uint8_t char_prop_write_cmd = ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR;
 static const uint8_t char_prop_read_notify = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY;
 static const uint8_t char_prop_notify = ESP_GATT_CHAR_PROP_BIT_NOTIFY;
 
@@ -126,6 +129,11 @@ static ble_cmd_cb_t s_command_callback = NULL;
 static char s_device_name[32] = "RS232_MQTT_Bridge";
 static esp_bd_addr_t s_peer_bda;  // NEW: Store peer address for encryption
 
+// v2: 응답(ACK) 전인 SEQ (BTC 태스크에서 등록, executor 태스크에서 해제)
+static portMUX_TYPE s_seq_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_inflight[8];      // 256 SEQ bitmap
+static uint8_t s_inflight_count = 0;
+
 // Advertising parameters
 static esp_ble_adv_params_t adv_params = {
     .adv_int_min        = 0x20,
@@ -286,7 +294,7 @@ static const esp_gatts_attr_db_t gatt_db[IDX_NB] = {
     [IDX_CHAR_COMMAND] = {
         {ESP_GATT_AUTO_RSP},
         {ESP_UUID_LEN_16, (uint8_t*)&char_decl_uuid, ESP_GATT_PERM_READ,
-         sizeof(char_prop_write), sizeof(char_prop_write), (uint8_t*)&char_prop_write}
+         sizeof(char_prop_write_cmd), sizeof(char_prop_write_cmd), (uint8_t*)&char_prop_write_cmd}
     },
     [IDX_CHAR_COMMAND_VAL] = {
         {ESP_GATT_AUTO_RSP},
@@ -298,6 +306,143 @@ static const esp_gatts_attr_db_t gatt_db[IDX_NB] = {
 /*******************************************************************************
  * Packet Processing
  ******************************************************************************/
+// v2 SEQ 등록 (window 초과 또는 처리 중인 SEQ 재사용이면 false)
+static bool inflight_acquire(uint8_t seq)
+{
+    bool ok = false;
+    portENTER_CRITICAL(&s_seq_lock);
+    if (s_inflight_count < BLE_CMD_WINDOW &&
+        !(s_inflight[seq >> 5] & (1UL << (seq & 31)))) {
+        s_inflight[seq >> 5] |= (1UL << (seq & 31));
+        s_inflight_count++;
+        ok = true;
+    }
+    portEXIT_CRITICAL(&s_seq_lock);
+    return ok;
+}
+
+static void inflight_release(uint8_t seq)
+{
+    portENTER_CRITICAL(&s_seq_lock);
+    // 재연결 전 요청의 늦은 ACK는 이미 초기화됨
+    if (s_inflight[seq >> 5] & (1UL << (seq & 31))) {
+        s_inflight[seq >> 5] &= ~(1UL << (seq & 31));
+        s_inflight_count--;
+    }
+    portEXIT_CRITICAL(&s_seq_lock);
+}
+
+static void inflight_reset(void)
+{
+    portENTER_CRITICAL(&s_seq_lock);
+    memset(s_inflight, 0, sizeof(s_inflight));
+    s_inflight_count = 0;
+    portEXIT_CRITICAL(&s_seq_lock);
+}
+
+/**
+ * @brief 패킷 구성 후 indicate
+ *
+ * seq == BLE_SEQ_NONE: v1 [STX] [RSP] [LEN(2)] [data] [XOR] [ETX]
+ * 그 외:               v2 [STX_V2] [SEQ] [RSP] [LEN(2)] [data] [XOR] [ETX]
+ */
+static esp_err_t send_packet(int attr_idx, uint8_t rsp, uint16_t seq,
+                             const uint8_t *data, uint16_t len)
+{
+    if (!s_is_connected || s_gatts_if == ESP_GATT_IF_NONE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t *packet = malloc(len + PACKET_V2_HEADER_SIZE + PACKET_FOOTER_SIZE);
+    if (!packet) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint16_t offset = 0;
+    if (seq == BLE_SEQ_NONE) {
+        packet[offset++] = PACKET_STX;
+    } else {
+        packet[offset++] = PACKET_STX_V2;
+        packet[offset++] = (uint8_t)seq;
+    }
+    packet[offset++] = rsp;
+    packet[offset++] = len & 0xFF;
+    packet[offset++] = (len >> 8) & 0xFF;
+
+    if (len > 0) {
+        memcpy(&packet[offset], data, len);
+        offset += len;
+    }
+
+    // Simple checksum
+    uint8_t crc = 0;
+    for (int i = 1; i < offset; i++) {
+        crc ^= packet[i];
+    }
+    packet[offset++] = crc;
+    packet[offset++] = PACKET_ETX;
+
+    esp_err_t ret = esp_ble_gatts_send_indicate(s_gatts_if, s_conn_id,
+                                                 s_handle_table[attr_idx],
+                                                 offset, packet, false);
+    free(packet);
+    return ret;
+}
+
+// v2 프레임 오류 (명령은 실행되지 않음, window 차지 안 함)
+static void send_error(uint8_t cmd, uint8_t seq, uint8_t error)
+{
+    uint8_t payload[2] = { cmd, error };
+    send_packet(IDX_CHAR_STATUS_VAL, RSP_ERROR, seq, payload, sizeof(payload));
+}
+
+/**
+ * @brief v2 패킷 처리 - SEQ 기준으로 응답을 맞추므로 여러 명령을 ACK 대기 없이 보낼 수 있다
+ */
+static void process_v2_packet(const uint8_t *data, uint16_t len)
+{
+    if (len < PACKET_V2_HEADER_SIZE + PACKET_FOOTER_SIZE) {
+        ESP_LOGW(TAG, "v2 packet too short: %d bytes", len);
+        return;
+    }
+
+    uint8_t seq = data[1];
+    uint8_t cmd = data[2];
+    uint16_t payload_len = data[3] | (data[4] << 8);
+
+    if (payload_len + PACKET_V2_HEADER_SIZE + PACKET_FOOTER_SIZE != len ||
+        data[len - 1] != PACKET_ETX) {
+        ESP_LOGW(TAG, "v2 frame error: seq=%d, payload=%d, packet=%d", seq, payload_len, len);
+        send_error(cmd, seq, ERR_INVALID_PARAMETER);
+        return;
+    }
+
+    uint8_t crc = 0;
+    for (int i = 1; i < len - 2; i++) {
+        crc ^= data[i];
+    }
+    if (crc != data[len - 2]) {
+        ESP_LOGW(TAG, "v2 CRC error: seq=%d", seq);
+        send_error(cmd, seq, ERR_CRC_ERROR);
+        return;
+    }
+
+    if (!inflight_acquire(seq)) {
+        ESP_LOGW(TAG, "v2 busy: seq=%d (in flight %d)", seq, s_inflight_count);
+        uint8_t payload[2] = { cmd, RESULT_BUSY };
+        send_packet(IDX_CHAR_STATUS_VAL, RSP_ACK, seq, payload, sizeof(payload));
+        return;
+    }
+
+    ESP_LOGI(TAG, "CMD: 0x%02X, Seq: %d, Len: %d", cmd, seq, payload_len);
+
+    if (s_command_callback) {
+        s_command_callback(cmd, seq, &data[PACKET_V2_HEADER_SIZE], payload_len);
+    } else {
+        inflight_release(seq);
+    }
+}
+
 static void process_write_event(uint16_t handle, const uint8_t *data, uint16_t len)
 {
     ESP_LOGI(TAG, "Write event: handle=%d, len=%d", handle, len);
@@ -308,6 +453,11 @@ static void process_write_event(uint16_t handle, const uint8_t *data, uint16_t l
                  data[0], len > 1 ? data[1] : 0, len > 2 ? data[2] : 0, len > 3 ? data[3] : 0);
     }
     
+    if (len > 0 && data[0] == PACKET_STX_V2) {
+        process_v2_packet(data, len);
+        return;
+    }
+
     // Validate packet structure (minimum: STX + CMD + LEN(2) + CRC + ETX = 6 bytes)
     if (len < 6) {
         ESP_LOGW(TAG, "Packet too short: %d bytes (min 6)", len);
@@ -340,7 +490,7 @@ static void process_write_event(uint16_t handle, const uint8_t *data, uint16_t l
     // Call command handler callback
     if (s_command_callback) {
         ESP_LOGI(TAG, "Calling command callback...");
-        s_command_callback(cmd, payload, payload_len);
+        s_command_callback(cmd, BLE_SEQ_NONE, payload, payload_len);
         ESP_LOGI(TAG, "Command callback returned");
     } else {
         ESP_LOGW(TAG, "No command callback registered!");
@@ -484,6 +634,7 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
             s_conn_id = param->connect.conn_id;
             s_is_connected = true;
             s_is_encrypted = false;  // Reset encryption state
+            inflight_reset();
             memcpy(s_peer_bda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
             
             ESP_LOGI(TAG, "BLE connected, conn_id=%d", s_conn_id);
@@ -518,6 +669,7 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
             s_is_encrypted = false;
             s_conn_id = 0xFFFF;
             s_mtu = 23;
+            inflight_reset();
             ESP_LOGI(TAG, "BLE disconnected, reason=0x%x", param->disconnect.reason);
             esp_ble_gap_start_advertising(&adv_params);
             break;
@@ -694,8 +846,14 @@ void ble_service_set_callback(ble_cmd_cb_t callback)
     s_command_callback = callback;
 }
 
-esp_err_t ble_service_send_ack(uint8_t original_cmd, uint8_t result)
+esp_err_t ble_service_send_ack(uint8_t original_cmd, uint16_t seq, uint8_t result)
 {
+    if (seq != BLE_SEQ_NONE) {
+        inflight_release((uint8_t)seq);
+        uint8_t payload[2] = { original_cmd, result };
+        return send_packet(IDX_CHAR_STATUS_VAL, RSP_ACK, seq, payload, sizeof(payload));
+    }
+
     if (!s_is_connected || s_gatts_if == ESP_GATT_IF_NONE) {
         return ESP_ERR_INVALID_STATE;
     }
@@ -719,70 +877,32 @@ esp_err_t ble_service_send_ack(uint8_t original_cmd, uint8_t result)
 
 esp_err_t ble_service_notify_status(const device_status_t *status)
 {
-    if (!s_is_connected || s_gatts_if == ESP_GATT_IF_NONE) {
-        return ESP_ERR_INVALID_STATE;
-    }
-
-    // Build status notification packet
-    // v2.1: device_status_t increased to ~34 bytes, need larger buffer
-    uint8_t packet[64];  // Increased from 32 to 64 for v2.1
-    uint16_t offset = 0;
-
-    packet[offset++] = PACKET_STX;
-    packet[offset++] = RSP_STATUS;
-    packet[offset++] = sizeof(device_status_t);  // Low byte
-    packet[offset++] = 0;  // High byte
-
-    memcpy(&packet[offset], status, sizeof(device_status_t));
-    offset += sizeof(device_status_t);
+    return send_packet(IDX_CHAR_STATUS_VAL, RSP_STATUS, BLE_SEQ_NONE,
+                       (const uint8_t *)status, sizeof(device_status_t));
+}
 
-    // Simple checksum
-    uint8_t crc = 0;
-    for (int i = 1; i < offset; i++) {
-        crc ^= packet[i];
-    }
-    packet[offset++] = crc;
-    packet[offset++] = PACKET_ETX;
+static esp_err_t notify_data_packet(uint8_t rsp, const uint8_t *data, uint16_t len)
+{
+    return send_packet(IDX_CHAR_PARSED_DATA_VAL, rsp, BLE_SEQ_NONE, data, len);
+}
 
-    esp_ble_gatts_send_indicate(s_gatts_if, s_conn_id,
-                                 s_handle_table[IDX_CHAR_STATUS_VAL],
-                                 offset, packet, false);
-    return ESP_OK;
+esp_err_t ble_service_send_response(uint8_t rsp, uint16_t seq, const uint8_t *data, uint16_t len)
+{
+    int attr_idx = (rsp == RSP_STATUS) ? IDX_CHAR_STATUS_VAL : IDX_CHAR_PARSED_DATA_VAL;
+    return send_packet(attr_idx, rsp, seq, data, len);
 }
 
 esp_err_t ble_service_notify_parsed_data(const uint8_t *data, uint16_t len)
 {
-    if (!s_is_connected || s_gatts_if == ESP_GATT_IF_NONE) {
-        return ESP_ERR_INVALID_STATE;
-    }
-
-    // Build parsed data packet
-    uint16_t packet_len = len + 7;  // STX + CMD + LEN(2) + DATA + CRC + ETX
-    uint8_t *packet = malloc(packet_len);
-    if (!packet) {
-        return ESP_ERR_NO_MEM;
-    }
-
-    uint16_t offset = 0;
-    packet[offset++] = PACKET_STX;
-    packet[offset++] = RSP_DATA;
-    packet[offset++] = len & 0xFF;
-    packet[offset++] = (len >> 8) & 0xFF;
-    
-    memcpy(&packet[offset], data, len);
-    offset += len;
+    return notify_data_packet(RSP_DATA, data, len);
+}
 
-    // Simple checksum
-    uint8_t crc = 0;
-    for (int i = 1; i < offset; i++) {
-        crc ^= packet[i];
-    }
-    packet[offset++] = crc;
-    packet[offset++] = PACKET_ETX;
+esp_err_t ble_service_notify_monitor(const uint8_t *data, uint16_t len)
+{
+    return notify_data_packet(RSP_MONITOR, data, len);
+}
 
-    esp_err_t ret = esp_ble_gatts_send_indicate(s_gatts_if, s_conn_id,
-                                                 s_handle_table[IDX_CHAR_PARSED_DATA_VAL],
-                                                 offset, packet, false);
-    free(packet);
-    return ret;
+uint16_t ble_service_get_mtu(void)
+{
+    return s_mtu;
 }
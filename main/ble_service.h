@@ -15,7 +15,11 @@
 extern "C" {
 #endif
 
-typedef void (*ble_cmd_cb_t)(uint8_t cmd, const uint8_t *data, uint16_t len);
+/**
+ * @brief 명령 콜백
+ * @param seq v2 요청 SEQ (v1 요청은 BLE_SEQ_NONE) - ACK/응답에 그대로 전달
+ */
+typedef void (*ble_cmd_cb_t)(uint8_t cmd, uint16_t seq, const uint8_t *data, uint16_t len);
 
 /**
  * @brief BLE 서비스 초기화
@@ -55,10 +59,31 @@ esp_err_t ble_service_notify_parsed_data(const uint8_t *data, uint16_t len);
 // Alias for backward compatibility
 #define ble_service_notify_data ble_service_notify_parsed_data
 
+/**
+ * @brief 시리얼 모니터 chunk 알림 전송 (RSP_MONITOR, parsed data characteristic)
+ */
+esp_err_t ble_service_notify_monitor(const uint8_t *data, uint16_t len);
+
+/**
+ * @brief 협상된 ATT MTU (미연결 시 23)
+ */
+uint16_t ble_service_get_mtu(void);
+
 /**
  * @brief ACK 응답 전송 (Section 7.1)
+ *
+ * 명령마다 정확히 한 번 호출한다. v2 요청이면 SEQ를 담아 보내고 window를 반환한다.
+ * @param seq 요청 SEQ (BLE_SEQ_NONE = v1 형식)
+ */
+esp_err_t ble_service_send_ack(uint8_t cmd, uint16_t seq, uint8_t result);
+
+/**
+ * @brief 명령 응답 전송 (RSP_STATUS는 Status, 그 외는 Parsed Data characteristic)
+ *
+ * ACK 전에 보낸다. v1 요청이면 기존 notify와 같은 형식.
+ * @param seq 요청 SEQ (BLE_SEQ_NONE = v1 형식)
  */
-esp_err_t ble_service_send_ack(uint8_t cmd, uint8_t result);
+esp_err_t ble_service_send_response(uint8_t rsp, uint16_t seq, const uint8_t *data, uint16_t len);
 
 /**
  * @brief 명령 콜백 설정
@@ -8,6 +8,7 @@
  * S2-3: main.c 중복 파서 제거, 이 파일이 유일한 파싱 소스
  * P0-1: user_id, device_id, base_topic 파싱
  * P0-2: use_jwt 플래그 파싱
+ * BLE/MQTT 명령은 단일 executor 태스크에서 순차 처리
  */
 
 #include "cmd_handler.h"
@@ -18,11 +19,33 @@
 #include "uart_handler.h"
 #include "data_parser.h"
 #include "ble_service.h"
+#include "sample_store.h"
+#include "backfill.h"
+#include "frame_dedupe.h"
+#include "field_topics.h"
+#include "topic_router.h"
+#include "gateway.h"
+#include "mqtt_batch.h"
+#include "ota_handler.h"
+#include "stats.h"
+#include "serial_monitor.h"
+#include "flight_recorder.h"
+#include "alarm_engine.h"
+#include "rate_plan.h"
+#include "time_sync.h"
+#include "history_query.h"
+#include "crc_utils.h"
+#include "esp_heap_caps.h"
 #include "cJSON.h"
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "CMD_HANDLER";
@@ -32,7 +55,7 @@ extern wifi_config_data_t g_wifi_config;
 extern mqtt_config_data_t g_mqtt_config;
 extern uart_config_data_t g_uart_config;
 extern protocol_config_data_t g_protocol_config;
-extern data_definition_t g_data_definition;
+extern data_definition_t *g_data_definition;
 extern device_status_t g_device_status;
 
 /*******************************************************************************
@@ -220,7 +243,7 @@ esp_err_t cmd_parse_uart_config(const uint8_t *data, uint16_t len, uart_config_d
     config->data_bits = (data[4] == 7) ? 7 : 8;
     config->parity = (data[5] <= 2) ? data[5] : 0;
     config->stop_bits = (data[6] == 2) ? 2 : 1;
-    config->flow_control = (data[7] <= 2) ? data[7] : 0;
+    config->flow_control = (data[7] <= UART_FLOW_XON_XOFF) ? data[7] : UART_FLOW_NONE;
 
     ESP_LOGI(TAG, "UART config parsed: %lu-%d-%d-%d",
              (unsigned long)config->baudrate, config->data_bits,
@@ -293,35 +316,34 @@ esp_err_t cmd_parse_data_definition(const uint8_t *data, uint16_t len, data_defi
     
     ESP_LOGI(TAG, "Field count: %d, data_offset: %d", def->field_count, def->data_offset);
 
-    if (def->field_count > MAX_FIELD_COUNT) {
-        ESP_LOGE(TAG, "Too many fields: %d (max %d)", def->field_count, MAX_FIELD_COUNT);
-        return ESP_ERR_INVALID_ARG;
-    }
-    
     if (def->field_count == 0) {
         ESP_LOGW(TAG, "No fields defined");
         return ESP_OK;
     }
 
     uint16_t offset = 2;
-    uint16_t expected_size = 2 + (def->field_count * sizeof(field_definition_t));
+    uint16_t expected_size = 2 + (def->field_count * sizeof(field_definition_v1_t));
     
     ESP_LOGI(TAG, "Expected min size: %d, actual: %d, field_def_size: %d", 
-             expected_size, len, sizeof(field_definition_t));
+             expected_size, len, sizeof(field_definition_v1_t));
 
-    // Parse field definitions
+    // Parse field definitions (v1 고정 소수점 → 메모리 표현)
     for (uint8_t i = 0; i < def->field_count; i++) {
-        if (offset + sizeof(field_definition_t) > len) {
+        if (offset + sizeof(field_definition_v1_t) > len) {
             ESP_LOGE(TAG, "Buffer overflow at field %d: offset=%d, need=%d, have=%d",
-                     i, offset, sizeof(field_definition_t), len - offset);
+                     i, offset, sizeof(field_definition_v1_t), len - offset);
             def->field_count = i;  // Truncate to safely parsed fields
             break;
         }
-        memcpy(&def->fields[i], &data[offset], sizeof(field_definition_t));
+        field_definition_v1_t v1;
+        memcpy(&v1, &data[offset], sizeof(field_definition_v1_t));
+
+        field_definition_t *fd = &def->fields[i];
+        data_parser_field_from_v1(&v1, fd);
+
         ESP_LOGI(TAG, "  Field[%d]: type=0x%02X, offset=%d, scale=%d",
-                 i, def->fields[i].field_type, def->fields[i].start_offset,
-                 def->fields[i].scale_factor);
-        offset += sizeof(field_definition_t);
+                 i, fd->field_type, fd->start_offset, v1.scale_factor);
+        offset += sizeof(field_definition_v1_t);
     }
 
     // Parse field names
@@ -342,54 +364,633 @@ esp_err_t cmd_parse_data_definition(const uint8_t *data, uint16_t len, data_defi
 }
 
 /*******************************************************************************
- * WiFi Connect Task
+ * Data Definition v2 Parser (16-bit offset, float scale, compact name table)
  ******************************************************************************/
-static void wifi_connect_task(void *arg)
+static float read_f32_le(const uint8_t *p)
 {
-    wifi_config_data_t *config = (wifi_config_data_t *)arg;
-    wifi_manager_connect(config);
-    vTaskDelete(NULL);
+    uint32_t bits = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+esp_err_t cmd_parse_data_definition_v2(const uint8_t *data, uint16_t len, data_definition_t *def)
+{
+    if (!data || !def || len < DATA_DEF_V2_HEADER_SIZE + 4) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint16_t body_len = len - 4;
+    uint32_t crc = data[body_len] | (data[body_len + 1] << 8) |
+                   (data[body_len + 2] << 16) | ((uint32_t)data[body_len + 3] << 24);
+    if (crc_calc_crc32(data, body_len) != crc) {
+        ESP_LOGE(TAG, "Data definition v2 CRC mismatch");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    uint16_t field_count = data[1] | (data[2] << 8);
+    uint16_t names_len = data[5] | (data[6] << 8);
+    if (data[0] != DATA_DEF_V2_VERSION || field_count > MAX_FIELD_COUNT ||
+        names_len > MAX_FIELD_NAMES_SIZE) {
+        ESP_LOGE(TAG, "Bad v2 header: version=%d, fields=%d, names=%d",
+                 data[0], field_count, names_len);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(def, 0, sizeof(data_definition_t));
+    def->field_count = (uint8_t)field_count;
+    def->data_offset = data[3] | (data[4] << 8);
+
+    uint16_t offset = DATA_DEF_V2_HEADER_SIZE;
+    for (uint16_t i = 0; i < field_count; i++) {
+        if (offset + DATA_DEF_V2_FIELD_SIZE > body_len) return ESP_ERR_INVALID_ARG;
+
+        field_definition_t *fd = &def->fields[i];
+        uint8_t flags = data[offset + 1];
+        fd->field_type = data[offset];
+        fd->byte_order = (flags & DATA_DEF_FLAG_BIG_ENDIAN) ? 1 : 0;
+        fd->start_offset = data[offset + 2] | (data[offset + 3] << 8);
+        fd->bit_offset = data[offset + 4];
+        fd->bit_length = data[offset + 5];
+        fd->scale = 1.0f;
+        fd->offset = 0.0f;
+        offset += DATA_DEF_V2_FIELD_SIZE;
+
+        if (flags & DATA_DEF_FLAG_SCALE) {
+            if (offset + 4 > body_len) return ESP_ERR_INVALID_ARG;
+            fd->scale = read_f32_le(&data[offset]);
+            offset += 4;
+        }
+        if (flags & DATA_DEF_FLAG_OFFSET) {
+            if (offset + 4 > body_len) return ESP_ERR_INVALID_ARG;
+            fd->offset = read_f32_le(&data[offset]);
+            offset += 4;
+        }
+
+        // 프레임 내 위치는 16-bit (data_offset + start_offset + 크기가 넘치면 거부)
+        if ((uint32_t)def->data_offset + fd->start_offset + data_parser_field_size(fd) > UINT16_MAX) {
+            ESP_LOGE(TAG, "Field %d exceeds 16-bit frame range", i);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    if (offset + names_len != body_len) {
+        ESP_LOGE(TAG, "v2 names length mismatch: %d vs %d", names_len, body_len - offset);
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(def->field_names, &data[offset], names_len);
+    def->names_length = names_len;
+
+    // 이름 table은 필드 순서대로 NUL 구분 - 위치를 계산해 v1과 같은 표현으로
+    uint16_t pos = 0;
+    for (uint16_t i = 0; i < field_count; i++) {
+        field_definition_t *fd = &def->fields[i];
+        if (pos >= names_len) {
+            fd->name_index = names_len;     // 이름 없음 → "Field<i>"
+            continue;
+        }
+        uint16_t n = strnlen(&def->field_names[pos], names_len - pos);
+        fd->name_index = pos;
+        fd->name_length = (n < MAX_FIELD_NAME_LEN) ? n : MAX_FIELD_NAME_LEN - 1;
+        pos += n + 1;
+    }
+
+    ESP_LOGI(TAG, "Data definition v2 parsed: %d fields, data_offset=%d, names=%d bytes",
+             def->field_count, def->data_offset, def->names_length);
+    return ESP_OK;
 }
 
 /*******************************************************************************
- * MQTT Restart Task (non-blocking)
+ * Bulk Provisioning Bundle (CMD_PROVISION)
+ *
+ * [version(1)] [count(1)] {[section(1)] [len(2, LE)] [data]} x count [crc32(4, LE)]
+ * section = CMD_SET_WIFI..CMD_SET_DATA_DEF, crc32는 version부터 마지막 섹션까지.
  ******************************************************************************/
-static void mqtt_restart_task(void *arg)
+esp_err_t cmd_parse_provision_bundle(const uint8_t *data, uint16_t len, provision_bundle_t *bundle)
 {
-    mqtt_config_data_t *config = (mqtt_config_data_t *)arg;
-    
-    // Wait for WiFi connection if not connected
-    int retry = 0;
-    while (!wifi_manager_is_connected() && retry < 30) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        retry++;
+    if (!data || !bundle ||
+        len < PROVISION_HEADER_SIZE + PROVISION_SECTION_HDR_SIZE + PROVISION_CRC_SIZE) {
+        return ESP_ERR_INVALID_ARG;
     }
-    
+
+    uint16_t body_len = len - PROVISION_CRC_SIZE;
+    uint32_t crc = data[body_len] | (data[body_len + 1] << 8) |
+                   (data[body_len + 2] << 16) | ((uint32_t)data[body_len + 3] << 24);
+    if (crc_calc_crc32(data, body_len) != crc) {
+        ESP_LOGE(TAG, "Provision bundle CRC mismatch");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    if (data[0] != PROVISION_BUNDLE_VERSION) {
+        ESP_LOGE(TAG, "Unsupported bundle version: %d", data[0]);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t count = data[1];
+    if (count == 0) return ESP_ERR_INVALID_ARG;
+
+    memset(bundle, 0, sizeof(*bundle));
+    uint16_t offset = PROVISION_HEADER_SIZE;
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (offset + PROVISION_SECTION_HDR_SIZE > body_len) {
+            ESP_LOGE(TAG, "Bundle truncated at section %d", i);
+            return ESP_ERR_INVALID_ARG;
+        }
+        uint8_t section = data[offset];
+        uint16_t slen = data[offset + 1] | (data[offset + 2] << 8);
+        const uint8_t *sdata = &data[offset + PROVISION_SECTION_HDR_SIZE];
+        offset += PROVISION_SECTION_HDR_SIZE;
+
+        if (section < CMD_SET_WIFI || section > CMD_SET_DATA_DEF ||
+            (bundle->sections & PROVISION_SECTION_BIT(section))) {
+            ESP_LOGE(TAG, "Bad or duplicate section 0x%02X", section);
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (slen > body_len - offset) {
+            ESP_LOGE(TAG, "Section 0x%02X overruns bundle (%d bytes)", section, slen);
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        esp_err_t ret;
+        switch (section) {
+            case CMD_SET_WIFI:
+                ret = cmd_parse_wifi_config(sdata, slen, &bundle->wifi);
+                break;
+            case CMD_SET_MQTT:
+                ret = cmd_parse_mqtt_config(sdata, slen, &bundle->mqtt);
+                break;
+            case CMD_SET_UART:
+                ret = cmd_parse_uart_config(sdata, slen, &bundle->uart);
+                break;
+            case CMD_SET_PROTOCOL:
+                ret = cmd_parse_protocol_config(sdata, slen, &bundle->protocol);
+                break;
+            default:
+                ret = cmd_parse_data_definition(sdata, slen, &bundle->data_def);
+                // 개별 명령과 달리 잘린 정의는 적용하지 않음
+                if (ret == ESP_OK && slen > 0 && bundle->data_def.field_count != sdata[0]) {
+                    ret = ESP_ERR_INVALID_ARG;
+                }
+                break;
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Section 0x%02X invalid", section);
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        bundle->sections |= PROVISION_SECTION_BIT(section);
+        offset += slen;
+    }
+
+    if (offset != body_len) {
+        ESP_LOGE(TAG, "Trailing bytes in bundle: %d", body_len - offset);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ESP_LOGI(TAG, "Provision bundle parsed: %d sections (0x%02X)", count, bundle->sections);
+    return ESP_OK;
+}
+
+// 데이터 정의를 포함해 크므로 PSRAM 우선
+static provision_bundle_t* alloc_bundle(void)
+{
+    provision_bundle_t *bundle = heap_caps_malloc(sizeof(provision_bundle_t), MALLOC_CAP_SPIRAM);
+    return bundle ? bundle : malloc(sizeof(provision_bundle_t));
+}
+
+// 포함된 섹션을 개별 namespace에 저장
+static esp_err_t save_provision_sections(const provision_bundle_t *bundle)
+{
+    esp_err_t ret = ESP_OK;
+    esp_err_t err;
+
+    if (bundle->sections & PROVISION_SECTION_BIT(CMD_SET_DATA_DEF)) {
+        err = nvs_save_data_definition(&bundle->data_def);
+        if (err != ESP_OK) ret = err;
+    }
+    if (bundle->sections & PROVISION_SECTION_BIT(CMD_SET_PROTOCOL)) {
+        err = nvs_save_protocol_config(&bundle->protocol);
+        if (err != ESP_OK) ret = err;
+    }
+    if (bundle->sections & PROVISION_SECTION_BIT(CMD_SET_UART)) {
+        err = nvs_save_uart_config(&bundle->uart);
+        if (err != ESP_OK) ret = err;
+    }
+    if (bundle->sections & PROVISION_SECTION_BIT(CMD_SET_MQTT)) {
+        err = nvs_save_mqtt_config(&bundle->mqtt);
+        if (err != ESP_OK) ret = err;
+    }
+    if (bundle->sections & PROVISION_SECTION_BIT(CMD_SET_WIFI)) {
+        err = nvs_save_wifi_config(&bundle->wifi);
+        if (err != ESP_OK) ret = err;
+    }
+    return ret;
+}
+
+esp_err_t cmd_handler_recover_provisioning(void)
+{
+    uint8_t *raw = malloc(PACKET_MAX_PAYLOAD);
+    if (!raw) return ESP_ERR_NO_MEM;
+
+    size_t len = PACKET_MAX_PAYLOAD;
+    esp_err_t ret = nvs_load_provision_journal(raw, &len);
+    if (ret != ESP_OK) {
+        free(raw);
+        return (ret == ESP_ERR_NVS_NOT_FOUND) ? ESP_OK : ret;
+    }
+
+    ESP_LOGW(TAG, "Interrupted provisioning found, re-applying (%d bytes)", (int)len);
+
+    provision_bundle_t *bundle = alloc_bundle();
+    if (!bundle) {
+        free(raw);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ret = cmd_parse_provision_bundle(raw, (uint16_t)len, bundle);
+    if (ret == ESP_OK) {
+        ret = save_provision_sections(bundle);
+    }
+    // 저장에 성공했거나 bundle 자체가 손상됐으면 기록 제거 (다음 부팅에서 반복하지 않음)
+    if (ret == ESP_OK || ret == ESP_ERR_INVALID_ARG || ret == ESP_ERR_INVALID_CRC) {
+        nvs_clear_provision_journal();
+    }
+
+    free(bundle);
+    free(raw);
+    return ret;
+}
+
+/*******************************************************************************
+ * Command Executor
+ *
+ * BLE(BTC 태스크)와 MQTT(이벤트 태스크) 콜백은 명령을 복사해 큐에 넣기만 하고,
+ * NVS 저장 / UART·MQTT 재시작 / OTA 버전 확인 등 블로킹 처리는
+ * 단일 executor 태스크가 도착 순서대로 수행한다.
+ * - 큐에 쌓인 같은 종류의 BLE 설정 명령은 마지막 것만 적용
+ * - WiFi 재접속 / MQTT 재시작 작업은 큐에 최대 1개
+ * - 같은 request_id의 원격 명령 (QoS 1 재전송)은 1회만 실행
+ * - 원격 명령은 종류별 token bucket으로 제한, 멱등 명령(status/restart/reset)은
+ *   이미 대기 중이면 실행 1회로 합침
+ ******************************************************************************/
+typedef enum {
+    JOB_BLE = 0,
+    JOB_REMOTE,
+    JOB_WIFI_CONNECT,
+    JOB_MQTT_RESTART,
+} cmd_job_type_t;
+
+// 나중 명령이 앞선 명령을 대체하는 설정 종류
+typedef enum {
+    SLOT_NONE = -1,
+    SLOT_WIFI = 0,
+    SLOT_MQTT,
+    SLOT_UART,
+    SLOT_PROTOCOL,
+    SLOT_DATA_DEF,
+    SLOT_COUNT
+} cmd_slot_t;
+
+typedef struct {
+    uint8_t type;                   // cmd_job_type_t
+    uint8_t cmd;                    // BLE command code
+    uint16_t ble_seq;               // v2 요청 SEQ (BLE_SEQ_NONE = v1)
+    uint16_t len;
+    uint32_t seq;
+    mqtt_remote_command_t remote;
+    cJSON *payload;                 // 원격 payload 사본 (executor가 해제)
+    uint8_t data[];                 // BLE payload 사본
+} cmd_job_t;
+
+#define RECENT_REQUEST_IDS  8
+#define REMOTE_CMD_TYPES    (MQTT_CMD_QUERY_HISTORY + 1)
+
+// 원격 명령 종류별 token bucket (burst 개, refill_ms 마다 1개 충전)
+typedef struct {
+    uint8_t burst;
+    uint32_t refill_ms;
+} rate_limit_t;
+
+static const rate_limit_t s_rate_limits[REMOTE_CMD_TYPES] = {
+    [MQTT_CMD_UPDATE_CONFIG]  = { .burst = 3, .refill_ms = 5000 },   // NVS 쓰기 / UART 재시작
+    [MQTT_CMD_RESTART]        = { .burst = 1, .refill_ms = 60000 },
+    [MQTT_CMD_REQUEST_STATUS] = { .burst = 2, .refill_ms = 1000 },
+    [MQTT_CMD_START_MONITOR]  = { .burst = 4, .refill_ms = 1000 },
+    [MQTT_CMD_STOP_MONITOR]   = { .burst = 4, .refill_ms = 1000 },
+    [MQTT_CMD_FACTORY_RESET]  = { .burst = 1, .refill_ms = 60000 },
+    [MQTT_CMD_QUERY_HISTORY]  = { .burst = 2, .refill_ms = 10000 },  // PSRAM 스캔 + chunk 전송
+};
+
+// 대기 중 1회 실행으로 합칠 수 있는 멱등 명령
+#define REMOTE_IDEMPOTENT_MASK  ((1u << MQTT_CMD_REQUEST_STATUS) | \
+                                 (1u << MQTT_CMD_RESTART) | \
+                                 (1u << MQTT_CMD_FACTORY_RESET))
+
+static QueueHandle_t s_job_queue = NULL;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_seq = 0;
+static uint32_t s_latest_seq[SLOT_COUNT];
+static bool s_wifi_pending = false;
+static bool s_mqtt_pending = false;
+static char s_recent_ids[RECENT_REQUEST_IDS][37];
+static uint8_t s_recent_next = 0;
+static uint32_t s_tokens[REMOTE_CMD_TYPES];     // 1/1000 token 단위
+static int64_t s_refill_us[REMOTE_CMD_TYPES];
+static uint32_t s_remote_pending = 0;           // 큐에 있는 멱등 명령 비트
+static stats_id_t s_stat_dropped = STATS_INVALID_ID;
+static stats_id_t s_stat_coalesced = STATS_INVALID_ID;
+static stats_id_t s_stat_rate_limited = STATS_INVALID_ID;
+
+static cmd_slot_t slot_of(uint8_t cmd)
+{
+    switch (cmd) {
+        case CMD_SET_WIFI:      return SLOT_WIFI;
+        case CMD_SET_MQTT:      return SLOT_MQTT;
+        case CMD_SET_UART:      return SLOT_UART;
+        case CMD_SET_PROTOCOL:  return SLOT_PROTOCOL;
+        case CMD_SET_DATA_DEF:  return SLOT_DATA_DEF;
+        default:                return SLOT_NONE;
+    }
+}
+
+static bool enqueue_job(cmd_job_t *job)
+{
+    if (s_job_queue && xQueueSend(s_job_queue, &job, 0) == pdTRUE) {
+        return true;
+    }
+    stats_inc(s_stat_dropped);
+    return false;
+}
+
+/**
+ * @brief 원격 명령 token 소비 (s_lock 보유 상태에서 호출)
+ * @return true if allowed
+ */
+static bool take_token(uint8_t type)
+{
+    if (type >= REMOTE_CMD_TYPES || s_rate_limits[type].burst == 0) return true;
+
+    const rate_limit_t *rl = &s_rate_limits[type];
+    uint32_t cap = (uint32_t)rl->burst * 1000;
+    int64_t now_us = esp_timer_get_time();
+
+    if (s_refill_us[type] == 0) {
+        s_tokens[type] = cap;
+        s_refill_us[type] = now_us;
+    } else {
+        // 경과 us / refill ms = 충전된 1/1000 token 수
+        // 기준 시각은 충전한 만큼만 전진 (나머지 유지) - 충전 단위보다 촘촘한 호출도 누적됨
+        int64_t gained = (now_us - s_refill_us[type]) / rl->refill_ms;
+        if (gained >= cap - s_tokens[type]) {
+            s_tokens[type] = cap;
+            s_refill_us[type] = now_us;     // 가득 찬 동안의 시간은 적립하지 않음
+        } else {
+            s_tokens[type] += (uint32_t)gained;
+            s_refill_us[type] += gained * rl->refill_ms;
+        }
+    }
+
+    if (s_tokens[type] < 1000) return false;
+    s_tokens[type] -= 1000;
+    return true;
+}
+
+static void run_internal(cmd_job_type_t type)
+{
+    if (type == JOB_WIFI_CONNECT) {
+        portENTER_CRITICAL(&s_lock);
+        s_wifi_pending = false;
+        portEXIT_CRITICAL(&s_lock);
+        wifi_manager_connect(&g_wifi_config);
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_mqtt_pending = false;
+    portEXIT_CRITICAL(&s_lock);
+
+    // 미연결이면 WiFi 연결 이벤트에서 새 설정으로 시작됨
     if (wifi_manager_is_connected()) {
         mqtt_handler_stop();
         vTaskDelay(pdMS_TO_TICKS(500));
-        mqtt_handler_start(config);
+        mqtt_handler_start(&g_mqtt_config);
     }
-    
-    vTaskDelete(NULL);
+}
+
+/**
+ * @brief WiFi 재접속 / MQTT 재시작 예약 (executor 태스크에서만 호출)
+ *
+ * 이미 큐에 있으면 합치고, 큐가 가득 차면 즉시 실행한다.
+ */
+static void schedule_internal(cmd_job_type_t type)
+{
+    bool *pending = (type == JOB_WIFI_CONNECT) ? &s_wifi_pending : &s_mqtt_pending;
+
+    portENTER_CRITICAL(&s_lock);
+    bool queued = *pending;
+    *pending = true;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (queued) {
+        stats_inc(s_stat_coalesced);
+        return;
+    }
+
+    cmd_job_t *job = calloc(1, sizeof(cmd_job_t));
+    if (job) {
+        job->type = type;
+        if (enqueue_job(job)) return;
+        free(job);
+    }
+    run_internal(type);
 }
 
 /*******************************************************************************
- * Main Command Handler
+ * BLE Command Execution
  ******************************************************************************/
-void cmd_handler_process(cmd_code_t cmd, const uint8_t *data, uint16_t len)
+/**
+ * @brief 새 데이터 정의를 현재 정의로 적용 (저장은 호출자)
+ */
+static void bind_data_definition(const data_definition_t *def)
+{
+    memcpy(g_data_definition, def, sizeof(data_definition_t));
+    // Dynamic field definition update (특허 핵심 기능)
+    data_parser_set_definition(g_data_definition);
+    mqtt_handler_set_data_definition(g_data_definition);
+    // 필드 구성이 바뀌었으므로 이전 정의로 저장된 행은 backfill 대상에서 제외
+    sample_store_reset(g_data_definition->field_count);
+}
+
+/*
+ * v2 데이터 정의 chunk 재조립 (executor 태스크 전용)
+ * BLE 패킷 하나(512 bytes)보다 큰 정의를 [chunk_offset(2)] [total_len(2)] [bytes]로 나눠 받는다.
+ * chunk_offset 0이 새 전송을 시작하고, 순서가 어긋나면 전송 전체를 버린다.
+ */
+static uint8_t *s_def_chunks = NULL;        // PSRAM, 전송 중에만 할당
+static uint16_t s_def_total = 0;
+static uint16_t s_def_received = 0;
+
+static void reset_def_chunks(void)
+{
+    free(s_def_chunks);
+    s_def_chunks = NULL;
+    s_def_total = 0;
+    s_def_received = 0;
+}
+
+static esp_err_t receive_data_definition_v2(const uint8_t *data, uint16_t len)
+{
+    if (len < DATA_DEF_V2_CHUNK_HDR_SIZE) return ESP_ERR_INVALID_ARG;
+
+    uint16_t chunk_offset = data[0] | (data[1] << 8);
+    uint16_t total = data[2] | (data[3] << 8);
+    const uint8_t *chunk = &data[DATA_DEF_V2_CHUNK_HDR_SIZE];
+    uint16_t chunk_len = len - DATA_DEF_V2_CHUNK_HDR_SIZE;
+
+    if (chunk_offset == 0) {
+        reset_def_chunks();
+        if (total == 0 || total > DATA_DEF_V2_MAX_SIZE) return ESP_ERR_INVALID_ARG;
+        s_def_chunks = heap_caps_malloc(total, MALLOC_CAP_SPIRAM);
+        if (!s_def_chunks) s_def_chunks = malloc(total);
+        if (!s_def_chunks) return ESP_ERR_NO_MEM;
+        s_def_total = total;
+    }
+
+    if (!s_def_chunks || total != s_def_total || chunk_offset != s_def_received ||
+        chunk_len > s_def_total - s_def_received) {
+        ESP_LOGE(TAG, "Data definition chunk out of order: offset=%d, expected=%d",
+                 chunk_offset, s_def_received);
+        reset_def_chunks();
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memcpy(&s_def_chunks[s_def_received], chunk, chunk_len);
+    s_def_received += chunk_len;
+    if (s_def_received < s_def_total) {
+        return ESP_OK;      // 다음 chunk 대기
+    }
+
+    data_definition_t *def = data_parser_alloc_definition();
+    esp_err_t ret = def ? cmd_parse_data_definition_v2(s_def_chunks, s_def_total, def)
+                        : ESP_ERR_NO_MEM;
+    reset_def_chunks();
+
+    // 저장 실패 시 적용하지 않음 (재부팅 후 정의가 달라지지 않게) → RESULT_FAILED
+    if (ret == ESP_OK) {
+        ret = nvs_save_data_definition(def);
+    }
+    if (ret == ESP_OK) {
+        bind_data_definition(def);
+    }
+    free(def);
+    return (ret == ESP_ERR_INVALID_CRC) ? ESP_ERR_INVALID_ARG : ret;
+}
+
+/**
+ * @brief 일괄 설정 적용 (executor 태스크)
+ *
+ * 전체 검증 → journal 기록(단일 commit) → 섹션별 저장 → journal 제거 후,
+ * 데이터 정의 → 프로토콜/UART → MQTT/WiFi 순서로 한 번씩만 재구성한다.
+ */
+static esp_err_t apply_provision_bundle(const uint8_t *data, uint16_t len)
+{
+    provision_bundle_t *bundle = alloc_bundle();
+    if (!bundle) return ESP_ERR_NO_MEM;
+
+    esp_err_t ret = cmd_parse_provision_bundle(data, len, bundle);
+    if (ret != ESP_OK) {
+        free(bundle);
+        return (ret == ESP_ERR_INVALID_CRC) ? ESP_ERR_INVALID_ARG : ret;
+    }
+
+    // journal이 commit되면 이후 전원이 꺼져도 부팅 시 전체가 저장됨
+    ret = nvs_save_provision_journal(data, len);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Provision journal write failed: %s", esp_err_to_name(ret));
+        free(bundle);
+        return ret;
+    }
+    ret = save_provision_sections(bundle);
+    if (ret != ESP_OK) {
+        // journal 유지 - 다음 부팅에서 다시 저장
+        ESP_LOGE(TAG, "Provision save failed: %s", esp_err_to_name(ret));
+        free(bundle);
+        return ret;
+    }
+    nvs_clear_provision_journal();
+
+    uint8_t sections = bundle->sections;
+
+    if (sections & PROVISION_SECTION_BIT(CMD_SET_DATA_DEF)) {
+        bind_data_definition(&bundle->data_def);
+    }
+    if (sections & PROVISION_SECTION_BIT(CMD_SET_PROTOCOL)) {
+        memcpy(&g_protocol_config, &bundle->protocol, sizeof(protocol_config_data_t));
+    }
+    if (sections & PROVISION_SECTION_BIT(CMD_SET_UART)) {
+        memcpy(&g_uart_config, &bundle->uart, sizeof(uart_config_data_t));
+        uart_handler_stop();
+        uart_handler_start(&g_uart_config, &g_protocol_config);
+    } else if (sections & PROVISION_SECTION_BIT(CMD_SET_PROTOCOL)) {
+        uart_handler_update_protocol(&g_protocol_config);
+    }
+    if (sections & PROVISION_SECTION_BIT(CMD_SET_MQTT)) {
+        memcpy(&g_mqtt_config, &bundle->mqtt, sizeof(mqtt_config_data_t));
+    }
+    if (sections & PROVISION_SECTION_BIT(CMD_SET_WIFI)) {
+        memcpy(&g_wifi_config, &bundle->wifi, sizeof(wifi_config_data_t));
+        // 연결 이벤트에서 새 MQTT 설정으로 시작됨
+        schedule_internal(JOB_WIFI_CONNECT);
+    } else if (sections & PROVISION_SECTION_BIT(CMD_SET_MQTT)) {
+        schedule_internal(JOB_MQTT_RESTART);
+    }
+
+    ESP_LOGI(TAG, "Provisioning applied (sections=0x%02X)", sections);
+    free(bundle);
+    return ESP_OK;
+}
+
+static void execute_ble_command(cmd_code_t cmd, uint16_t seq, const uint8_t *data, uint16_t len)
 {
     esp_err_t ret = ESP_OK;
     result_code_t result = RESULT_SUCCESS;
 
-    ESP_LOGI(TAG, "Processing command: 0x%02X (len=%d)", cmd, len);
+    ESP_LOGI(TAG, "Processing command: 0x%02X (seq=%d, len=%d)", cmd, seq, len);
 
     switch (cmd) {
+        case CMD_OTA_CHECK:
+            ota_handler_check_version();
+            break;
+
+        case CMD_OTA_START:
+            ota_handler_start();
+            break;
+
+        case CMD_OTA_ABORT:
+            ota_handler_abort();
+            break;
+
+        case CMD_OTA_ROLLBACK:
+            ota_handler_rollback();
+            break;
+
+        case CMD_OTA_GET_VERSION: {
+            const ota_version_info_t *vi = ota_handler_get_version_info();
+            uint8_t vd[64];
+            int vl = snprintf((char*)vd, sizeof(vd),
+                "{\"current\":\"%s\",\"latest\":\"%s\",\"update\":%s}",
+                vi->current_version, vi->latest_version,
+                vi->update_available ? "true" : "false");
+            ble_service_send_response(RSP_DATA, seq, vd, vl);
+            break;
+        }
+
         case CMD_SET_WIFI:
             ret = cmd_parse_wifi_config(data, len, &g_wifi_config);
             if (ret == ESP_OK) {
                 nvs_save_wifi_config(&g_wifi_config);
-                xTaskCreate(wifi_connect_task, "wifi_conn", 4096, &g_wifi_config, 3, NULL);
+                schedule_internal(JOB_WIFI_CONNECT);
             }
             break;
 
@@ -397,8 +998,8 @@ void cmd_handler_process(cmd_code_t cmd, const uint8_t *data, uint16_t len)
             ret = cmd_parse_mqtt_config(data, len, &g_mqtt_config);
             if (ret == ESP_OK) {
                 nvs_save_mqtt_config(&g_mqtt_config);
-                // Non-blocking MQTT restart
-                xTaskCreate(mqtt_restart_task, "mqtt_restart", 4096, &g_mqtt_config, 3, NULL);
+                // WiFi 재접속이 대기 중이면 그 뒤에 실행됨
+                schedule_internal(JOB_MQTT_RESTART);
             }
             break;
 
@@ -420,22 +1021,36 @@ void cmd_handler_process(cmd_code_t cmd, const uint8_t *data, uint16_t len)
             }
             break;
 
-        case CMD_SET_DATA_DEF:
+        case CMD_SET_DATA_DEF: {
             ESP_LOGI(TAG, "==> CMD_SET_DATA_DEF received, len=%d", len);
-            ret = cmd_parse_data_definition(data, len, &g_data_definition);
+            // 파싱 실패 시 현재 정의를 유지하도록 별도 버퍼에 파싱
+            data_definition_t *def = data_parser_alloc_definition();
+            ret = def ? cmd_parse_data_definition(data, len, def) : ESP_ERR_NO_MEM;
             ESP_LOGI(TAG, "==> cmd_parse_data_definition returned %d", ret);
             if (ret == ESP_OK) {
                 ESP_LOGI(TAG, "==> Saving to NVS...");
-                nvs_save_data_definition(&g_data_definition);
+                ret = nvs_save_data_definition(def);
+            }
+            if (ret == ESP_OK) {
                 ESP_LOGI(TAG, "==> Updating parser...");
-                // Dynamic field definition update (특허 핵심 기능)
-                data_parser_set_definition(&g_data_definition);
+                bind_data_definition(def);
                 ESP_LOGI(TAG, "==> CMD_SET_DATA_DEF complete");
             }
+            free(def);
+            break;
+        }
+
+        case CMD_SET_DATA_DEF_V2:
+            ret = receive_data_definition_v2(data, len);
+            break;
+
+        case CMD_PROVISION:
+            ret = apply_provision_bundle(data, len);
             break;
 
         case CMD_GET_STATUS:
-            ble_service_notify_status(&g_device_status);
+            ble_service_send_response(RSP_STATUS, seq, (const uint8_t *)&g_device_status,
+                                      sizeof(device_status_t));
             break;
 
         case CMD_SAVE_CONFIG:
@@ -449,14 +1064,17 @@ void cmd_handler_process(cmd_code_t cmd, const uint8_t *data, uint16_t len)
             esp_restart();
             break;
 
-        case CMD_START_MONITOR:
-            ESP_LOGI(TAG, "Monitoring started");
-            // TODO: Set monitoring flag
+        case CMD_START_MONITOR: {
+            // [duration_s(2, LE)] [capture(1)] [rate_bps(2, LE)] - 모두 선택
+            uint16_t duration = (len >= 2) ? (data[0] | (data[1] << 8)) : 0;
+            uint8_t capture = (len >= 3) ? data[2] : 0;
+            uint32_t rate = (len >= 5) ? (data[3] | (data[4] << 8)) : 0;
+            ret = serial_monitor_start(MONITOR_TRANSPORT_BLE, duration, capture, rate);
             break;
+        }
 
         case CMD_STOP_MONITOR:
-            ESP_LOGI(TAG, "Monitoring stopped");
-            // TODO: Clear monitoring flag
+            serial_monitor_stop();
             break;
 
         case CMD_REQUEST_SYNC:
@@ -479,16 +1097,132 @@ void cmd_handler_process(cmd_code_t cmd, const uint8_t *data, uint16_t len)
         ESP_LOGE(TAG, "Command 0x%02X failed with result %d", cmd, result);
     }
     
-    ble_service_send_ack(cmd, result);
+    ble_service_send_ack(cmd, seq, result);
+}
+
+// 필드 이름 → 인덱스 (없으면 -1)
+static int find_field_index(const char *name)
+{
+    for (uint8_t i = 0; i < g_data_definition->field_count; i++) {
+        char field_name[MAX_FIELD_NAME_LEN];
+        data_parser_get_field_name(g_data_definition, i, field_name, sizeof(field_name));
+        if (strcmp(field_name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*******************************************************************************
+ * Routing Rule Parser
+ * {"field":"Alarm"|3 또는 "rawOffset":0, "op":"ne", "value":0, "suffix":"alarm", "qos":1}
+ ******************************************************************************/
+static bool parse_route_rule(const cJSON *item, route_rule_t *rule)
+{
+    static const char *ops[] = { "any", "eq", "ne", "gt", "ge", "lt", "le" };
+
+    memset(rule, 0, sizeof(route_rule_t));
+    rule->qos = DEFAULT_MQTT_QOS;
+
+    cJSON *field = cJSON_GetObjectItem(item, "field");
+    cJSON *raw_offset = cJSON_GetObjectItem(item, "rawOffset");
+    if (field && cJSON_IsNumber(field)) {
+        rule->source = ROUTE_SOURCE_FIELD;
+        rule->index = (uint16_t)field->valuedouble;
+    } else if (field && cJSON_IsString(field)) {
+        int index = find_field_index(field->valuestring);
+        if (index < 0) return false;
+        rule->source = ROUTE_SOURCE_FIELD;
+        rule->index = (uint16_t)index;
+    } else if (raw_offset && cJSON_IsNumber(raw_offset)) {
+        rule->source = ROUTE_SOURCE_RAW_BYTE;
+        rule->index = (uint16_t)raw_offset->valuedouble;
+    } else {
+        return false;
+    }
+
+    cJSON *op = cJSON_GetObjectItem(item, "op");
+    if (op && cJSON_IsString(op)) {
+        rule->op = 0xFF;
+        for (uint8_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+            if (strcmp(op->valuestring, ops[i]) == 0) {
+                rule->op = i;
+                break;
+            }
+        }
+        if (rule->op == 0xFF) return false;
+    }
+
+    cJSON *value = cJSON_GetObjectItem(item, "value");
+    if (value && cJSON_IsNumber(value)) {
+        rule->value = value->valuedouble;
+    }
+
+    cJSON *qos = cJSON_GetObjectItem(item, "qos");
+    if (qos && cJSON_IsNumber(qos)) {
+        rule->qos = (uint8_t)qos->valuedouble;
+    }
+
+    cJSON *suffix = cJSON_GetObjectItem(item, "suffix");
+    if (!suffix || !cJSON_IsString(suffix) || strlen(suffix->valuestring) == 0 ||
+        strlen(suffix->valuestring) >= ROUTE_SUFFIX_MAX_LEN) {
+        return false;
+    }
+    strncpy(rule->suffix, suffix->valuestring, ROUTE_SUFFIX_MAX_LEN - 1);
+    return true;
+}
+
+/*******************************************************************************
+ * Alarm Rule Parser
+ * {"field":"Pressure"|2, "high":10, "low":1, "hysteresis":0.5, "roc":2, "severity":2}
+ * high/low/roc 중 지정한 항목만 검사
+ ******************************************************************************/
+static bool parse_alarm_rule(const cJSON *item, alarm_rule_t *rule)
+{
+    memset(rule, 0, sizeof(alarm_rule_t));
+
+    cJSON *field = cJSON_GetObjectItem(item, "field");
+    int index = -1;
+    if (field && cJSON_IsNumber(field)) {
+        index = (int)field->valuedouble;
+    } else if (field && cJSON_IsString(field)) {
+        index = find_field_index(field->valuestring);
+    }
+    if (index < 0 || index >= MAX_FIELD_COUNT) return false;
+    rule->field = (uint8_t)index;
+
+    cJSON *high = cJSON_GetObjectItem(item, "high");
+    if (high && cJSON_IsNumber(high)) {
+        rule->checks |= ALARM_CHECK_HIGH;
+        rule->high = (float)high->valuedouble;
+    }
+    cJSON *low = cJSON_GetObjectItem(item, "low");
+    if (low && cJSON_IsNumber(low)) {
+        rule->checks |= ALARM_CHECK_LOW;
+        rule->low = (float)low->valuedouble;
+    }
+    cJSON *roc = cJSON_GetObjectItem(item, "roc");
+    if (roc && cJSON_IsNumber(roc)) {
+        rule->checks |= ALARM_CHECK_ROC;
+        rule->roc = (float)fabs(roc->valuedouble);
+    }
+    cJSON *hysteresis = cJSON_GetObjectItem(item, "hysteresis");
+    if (hysteresis && cJSON_IsNumber(hysteresis)) {
+        rule->hysteresis = (float)fabs(hysteresis->valuedouble);
+    }
+    cJSON *severity = cJSON_GetObjectItem(item, "severity");
+    if (severity && cJSON_IsNumber(severity)) {
+        rule->severity = (uint8_t)severity->valuedouble;
+    }
+
+    return rule->checks != 0;
 }
 
 /*******************************************************************************
  * Remote Command Handler (P0-3: MQTT 원격 명령 처리)
  ******************************************************************************/
-void cmd_handler_process_remote(const mqtt_remote_command_t *cmd, cJSON *payload)
+static void execute_remote_command(const mqtt_remote_command_t *cmd, cJSON *payload)
 {
-    if (!cmd) return;
-    
     ESP_LOGI(TAG, "Processing remote command: %d (request_id=%s)", 
              cmd->command, cmd->request_id);
     
@@ -496,6 +1230,7 @@ void cmd_handler_process_remote(const mqtt_remote_command_t *cmd, cJSON *payload
         case MQTT_CMD_UPDATE_CONFIG:
             if (payload) {
                 bool config_updated = false;
+                const char *config_error = NULL;    // 거부된 섹션 (나머지 섹션은 적용)
                 
                 // payload에서 설정 추출 및 적용
                 cJSON *uart = cJSON_GetObjectItem(payload, "uart");
@@ -556,9 +1291,338 @@ void cmd_handler_process_remote(const mqtt_remote_command_t *cmd, cJSON *payload
                     ESP_LOGI(TAG, "Protocol config updated remotely");
                     config_updated = true;
                 }
+
+                cJSON *backfill = cJSON_GetObjectItem(payload, "backfill");
+                if (backfill) {
+                    // Backfill 설정 업데이트 (mode: 0=off, 1=summary, 2=full)
+                    backfill_config_t bf = *backfill_get_config();
+                    cJSON *mode = cJSON_GetObjectItem(backfill, "mode");
+                    if (mode && cJSON_IsNumber(mode)) {
+                        bf.mode = (uint8_t)mode->valuedouble;
+                    }
+                    cJSON *buckets = cJSON_GetObjectItem(backfill, "buckets");
+                    if (buckets && cJSON_IsNumber(buckets)) {
+                        bf.buckets = (uint16_t)buckets->valuedouble;
+                    }
+                    cJSON *rate = cJSON_GetObjectItem(backfill, "rate");
+                    if (rate && cJSON_IsNumber(rate)) {
+                        bf.rate = (uint16_t)rate->valuedouble;
+                    }
+                    backfill_set_config(&bf);
+                    nvs_save_feature_config("backfill", backfill_get_config(), sizeof(backfill_config_t));
+                    ESP_LOGI(TAG, "Backfill config updated remotely");
+                    config_updated = true;
+                }
+
+                cJSON *raw = cJSON_GetObjectItem(payload, "raw");
+                if (raw) {
+                    // Raw 포함 정책 (include: 0=always, 1=never, 2=on_error, 3=sampled / encoding: 0=hex, 1=base64)
+                    raw_config_t rc = *mqtt_handler_get_raw_config();
+                    cJSON *include = cJSON_GetObjectItem(raw, "include");
+                    if (include && cJSON_IsNumber(include)) {
+                        rc.include = (uint8_t)include->valuedouble;
+                    }
+                    cJSON *encoding = cJSON_GetObjectItem(raw, "encoding");
+                    if (encoding && cJSON_IsNumber(encoding)) {
+                        rc.encoding = (uint8_t)encoding->valuedouble;
+                    }
+                    cJSON *every = cJSON_GetObjectItem(raw, "sampleEvery");
+                    if (every && cJSON_IsNumber(every)) {
+                        rc.sample_every = (uint16_t)every->valuedouble;
+                    }
+                    mqtt_handler_set_raw_config(&rc);
+                    uart_handler_set_forward_crc_errors(
+                        mqtt_handler_get_raw_config()->include == RAW_INCLUDE_ON_ERROR);
+                    nvs_save_feature_config("raw", mqtt_handler_get_raw_config(), sizeof(raw_config_t));
+                    ESP_LOGI(TAG, "Raw policy updated remotely");
+                    config_updated = true;
+                }
+
+                cJSON *field_topics = cJSON_GetObjectItem(payload, "fieldTopics");
+                if (field_topics) {
+                    // 필드별 토픽 설정 ({base}/fields/{name})
+                    field_topic_config_t ft = *field_topics_get_config();
+                    cJSON *enable = cJSON_GetObjectItem(field_topics, "enable");
+                    if (enable && cJSON_IsBool(enable)) {
+                        ft.enable = cJSON_IsTrue(enable) ? 1 : 0;
+                    }
+                    cJSON *qos = cJSON_GetObjectItem(field_topics, "qos");
+                    if (qos && cJSON_IsNumber(qos)) {
+                        ft.qos = (uint8_t)qos->valuedouble;
+                    }
+                    cJSON *retain = cJSON_GetObjectItem(field_topics, "retain");
+                    if (retain && cJSON_IsBool(retain)) {
+                        ft.retain = cJSON_IsTrue(retain) ? 1 : 0;
+                    }
+                    cJSON *fields = cJSON_GetObjectItem(field_topics, "fields");
+                    bool fields_ok = true;
+                    if (fields && cJSON_IsArray(fields)) {
+                        // 필드 인덱스 또는 이름 목록 (빈 배열 = 전체)
+                        // 선택 mask는 앞 FIELD_MASK_BITS개 필드만 표현 - 그 뒤 필드 지정은 거부
+                        ft.field_mask = 0;
+                        cJSON *item;
+                        cJSON_ArrayForEach(item, fields) {
+                            int index = -1;
+                            if (cJSON_IsNumber(item)) {
+                                index = (int)item->valuedouble;
+                            } else if (cJSON_IsString(item)) {
+                                index = find_field_index(item->valuestring);
+                            }
+                            if (index >= FIELD_MASK_BITS) {
+                                fields_ok = false;
+                                break;
+                            }
+                            if (index >= 0) {
+                                ft.field_mask |= FIELD_MASK_BIT(index);
+                            }
+                        }
+                    }
+                    if (fields_ok) {
+                        field_topics_set_config(&ft);
+                        nvs_save_feature_config("fields", field_topics_get_config(), sizeof(field_topic_config_t));
+                        ESP_LOGI(TAG, "Field topics config updated remotely");
+                        config_updated = true;
+                    } else {
+                        ESP_LOGW(TAG, "fieldTopics rejected: field index beyond %d", FIELD_MASK_BITS);
+                        config_error = "fieldTopics: only the first 64 fields can be selected";
+                    }
+                }
+
+                cJSON *routes = cJSON_GetObjectItem(payload, "routes");
+                if (routes && cJSON_IsArray(routes)) {
+                    // 라우팅 규칙 테이블 교체 (빈 배열 = 규칙 없음)
+                    route_config_t rc;
+                    memset(&rc, 0, sizeof(rc));
+                    cJSON *item;
+                    cJSON_ArrayForEach(item, routes) {
+                        if (rc.rule_count >= ROUTE_MAX_RULES) break;
+                        if (parse_route_rule(item, &rc.rules[rc.rule_count])) {
+                            rc.rule_count++;
+                        }
+                    }
+                    topic_router_set_config(&rc);
+                    nvs_save_feature_config("routes", topic_router_get_config(), sizeof(route_config_t));
+                    ESP_LOGI(TAG, "Routing rules updated remotely: %d rules", rc.rule_count);
+                    config_updated = true;
+                }
+
+                cJSON *rate_plan = cJSON_GetObjectItem(payload, "ratePlan");
+                if (rate_plan) {
+                    // 필드별 발행 주기 (fields 지정 시 테이블 교체, 목록에 없는 필드 = 매 record)
+                    rate_plan_config_t rc = *rate_plan_get_config();
+                    cJSON *enable = cJSON_GetObjectItem(rate_plan, "enable");
+                    cJSON *qos = cJSON_GetObjectItem(rate_plan, "qos");
+                    cJSON *snapshot = cJSON_GetObjectItem(rate_plan, "snapshotSec");
+                    cJSON *fields = cJSON_GetObjectItem(rate_plan, "fields");
+
+                    if (enable) rc.enable = cJSON_IsTrue(enable) ? 1 : 0;
+                    if (qos && cJSON_IsNumber(qos)) rc.qos = (uint8_t)qos->valuedouble;
+                    if (snapshot && cJSON_IsNumber(snapshot)) {
+                        rc.snapshot_s = (uint16_t)snapshot->valuedouble;
+                    }
+                    bool fields_ok = true;
+                    if (fields && cJSON_IsArray(fields)) {
+                        memset(rc.divider, 0, sizeof(rc.divider));
+                        memset(rc.interval_ms, 0, sizeof(rc.interval_ms));
+                        cJSON *item;
+                        cJSON_ArrayForEach(item, fields) {
+                            cJSON *field = cJSON_GetObjectItem(item, "field");
+                            cJSON *divider = cJSON_GetObjectItem(item, "divider");
+                            cJSON *interval = cJSON_GetObjectItem(item, "intervalMs");
+                            int index = -1;
+                            if (field && cJSON_IsNumber(field)) {
+                                index = (int)field->valuedouble;
+                            } else if (field && cJSON_IsString(field)) {
+                                index = find_field_index(field->valuestring);
+                            }
+                            if (index >= FIELD_MASK_BITS) {
+                                fields_ok = false;      // 주기는 앞 64개 필드만 설정 가능
+                                break;
+                            }
+                            if (index < 0) continue;
+                            if (divider && cJSON_IsNumber(divider)) {
+                                rc.divider[index] = (uint16_t)divider->valuedouble;
+                            }
+                            if (interval && cJSON_IsNumber(interval)) {
+                                rc.interval_ms[index] = (uint32_t)interval->valuedouble;
+                            }
+                        }
+                    }
+                    if (fields_ok) {
+                        rate_plan_set_config(&rc);
+                        nvs_save_feature_config("rateplan", rate_plan_get_config(), sizeof(rate_plan_config_t));
+                        ESP_LOGI(TAG, "Rate plan updated remotely: enable=%d", rc.enable);
+                        config_updated = true;
+                    } else {
+                        ESP_LOGW(TAG, "ratePlan rejected: field index beyond %d", FIELD_MASK_BITS);
+                        config_error = "ratePlan: only the first 64 fields can be configured";
+                    }
+                }
+
+                cJSON *alarms = cJSON_GetObjectItem(payload, "alarms");
+                if (alarms) {
+                    // 알람 규칙 (rules 지정 시 테이블 교체, 빈 배열 = 규칙 없음)
+                    alarm_config_t ac = *alarm_get_config();
+                    cJSON *qos = cJSON_GetObjectItem(alarms, "qos");
+                    if (qos && cJSON_IsNumber(qos)) {
+                        ac.qos = (uint8_t)qos->valuedouble;
+                    }
+                    cJSON *rules = cJSON_GetObjectItem(alarms, "rules");
+                    if (rules && cJSON_IsArray(rules)) {
+                        ac.rule_count = 0;
+                        cJSON *item;
+                        cJSON_ArrayForEach(item, rules) {
+                            if (ac.rule_count >= ALARM_MAX_RULES) break;
+                            if (parse_alarm_rule(item, &ac.rules[ac.rule_count])) {
+                                ac.rule_count++;
+                            }
+                        }
+                    }
+                    alarm_set_config(&ac);
+                    nvs_save_feature_config("alarms", alarm_get_config(), sizeof(alarm_config_t));
+                    ESP_LOGI(TAG, "Alarm rules updated remotely: %d rules", ac.rule_count);
+                    config_updated = true;
+                }
+
+                cJSON *gateway = cJSON_GetObjectItem(payload, "gateway");
+                if (gateway) {
+                    // Gateway 모드 (슬레이브 주소별 자식 장치)
+                    gateway_config_t gw = *gateway_get_config();
+                    cJSON *enable = cJSON_GetObjectItem(gateway, "enable");
+                    if (enable && cJSON_IsBool(enable)) {
+                        gw.enable = cJSON_IsTrue(enable) ? 1 : 0;
+                    }
+                    cJSON *offset = cJSON_GetObjectItem(gateway, "addrOffset");
+                    if (offset && cJSON_IsNumber(offset)) {
+                        gw.addr_offset = (uint16_t)offset->valuedouble;
+                    }
+                    cJSON *width = cJSON_GetObjectItem(gateway, "addrWidth");
+                    if (width && cJSON_IsNumber(width)) {
+                        gw.addr_width = (uint8_t)width->valuedouble;
+                    }
+                    cJSON *big_endian = cJSON_GetObjectItem(gateway, "bigEndian");
+                    if (big_endian && cJSON_IsBool(big_endian)) {
+                        gw.addr_big_endian = cJSON_IsTrue(big_endian) ? 1 : 0;
+                    }
+                    cJSON *timeout = cJSON_GetObjectItem(gateway, "timeoutSec");
+                    if (timeout && cJSON_IsNumber(timeout)) {
+                        gw.timeout_s = (uint16_t)timeout->valuedouble;
+                    }
+                    gateway_set_config(&gw);
+                    nvs_save_feature_config("gateway", gateway_get_config(), sizeof(gateway_config_t));
+                    ESP_LOGI(TAG, "Gateway config updated remotely");
+                    config_updated = true;
+                }
+
+                cJSON *batch = cJSON_GetObjectItem(payload, "batch");
+                if (batch) {
+                    // 적응형 배치 (latencyMs: p99 end-to-end 지연 목표)
+                    batch_config_t bc = *mqtt_batch_get_config();
+                    cJSON *enable = cJSON_GetObjectItem(batch, "enable");
+                    if (enable && cJSON_IsBool(enable)) {
+                        bc.enable = cJSON_IsTrue(enable) ? 1 : 0;
+                    }
+                    cJSON *max_records = cJSON_GetObjectItem(batch, "maxRecords");
+                    if (max_records && cJSON_IsNumber(max_records)) {
+                        bc.max_records = (uint8_t)max_records->valuedouble;
+                    }
+                    cJSON *latency = cJSON_GetObjectItem(batch, "latencyMs");
+                    if (latency && cJSON_IsNumber(latency)) {
+                        bc.latency_ms = (uint16_t)latency->valuedouble;
+                    }
+                    mqtt_batch_set_config(&bc);
+                    nvs_save_feature_config("batch", mqtt_batch_get_config(), sizeof(batch_config_t));
+                    ESP_LOGI(TAG, "Batch config updated remotely");
+                    config_updated = true;
+                }
+
+                cJSON *recorder = cJSON_GetObjectItem(payload, "recorder");
+                if (recorder) {
+                    // Flight recorder 트리거 (임계값 0 = 해당 트리거 끔)
+                    flight_config_t fc = *flight_recorder_get_config();
+                    cJSON *enable = cJSON_GetObjectItem(recorder, "enable");
+                    if (enable && cJSON_IsBool(enable)) {
+                        fc.enable = cJSON_IsTrue(enable) ? 1 : 0;
+                    }
+                    cJSON *window = cJSON_GetObjectItem(recorder, "windowSec");
+                    if (window && cJSON_IsNumber(window)) {
+                        fc.window_s = (uint8_t)window->valuedouble;
+                    }
+                    cJSON *crc = cJSON_GetObjectItem(recorder, "crcThreshold");
+                    if (crc && cJSON_IsNumber(crc)) {
+                        fc.crc_threshold = (uint16_t)crc->valuedouble;
+                    }
+                    cJSON *parse = cJSON_GetObjectItem(recorder, "parseThreshold");
+                    if (parse && cJSON_IsNumber(parse)) {
+                        fc.parse_threshold = (uint16_t)parse->valuedouble;
+                    }
+                    cJSON *cooldown = cJSON_GetObjectItem(recorder, "cooldownSec");
+                    if (cooldown && cJSON_IsNumber(cooldown)) {
+                        fc.cooldown_s = (uint16_t)cooldown->valuedouble;
+                    }
+                    flight_recorder_set_config(&fc);
+                    nvs_save_feature_config("flight", flight_recorder_get_config(), sizeof(flight_config_t));
+                    ESP_LOGI(TAG, "Flight recorder config updated remotely");
+                    config_updated = true;
+                }
+
+                cJSON *time_obj = cJSON_GetObjectItem(payload, "time");
+                if (time_obj) {
+                    // SNTP 서버/재동기화 주기 (서버 변경 시 SNTP 재시작)
+                    time_config_t tc = *time_sync_get_config();
+                    cJSON *server = cJSON_GetObjectItem(time_obj, "server");
+                    if (server && cJSON_IsString(server)) {
+                        strncpy(tc.server, server->valuestring, sizeof(tc.server) - 1);
+                        tc.server[sizeof(tc.server) - 1] = '\0';
+                    }
+                    cJSON *resync = cJSON_GetObjectItem(time_obj, "resyncSec");
+                    if (resync && cJSON_IsNumber(resync)) {
+                        tc.resync_s = (uint16_t)resync->valuedouble;
+                    }
+                    time_sync_set_config(&tc);
+                    nvs_save_feature_config("time", time_sync_get_config(), sizeof(time_config_t));
+                    ESP_LOGI(TAG, "Time config updated remotely: %s", time_sync_get_config()->server);
+                    config_updated = true;
+                }
+
+                cJSON *dedupe = cJSON_GetObjectItem(payload, "dedupe");
+                if (dedupe) {
+                    // 중복 프레임 억제 설정 업데이트
+                    dedupe_config_t dd = *frame_dedupe_get_config();
+                    cJSON *enable = cJSON_GetObjectItem(dedupe, "enable");
+                    if (enable && cJSON_IsBool(enable)) {
+                        dd.enable = cJSON_IsTrue(enable) ? 1 : 0;
+                    }
+                    cJSON *holdoff = cJSON_GetObjectItem(dedupe, "holdoffMs");
+                    if (holdoff && cJSON_IsNumber(holdoff)) {
+                        dd.holdoff_ms = (uint16_t)holdoff->valuedouble;
+                    }
+                    cJSON *exclude = cJSON_GetObjectItem(dedupe, "exclude");
+                    if (exclude && cJSON_IsArray(exclude)) {
+                        // [{"offset":n,"length":n}, ...] - 카운터/CRC 등 매번 바뀌는 바이트
+                        dd.exclude_count = 0;
+                        cJSON *range;
+                        cJSON_ArrayForEach(range, exclude) {
+                            if (dd.exclude_count >= DEDUPE_MAX_EXCLUDE) break;
+                            cJSON *offset = cJSON_GetObjectItem(range, "offset");
+                            cJSON *length = cJSON_GetObjectItem(range, "length");
+                            if (offset && cJSON_IsNumber(offset) && length && cJSON_IsNumber(length)) {
+                                dd.exclude[dd.exclude_count].offset = (uint16_t)offset->valuedouble;
+                                dd.exclude[dd.exclude_count].length = (uint16_t)length->valuedouble;
+                                dd.exclude_count++;
+                            }
+                        }
+                    }
+                    frame_dedupe_set_config(&dd);
+                    nvs_save_feature_config("dedupe", frame_dedupe_get_config(), sizeof(dedupe_config_t));
+                    ESP_LOGI(TAG, "Dedupe config updated remotely");
+                    config_updated = true;
+                }
                 
                 // 설정 업데이트 응답 전송
-                if (config_updated) {
+                if (config_error) {
+                    mqtt_handler_send_command_response(cmd->request_id, false, config_error);
+                } else if (config_updated) {
                     mqtt_handler_send_command_response(cmd->request_id, true, "Config updated");
                 } else {
                     mqtt_handler_send_command_response(cmd->request_id, false, "No valid config in payload");
@@ -586,18 +1650,103 @@ void cmd_handler_process_remote(const mqtt_remote_command_t *cmd, cJSON *payload
             }
             break;
             
-        case MQTT_CMD_START_MONITOR:
+        case MQTT_CMD_START_MONITOR: {
+            // {"durationSec":60, "rx":true, "frames":true, "rateBps":8000, "transport":"mqtt"|"ble"}
             ESP_LOGI(TAG, "Remote monitoring start");
-            // TODO: Start monitoring
-            mqtt_handler_send_command_response(cmd->request_id, true, "Monitoring started");
+            monitor_transport_t transport = MONITOR_TRANSPORT_MQTT;
+            uint16_t duration = 0;
+            uint8_t capture = MONITOR_CAPTURE_ALL;
+            uint32_t rate = 0;
+            if (payload) {
+                cJSON *item = cJSON_GetObjectItem(payload, "durationSec");
+                if (item && cJSON_IsNumber(item)) duration = (uint16_t)item->valuedouble;
+                item = cJSON_GetObjectItem(payload, "rx");
+                if (item && cJSON_IsFalse(item)) capture &= ~MONITOR_CAPTURE_RX;
+                item = cJSON_GetObjectItem(payload, "frames");
+                if (item && cJSON_IsFalse(item)) capture &= ~MONITOR_CAPTURE_FRAMES;
+                item = cJSON_GetObjectItem(payload, "rateBps");
+                if (item && cJSON_IsNumber(item)) rate = (uint32_t)item->valuedouble;
+                item = cJSON_GetObjectItem(payload, "transport");
+                if (item && cJSON_IsString(item) && strcmp(item->valuestring, "ble") == 0) {
+                    transport = MONITOR_TRANSPORT_BLE;
+                }
+            }
+            if (capture == 0) {
+                mqtt_handler_send_command_response(cmd->request_id, false, "Nothing to capture");
+            } else if (serial_monitor_start(transport, duration, capture, rate) == ESP_OK) {
+                mqtt_handler_send_command_response(cmd->request_id, true, "Monitoring started");
+            } else {
+                mqtt_handler_send_command_response(cmd->request_id, false, "Monitor start failed");
+            }
             break;
+        }
             
         case MQTT_CMD_STOP_MONITOR:
             ESP_LOGI(TAG, "Remote monitoring stop");
-            // TODO: Stop monitoring
+            serial_monitor_stop();
             mqtt_handler_send_command_response(cmd->request_id, true, "Monitoring stopped");
             break;
             
+        case MQTT_CMD_QUERY_HISTORY: {
+            // {"fields":["Temp",2], "from":epoch, "to":epoch, "lastSec":3600, "stepMs":1000, "agg":"mean"}
+            history_query_t query = { .agg = HISTORY_AGG_MEAN };
+            strncpy(query.request_id, cmd->request_id, sizeof(query.request_id) - 1);
+            const char *field_error = NULL;
+            if (payload) {
+                cJSON *item = cJSON_GetObjectItem(payload, "fields");
+                if (item && cJSON_IsArray(item)) {
+                    cJSON *field;
+                    cJSON_ArrayForEach(field, item) {
+                        int index = -1;
+                        if (cJSON_IsNumber(field)) {
+                            index = (int)field->valuedouble;
+                        } else if (cJSON_IsString(field)) {
+                            index = find_field_index(field->valuestring);
+                        }
+                        if (index < 0) {
+                            field_error = "Unknown field";
+                            break;
+                        }
+                        if (index >= FIELD_MASK_BITS) {
+                            field_error = "Only the first 64 fields can be selected";
+                            break;
+                        }
+                        query.field_mask |= FIELD_MASK_BIT(index);
+                    }
+                }
+                item = cJSON_GetObjectItem(payload, "from");
+                if (item && cJSON_IsNumber(item)) query.from = item->valuedouble;
+                item = cJSON_GetObjectItem(payload, "to");
+                if (item && cJSON_IsNumber(item)) query.to = item->valuedouble;
+                item = cJSON_GetObjectItem(payload, "lastSec");
+                if (item && cJSON_IsNumber(item)) query.last_s = (uint32_t)item->valuedouble;
+                item = cJSON_GetObjectItem(payload, "stepMs");
+                if (item && cJSON_IsNumber(item)) query.step_ms = (uint32_t)item->valuedouble;
+                item = cJSON_GetObjectItem(payload, "agg");
+                if (item && cJSON_IsString(item)) {
+                    if (strcmp(item->valuestring, "min") == 0) query.agg = HISTORY_AGG_MIN;
+                    else if (strcmp(item->valuestring, "max") == 0) query.agg = HISTORY_AGG_MAX;
+                    else if (strcmp(item->valuestring, "last") == 0) query.agg = HISTORY_AGG_LAST;
+                }
+            }
+
+            if (field_error) {
+                mqtt_handler_send_command_response(cmd->request_id, false, field_error);
+                break;
+            }
+            esp_err_t ret = history_query_start(&query);
+            if (ret == ESP_OK) {
+                mqtt_handler_send_command_response(cmd->request_id, true, "Query started");
+            } else if (ret == ESP_ERR_INVALID_STATE) {
+                mqtt_handler_send_command_response(cmd->request_id, false, "Query in progress");
+            } else if (ret == ESP_ERR_NOT_SUPPORTED) {
+                mqtt_handler_send_command_response(cmd->request_id, false, "History not available");
+            } else {
+                mqtt_handler_send_command_response(cmd->request_id, false, "Query start failed");
+            }
+            break;
+        }
+
         case MQTT_CMD_FACTORY_RESET:
             ESP_LOGW(TAG, "Remote factory reset requested");
             mqtt_handler_send_command_response(cmd->request_id, true, "Factory resetting...");
@@ -612,3 +1761,195 @@ void cmd_handler_process_remote(const mqtt_remote_command_t *cmd, cJSON *payload
             break;
     }
 }
+
+/*******************************************************************************
+ * Executor Task
+ ******************************************************************************/
+static void cmd_executor_task(void *arg)
+{
+    cmd_job_t *job;
+
+    while (1) {
+        if (xQueueReceive(s_job_queue, &job, portMAX_DELAY) != pdTRUE) continue;
+
+        switch (job->type) {
+            case JOB_BLE: {
+                cmd_slot_t slot = slot_of(job->cmd);
+                if (slot != SLOT_NONE && s_latest_seq[slot] != job->seq) {
+                    // 큐에 같은 종류의 최신 설정이 있음 → 이 명령은 적용하지 않음
+                    // (적용 결과는 최신 명령의 ACK로 확인)
+                    ESP_LOGI(TAG, "Command 0x%02X superseded by newer request", job->cmd);
+                    stats_inc(s_stat_coalesced);
+                    ble_service_send_ack(job->cmd, job->ble_seq, RESULT_SUPERSEDED);
+                    break;
+                }
+                execute_ble_command((cmd_code_t)job->cmd, job->ble_seq, job->data, job->len);
+                break;
+            }
+
+            case JOB_REMOTE:
+                portENTER_CRITICAL(&s_lock);
+                s_remote_pending &= ~(1u << job->remote.command);
+                portEXIT_CRITICAL(&s_lock);
+                execute_remote_command(&job->remote, job->payload);
+                break;
+
+            default:
+                run_internal((cmd_job_type_t)job->type);
+                break;
+        }
+
+        if (job->payload) cJSON_Delete(job->payload);
+        free(job);
+    }
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+esp_err_t cmd_handler_init(void)
+{
+    if (s_job_queue) return ESP_OK;
+
+    s_job_queue = xQueueCreate(BLE_CMD_QUEUE_SIZE, sizeof(cmd_job_t *));
+    if (!s_job_queue) return ESP_ERR_NO_MEM;
+
+    s_stat_dropped = stats_register("cmd.dropped", STATS_COUNTER);
+    s_stat_coalesced = stats_register("cmd.coalesced", STATS_COUNTER);
+    s_stat_rate_limited = stats_register("cmd.rate_limited", STATS_COUNTER);
+
+    if (xTaskCreate(cmd_executor_task, "cmd_exec", TASK_STACK_CMD,
+                    NULL, TASK_PRIORITY_CMD, NULL) != pdPASS) {
+        vQueueDelete(s_job_queue);
+        s_job_queue = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Command executor started (queue=%d)", BLE_CMD_QUEUE_SIZE);
+    return ESP_OK;
+}
+
+void cmd_handler_process(cmd_code_t cmd, uint16_t seq, const uint8_t *data, uint16_t len)
+{
+    cmd_job_t *job = malloc(sizeof(cmd_job_t) + len);
+    if (!job) {
+        ble_service_send_ack(cmd, seq, RESULT_FAILED);
+        return;
+    }
+    memset(job, 0, sizeof(cmd_job_t));
+    job->type = JOB_BLE;
+    job->cmd = (uint8_t)cmd;
+    job->ble_seq = seq;
+    job->len = len;
+    if (data && len > 0) {
+        memcpy(job->data, data, len);
+    }
+
+    cmd_slot_t slot = slot_of(cmd);
+    portENTER_CRITICAL(&s_lock);
+    job->seq = ++s_seq;
+    if (slot != SLOT_NONE) {
+        s_latest_seq[slot] = job->seq;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (!enqueue_job(job)) {
+        ESP_LOGW(TAG, "Command queue full, rejecting 0x%02X", cmd);
+        free(job);
+        ble_service_send_ack(cmd, seq, RESULT_FAILED);
+    }
+}
+
+// 거부된 명령의 재시도가 중복으로 걸러지지 않도록 기록 제거
+static void forget_request_id(const char *request_id)
+{
+    if (request_id[0] == '\0') return;
+
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < RECENT_REQUEST_IDS; i++) {
+        if (strcmp(s_recent_ids[i], request_id) == 0) {
+            s_recent_ids[i][0] = '\0';
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void cmd_handler_process_remote(const mqtt_remote_command_t *cmd, cJSON *payload)
+{
+    if (!cmd) return;
+
+    // QoS 1 재전송 등 같은 request_id 중복 실행 방지
+    if (cmd->request_id[0] != '\0') {
+        bool duplicate = false;
+        portENTER_CRITICAL(&s_lock);
+        for (int i = 0; i < RECENT_REQUEST_IDS; i++) {
+            if (strcmp(s_recent_ids[i], cmd->request_id) == 0) {
+                duplicate = true;
+                break;
+            }
+        }
+        if (!duplicate) {
+            strncpy(s_recent_ids[s_recent_next], cmd->request_id, sizeof(s_recent_ids[0]) - 1);
+            s_recent_next = (s_recent_next + 1) % RECENT_REQUEST_IDS;
+        }
+        portEXIT_CRITICAL(&s_lock);
+
+        if (duplicate) {
+            ESP_LOGW(TAG, "Duplicate remote command ignored (request_id=%s)", cmd->request_id);
+            stats_inc(s_stat_coalesced);
+            return;
+        }
+    }
+
+    // 멱등 명령이 이미 대기 중이면 합침, 아니면 종류별 token 소비
+    uint32_t bit = (cmd->command < REMOTE_CMD_TYPES) ? (1u << cmd->command) : 0;
+    bool coalesced = false;
+    bool allowed = true;
+    portENTER_CRITICAL(&s_lock);
+    if (bit & REMOTE_IDEMPOTENT_MASK & s_remote_pending) {
+        coalesced = true;
+    } else {
+        allowed = take_token(cmd->command);
+        if (allowed) s_remote_pending |= bit & REMOTE_IDEMPOTENT_MASK;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (coalesced) {
+        ESP_LOGI(TAG, "Remote command %d coalesced with pending request", cmd->command);
+        stats_inc(s_stat_coalesced);
+        mqtt_handler_send_command_response(cmd->request_id, true, "Coalesced");
+        return;
+    }
+    if (!allowed) {
+        ESP_LOGD(TAG, "Remote command %d rate limited", cmd->command);
+        stats_inc(s_stat_rate_limited);
+        forget_request_id(cmd->request_id);
+        mqtt_handler_send_command_response(cmd->request_id, false, "Rate limited");
+        return;
+    }
+
+    cmd_job_t *job = calloc(1, sizeof(cmd_job_t));
+    if (job) {
+        job->type = JOB_REMOTE;
+        memcpy(&job->remote, cmd, sizeof(mqtt_remote_command_t));
+        // 호출자가 콜백 반환 직후 원본을 해제하므로 사본 보관
+        job->payload = payload ? cJSON_Duplicate(payload, true) : NULL;
+        if ((!payload || job->payload) && enqueue_job(job)) {
+            // 접수 응답 (실행 결과는 executor가 따로 보냄)
+            if (cmd->request_id[0] != '\0') {
+                mqtt_handler_send_command_response(cmd->request_id, true, "Command received");
+            }
+            return;
+        }
+        if (job->payload) cJSON_Delete(job->payload);
+        free(job);
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_remote_pending &= ~bit;
+    portEXIT_CRITICAL(&s_lock);
+    forget_request_id(cmd->request_id);
+
+    ESP_LOGW(TAG, "Command queue full, rejecting remote command %d", cmd->command);
+    mqtt_handler_send_command_response(cmd->request_id, false, "Busy");
+}
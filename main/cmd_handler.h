@@ -71,15 +71,72 @@ esp_err_t cmd_parse_protocol_config(const uint8_t *data, uint16_t len, protocol_
 esp_err_t cmd_parse_data_definition(const uint8_t *data, uint16_t len, data_definition_t *def);
 
 /**
- * @brief Process BLE command
+ * @brief Parse v2 data definition (재조립된 전체, 16-bit offset / float scale / 이름 table)
+ * @param data Definition bytes (crc32 포함)
+ * @param len Definition length
+ * @param def Output definition
+ * @return ESP_OK, ESP_ERR_INVALID_CRC, ESP_ERR_INVALID_ARG
+ */
+esp_err_t cmd_parse_data_definition_v2(const uint8_t *data, uint16_t len, data_definition_t *def);
+
+/**
+ * @brief CMD_PROVISION bundle 파싱 결과
+ *
+ * sections: 포함된 섹션 비트 (PROVISION_SECTION_BIT(CMD_SET_xxx))
+ */
+#define PROVISION_SECTION_BIT(cmd)  (1u << ((cmd) - CMD_SET_WIFI))
+
+typedef struct {
+    uint8_t sections;
+    wifi_config_data_t wifi;
+    mqtt_config_data_t mqtt;
+    uart_config_data_t uart;
+    protocol_config_data_t protocol;
+    data_definition_t data_def;
+} provision_bundle_t;
+
+/**
+ * @brief Parse and validate bulk provisioning bundle (CMD_PROVISION)
+ *
+ * 섹션 data는 개별 CMD_SET_xxx payload와 같은 형식이다.
+ * 하나라도 잘못되면 전체를 거부한다 (부분 적용 없음).
+ * @param data Raw bundle
+ * @param len Bundle length
+ * @param bundle Output (크기가 크므로 heap에 할당해 전달)
+ * @return ESP_OK, ESP_ERR_INVALID_CRC, ESP_ERR_INVALID_ARG
+ */
+esp_err_t cmd_parse_provision_bundle(const uint8_t *data, uint16_t len, provision_bundle_t *bundle);
+
+/**
+ * @brief 저장 도중 중단된 bundle 다시 저장 (nvs_storage_init 후, 설정 로드 전에 호출)
+ * @return ESP_OK (중단된 bundle 없음 포함)
+ */
+esp_err_t cmd_handler_recover_provisioning(void);
+
+/**
+ * @brief Start command executor task (BLE/MQTT 초기화 전에 호출)
+ * @return ESP_OK on success
+ */
+esp_err_t cmd_handler_init(void);
+
+/**
+ * @brief Queue BLE command for the executor (BLE 콜백에서 호출, 블로킹 없음)
+ *
+ * 데이터는 복사된다. 큐가 가득 차면 즉시 RESULT_FAILED ACK.
+ * ACK는 executor가 명령 처리 후 전송한다 (응답/ACK에 seq 전달).
  * @param cmd Command code
+ * @param seq v2 요청 SEQ (v1은 BLE_SEQ_NONE)
  * @param data Payload data
  * @param len Payload length
  */
-void cmd_handler_process(cmd_code_t cmd, const uint8_t *data, uint16_t len);
+void cmd_handler_process(cmd_code_t cmd, uint16_t seq, const uint8_t *data, uint16_t len);
 
 /**
- * @brief Process remote MQTT command (P0-3)
+ * @brief Queue remote MQTT command for the executor (P0-3, 블로킹 없음)
+ *
+ * payload는 복사된다. 명령 응답은 모두 여기서(또는 executor가) 보낸다:
+ * 접수 시 "Command received", 합쳐지면 "Coalesced", 거부 시 "Rate limited"/"Busy"(실패).
+ * 최근 처리한 request_id와 같으면 (QoS 1 재전송) 응답 없이 무시한다.
  * @param cmd Command structure
  * @param payload JSON payload (may be NULL)
  */
@@ -7,20 +7,186 @@
 
 #include "data_parser.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
 static const char *TAG = "Parser";
 
-static data_definition_t s_def = {0};
+/*
+ * 컴파일된 필드 추출기
+ *
+ * 정의가 바뀔 때 필드마다 프레임 내 절대 위치, 읽을 바이트 수, 스케일 적용 여부,
+ * 이름을 미리 계산해 두고, 프레임마다 정의(PSRAM)를 다시 해석하지 않는다.
+ * 필드 수가 늘어도 필드당 비용은 위치 확인 + 읽기 + 이름 복사로 일정하다.
+ */
+typedef struct {
+    uint16_t pos;               // 프레임 내 절대 위치 (data_offset + start_offset)
+    uint16_t size;              // 읽을 바이트 수 (문자열/BCD는 최대 길이)
+    uint8_t type;
+    uint8_t bit_offset;
+    uint8_t big_endian;
+    uint8_t scaled;             // scale != 1 또는 offset != 0
+    uint16_t name_off;          // names pool 내 위치
+    uint8_t name_len;
+    float scale;
+    float offset;
+} compiled_field_t;
+
+/*
+ * plan 수명: 참조 카운트 (s_plan이 1개, 파싱 중인 워커가 각 1개).
+ * 교체는 s_plan의 참조만 내려놓고, 마지막 참조를 놓는 쪽이 해제하므로
+ * 파싱 중에 정의가 몇 번 바뀌어도 읽고 있는 plan은 해제되지 않는다.
+ */
+typedef struct {
+    uint32_t refs;              // s_plan_lock 보호
+    uint8_t count;
+    uint16_t data_offset;
+    compiled_field_t *fields;
+    char *names;                // 필드 이름 pool (NUL 없이 연속)
+} compiled_plan_t;
+
+static data_definition_t *s_def = NULL;     // PSRAM
+static compiled_plan_t *s_plan = NULL;
+static portMUX_TYPE s_plan_lock = portMUX_INITIALIZER_UNLOCKED;
+
+data_definition_t* data_parser_alloc_definition(void)
+{
+    data_definition_t *def = heap_caps_calloc(1, sizeof(data_definition_t), MALLOC_CAP_SPIRAM);
+    if (!def) {
+        def = calloc(1, sizeof(data_definition_t));
+    }
+    return def;
+}
 
 esp_err_t data_parser_init(void)
 {
-    memset(&s_def, 0, sizeof(s_def));
+    if (!s_def) {
+        s_def = data_parser_alloc_definition();
+        if (!s_def) return ESP_ERR_NO_MEM;
+    }
+    memset(s_def, 0, sizeof(data_definition_t));
     ESP_LOGI(TAG, "Initialized");
     return ESP_OK;
 }
 
+void data_parser_field_from_v1(const field_definition_v1_t *v1, field_definition_t *fd)
+{
+    memset(fd, 0, sizeof(*fd));
+    fd->field_type = v1->field_type;
+    fd->byte_order = v1->byte_order;
+    fd->start_offset = v1->start_offset;
+    fd->bit_offset = v1->bit_offset;
+    fd->bit_length = v1->bit_length;
+    fd->name_length = v1->name_length;
+    fd->name_index = v1->name_index;
+    fd->scale = v1->scale_factor ? v1->scale_factor / 1000.0f : 1.0f;     // Scale * 1000
+    fd->offset = v1->offset_value / 100.0f;                                 // Offset * 100
+}
+
+// 타입별 읽기 크기 (문자열/BCD는 bit_length 기준)
+uint16_t data_parser_field_size(const field_definition_t *fd)
+{
+    switch (fd->field_type) {
+        case DATA_TYPE_BOOL:
+        case DATA_TYPE_UINT8:
+        case DATA_TYPE_INT8:        return 1;
+        case DATA_TYPE_UINT16:
+        case DATA_TYPE_INT16:       return 2;
+        case DATA_TYPE_UINT32:
+        case DATA_TYPE_INT32:
+        case DATA_TYPE_FLOAT32:
+        case DATA_TYPE_TIMESTAMP:   return 4;
+        case DATA_TYPE_UINT64:
+        case DATA_TYPE_INT64:
+        case DATA_TYPE_FLOAT64:
+        case DATA_TYPE_TIMESTAMP_MS: return 8;
+        case DATA_TYPE_BCD:         return (fd->bit_length + 7) / 8;
+        case DATA_TYPE_STRING: {
+            uint16_t len = fd->bit_length / 8;
+            return (len > 63) ? 63 : len;
+        }
+        case DATA_TYPE_HEX_STRING: {
+            uint16_t len = fd->bit_length / 8;
+            return (len > 31) ? 31 : len;
+        }
+        default:                    return 0;
+    }
+}
+
+static compiled_plan_t* compile(const data_definition_t *def)
+{
+    compiled_plan_t *plan = calloc(1, sizeof(compiled_plan_t));
+    if (!plan) return NULL;
+
+    plan->refs = 1;
+    plan->count = def->field_count;
+    plan->data_offset = def->data_offset;
+    plan->fields = calloc(def->field_count ? def->field_count : 1, sizeof(compiled_field_t));
+    plan->names = malloc((size_t)(def->field_count ? def->field_count : 1) * (MAX_FIELD_NAME_LEN - 1));
+    if (!plan->fields || !plan->names) {
+        free(plan->fields);
+        free(plan->names);
+        free(plan);
+        return NULL;
+    }
+
+    uint16_t name_off = 0;
+    for (uint8_t i = 0; i < def->field_count; i++) {
+        const field_definition_t *fd = &def->fields[i];
+        compiled_field_t *cf = &plan->fields[i];
+
+        // 16-bit 범위를 넘는 위치는 항상 범위 밖으로 (wrap 되어 다른 바이트를 읽지 않게)
+        uint32_t pos = (uint32_t)def->data_offset + fd->start_offset;
+        cf->pos = (pos > UINT16_MAX) ? UINT16_MAX : (uint16_t)pos;
+        cf->size = data_parser_field_size(fd);
+        cf->type = fd->field_type;
+        cf->bit_offset = fd->bit_offset;
+        cf->big_endian = (fd->byte_order != 0);
+        cf->scale = (fd->scale == 0) ? 1.0f : fd->scale;
+        cf->offset = fd->offset;
+        cf->scaled = (cf->scale != 1.0f || cf->offset != 0.0f) &&
+                     fd->field_type != DATA_TYPE_STRING &&
+                     fd->field_type != DATA_TYPE_HEX_STRING;
+
+        char name[MAX_FIELD_NAME_LEN];
+        data_parser_get_field_name(def, i, name, sizeof(name));
+        cf->name_off = name_off;
+        cf->name_len = strlen(name);
+        memcpy(&plan->names[name_off], name, cf->name_len);
+        name_off += cf->name_len;
+    }
+    return plan;
+}
+
+static void free_plan(compiled_plan_t *plan)
+{
+    if (!plan) return;
+    free(plan->fields);
+    free(plan->names);
+    free(plan);
+}
+
+static compiled_plan_t* acquire_plan(void)
+{
+    portENTER_CRITICAL(&s_plan_lock);
+    compiled_plan_t *plan = s_plan;
+    if (plan) plan->refs++;
+    portEXIT_CRITICAL(&s_plan_lock);
+    return plan;
+}
+
+static void release_plan(compiled_plan_t *plan)
+{
+    if (!plan) return;
+    portENTER_CRITICAL(&s_plan_lock);
+    bool last = (--plan->refs == 0);
+    portEXIT_CRITICAL(&s_plan_lock);
+    if (last) free_plan(plan);
+}
+
 /**
  * @brief 데이터 필드 정의 설정 (특허 청구항 2)
  * 
@@ -30,25 +196,37 @@ esp_err_t data_parser_init(void)
  * 
  * 이 함수 호출 시:
  * 1. 새로운 필드 정의가 메모리에 즉시 로드
- * 2. 다음 파싱 호출부터 새 정의 사용
+ * 2. 필드 추출기를 컴파일해 교체 - 다음 파싱 호출부터 새 정의 사용
  * 3. 재부팅 불필요
  */
 esp_err_t data_parser_set_definition(const data_definition_t *def)
 {
     if (!def) return ESP_ERR_INVALID_ARG;
-    
+    if (!s_def && data_parser_init() != ESP_OK) return ESP_ERR_NO_MEM;
+
+    compiled_plan_t *plan = compile(def);
+    if (!plan) {
+        ESP_LOGE(TAG, "Field extractor compile failed (%d fields)", def->field_count);
+        return ESP_ERR_NO_MEM;
+    }
+
     // 런타임 필드 정의 즉시 업데이트
-    memcpy(&s_def, def, sizeof(data_definition_t));
+    if (s_def != def) {
+        memcpy(s_def, def, sizeof(data_definition_t));
+    }
+    portENTER_CRITICAL(&s_plan_lock);
+    compiled_plan_t *old = s_plan;
+    s_plan = plan;
+    portEXIT_CRITICAL(&s_plan_lock);
+    release_plan(old);      // 파싱 중인 워커가 있으면 마지막 워커가 해제
     
     ESP_LOGI(TAG, "Field definition dynamically bound: %d fields, data_offset=%d", 
              def->field_count, def->data_offset);
     
     // 로그: 각 필드의 동적 바인딩 정보
     for (int i = 0; i < def->field_count && i < 8; i++) {
-        char name[MAX_FIELD_NAME_LEN];
-        data_parser_get_field_name(def, i, name, sizeof(name));
-        ESP_LOGI(TAG, "  Field[%d]: %s (type=0x%02X, offset=%d, %s endian)",
-                 i, name, 
+        ESP_LOGI(TAG, "  Field[%d]: %.*s (type=0x%02X, offset=%d, %s endian)",
+                 i, plan->fields[i].name_len, &plan->names[plan->fields[i].name_off],
                  def->fields[i].field_type,
                  def->fields[i].start_offset,
                  def->fields[i].byte_order ? "big" : "little");
@@ -59,7 +237,7 @@ esp_err_t data_parser_set_definition(const data_definition_t *def)
 
 const data_definition_t* data_parser_get_definition(void)
 {
-    return &s_def;
+    return s_def;
 }
 
 void data_parser_get_field_name(const data_definition_t *def,
@@ -87,122 +265,141 @@ void data_parser_get_field_name(const data_definition_t *def,
     }
 }
 
+const char* data_parser_type_name(data_type_t type)
+{
+    switch (type) {
+        case DATA_TYPE_BOOL:        return "BOOL";
+        case DATA_TYPE_UINT8:       return "UINT8";
+        case DATA_TYPE_INT8:        return "INT8";
+        case DATA_TYPE_UINT16:      return "UINT16";
+        case DATA_TYPE_INT16:       return "INT16";
+        case DATA_TYPE_UINT32:      return "UINT32";
+        case DATA_TYPE_INT32:       return "INT32";
+        case DATA_TYPE_UINT64:      return "UINT64";
+        case DATA_TYPE_INT64:       return "INT64";
+        case DATA_TYPE_FLOAT32:     return "FLOAT32";
+        case DATA_TYPE_FLOAT64:     return "FLOAT64";
+        case DATA_TYPE_STRING:      return "STRING";
+        case DATA_TYPE_TIMESTAMP:   return "TIMESTAMP";
+        default:                    return "UNKNOWN";
+    }
+}
+
 // 바이트 읽기 (엔디안 처리)
-static uint64_t read_bytes(const uint8_t *data, uint8_t offset,
-                           uint8_t size, bool big_endian)
+static uint64_t read_bytes(const uint8_t *p, uint8_t size, bool big_endian)
 {
     uint64_t value = 0;
     if (big_endian) {
         for (uint8_t i = 0; i < size; i++) {
-            value = (value << 8) | data[offset + i];
+            value = (value << 8) | p[i];
         }
     } else {
         for (uint8_t i = 0; i < size; i++) {
-            value |= ((uint64_t)data[offset + i]) << (i * 8);
+            value |= ((uint64_t)p[i]) << (i * 8);
         }
     }
     return value;
 }
 
-// 스케일링 적용
-static double apply_scale(double raw, const field_definition_t *field)
+static int parse_with_plan(const compiled_plan_t *plan, const uint8_t *raw_data, size_t raw_len,
+                           parsed_field_t *fields, uint8_t max_fields)
 {
-    double scale = field->scale_factor / 1000.0;
-    double offset = field->offset_value / 100.0;
-    if (scale == 0) scale = 1.0;
-    return (raw * scale) + offset;
-}
-
-int data_parser_parse_frame(const uint8_t *raw_data, size_t raw_len,
-                            parsed_field_t *fields, uint8_t max_fields)
-{
-    if (!raw_data || !fields || s_def.field_count == 0) {
+    if (!raw_data || !fields || !plan || plan->count == 0) {
         return -1;
     }
 
-    if (s_def.data_offset >= raw_len) {
+    if (plan->data_offset >= raw_len) {
         ESP_LOGW(TAG, "Data offset beyond frame");
         return -1;
     }
 
-    const uint8_t *data = raw_data + s_def.data_offset;
-    size_t data_len = raw_len - s_def.data_offset;
-
-    uint8_t count = (s_def.field_count < max_fields) ? 
-                    s_def.field_count : max_fields;
+    uint8_t count = (plan->count < max_fields) ? plan->count : max_fields;
 
     for (uint8_t i = 0; i < count; i++) {
-        const field_definition_t *fd = &s_def.fields[i];
+        const compiled_field_t *cf = &plan->fields[i];
         parsed_field_t *out = &fields[i];
 
-        data_parser_get_field_name(&s_def, i, out->name, MAX_FIELD_NAME_LEN);
-        out->type = (data_type_t)fd->field_type;
+        memcpy(out->name, &plan->names[cf->name_off], cf->name_len);
+        out->name[cf->name_len] = '\0';
+        out->type = (data_type_t)cf->type;
+        out->scaled_value = 0;
 
-        if (fd->start_offset >= data_len) {
+        if (cf->pos >= raw_len) {
             ESP_LOGW(TAG, "Field %d offset out of bounds", i);
+            memset(&out->value, 0, sizeof(out->value));
             continue;
         }
 
-        bool big_endian = (fd->byte_order != 0);
+        const uint8_t *p = raw_data + cf->pos;
+        size_t avail = raw_len - cf->pos;
         double raw_val = 0;
 
-        switch (fd->field_type) {
-            case DATA_TYPE_BOOL: {
-                uint8_t byte = data[fd->start_offset];
-                out->value.b = (byte >> fd->bit_offset) & 0x01;
+        // 고정 크기 타입이 프레임 끝을 넘으면 값 없음
+        if (cf->size > avail && cf->type != DATA_TYPE_BCD &&
+            cf->type != DATA_TYPE_STRING && cf->type != DATA_TYPE_HEX_STRING) {
+            ESP_LOGW(TAG, "Field %d exceeds frame", i);
+            memset(&out->value, 0, sizeof(out->value));
+            continue;
+        }
+        uint16_t size = (cf->size < avail) ? cf->size : (uint16_t)avail;
+
+        switch (cf->type) {
+            case DATA_TYPE_BOOL:
+                out->value.b = (p[0] >> cf->bit_offset) & 0x01;
                 raw_val = out->value.b ? 1.0 : 0.0;
                 break;
-            }
 
             case DATA_TYPE_UINT8:
-                out->value.u8 = data[fd->start_offset];
+                out->value.u8 = p[0];
                 raw_val = out->value.u8;
                 break;
 
             case DATA_TYPE_INT8:
-                out->value.i8 = (int8_t)data[fd->start_offset];
+                out->value.i8 = (int8_t)p[0];
                 raw_val = out->value.i8;
                 break;
 
             case DATA_TYPE_UINT16:
-                out->value.u16 = (uint16_t)read_bytes(data, fd->start_offset, 2, big_endian);
+                out->value.u16 = (uint16_t)read_bytes(p, 2, cf->big_endian);
                 raw_val = out->value.u16;
                 break;
 
             case DATA_TYPE_INT16:
-                out->value.i16 = (int16_t)read_bytes(data, fd->start_offset, 2, big_endian);
+                out->value.i16 = (int16_t)read_bytes(p, 2, cf->big_endian);
                 raw_val = out->value.i16;
                 break;
 
             case DATA_TYPE_UINT32:
-                out->value.u32 = (uint32_t)read_bytes(data, fd->start_offset, 4, big_endian);
+            case DATA_TYPE_TIMESTAMP:
+                out->value.u32 = (uint32_t)read_bytes(p, 4, cf->big_endian);
                 raw_val = out->value.u32;
                 break;
 
             case DATA_TYPE_INT32:
-                out->value.i32 = (int32_t)read_bytes(data, fd->start_offset, 4, big_endian);
+                out->value.i32 = (int32_t)read_bytes(p, 4, cf->big_endian);
                 raw_val = out->value.i32;
                 break;
 
             case DATA_TYPE_UINT64:
-                out->value.u64 = read_bytes(data, fd->start_offset, 8, big_endian);
+            case DATA_TYPE_TIMESTAMP_MS:
+                out->value.u64 = read_bytes(p, 8, cf->big_endian);
                 raw_val = (double)out->value.u64;
                 break;
 
             case DATA_TYPE_INT64:
-                out->value.i64 = (int64_t)read_bytes(data, fd->start_offset, 8, big_endian);
+                out->value.i64 = (int64_t)read_bytes(p, 8, cf->big_endian);
                 raw_val = (double)out->value.i64;
                 break;
 
             case DATA_TYPE_FLOAT32: {
-                uint32_t bits = (uint32_t)read_bytes(data, fd->start_offset, 4, big_endian);
+                uint32_t bits = (uint32_t)read_bytes(p, 4, cf->big_endian);
                 memcpy(&out->value.f32, &bits, sizeof(float));
                 raw_val = out->value.f32;
                 break;
             }
 
             case DATA_TYPE_FLOAT64: {
-                uint64_t bits = read_bytes(data, fd->start_offset, 8, big_endian);
+                uint64_t bits = read_bytes(p, 8, cf->big_endian);
                 memcpy(&out->value.f64, &bits, sizeof(double));
                 raw_val = out->value.f64;
                 break;
@@ -210,65 +407,47 @@ int data_parser_parse_frame(const uint8_t *raw_data, size_t raw_len,
 
             case DATA_TYPE_BCD: {
                 uint64_t result = 0;
-                uint8_t byte_len = (fd->bit_length + 7) / 8;
-                for (uint8_t j = 0; j < byte_len && fd->start_offset + j < data_len; j++) {
-                    uint8_t byte = data[fd->start_offset + j];
-                    result = result * 100 + ((byte >> 4) * 10 + (byte & 0x0F));
+                for (uint16_t j = 0; j < size; j++) {
+                    result = result * 100 + ((p[j] >> 4) * 10 + (p[j] & 0x0F));
                 }
                 out->value.u64 = result;
                 raw_val = (double)result;
                 break;
             }
 
-            case DATA_TYPE_STRING: {
-                uint8_t str_len = fd->bit_length / 8;
-                if (str_len > 63) str_len = 63;
-                if (fd->start_offset + str_len > data_len) {
-                    str_len = data_len - fd->start_offset;
-                }
-                memcpy(out->value.str, &data[fd->start_offset], str_len);
-                out->value.str[str_len] = '\0';
-                raw_val = 0;
-                break;
-            }
+            case DATA_TYPE_STRING:
+                memcpy(out->value.str, p, size);
+                out->value.str[size] = '\0';
+                continue;
 
-            case DATA_TYPE_HEX_STRING: {
-                uint8_t byte_len = fd->bit_length / 8;
-                if (byte_len > 31) byte_len = 31;
-                for (uint8_t j = 0; j < byte_len && fd->start_offset + j < data_len; j++) {
-                    sprintf(&out->value.str[j * 2], "%02X", data[fd->start_offset + j]);
+            case DATA_TYPE_HEX_STRING:
+                for (uint16_t j = 0; j < size; j++) {
+                    out->value.str[j * 2] = "0123456789ABCDEF"[p[j] >> 4];
+                    out->value.str[j * 2 + 1] = "0123456789ABCDEF"[p[j] & 0x0F];
                 }
-                out->value.str[byte_len * 2] = '\0';
-                raw_val = 0;
-                break;
-            }
-
-            case DATA_TYPE_TIMESTAMP:
-                out->value.u32 = (uint32_t)read_bytes(data, fd->start_offset, 4, big_endian);
-                raw_val = out->value.u32;
-                break;
-
-            case DATA_TYPE_TIMESTAMP_MS:
-                out->value.u64 = read_bytes(data, fd->start_offset, 8, big_endian);
-                raw_val = (double)out->value.u64;
-                break;
+                out->value.str[size * 2] = '\0';
+                continue;
 
             default:
-                ESP_LOGW(TAG, "Unknown type: 0x%02X", fd->field_type);
-                raw_val = 0;
+                ESP_LOGW(TAG, "Unknown type: 0x%02X", cf->type);
                 break;
         }
 
-        // 스케일링 (문자열 제외)
-        if (fd->field_type != DATA_TYPE_STRING && 
-            fd->field_type != DATA_TYPE_HEX_STRING) {
-            out->scaled_value = apply_scale(raw_val, fd);
-        } else {
-            out->scaled_value = 0;
-        }
+        // 스케일링 (문자열 제외, scale 1 / offset 0이면 생략)
+        out->scaled_value = cf->scaled ? (raw_val * cf->scale) + cf->offset : raw_val;
 
         ESP_LOGD(TAG, "[%d] %s: %.2f", i, out->name, out->scaled_value);
     }
 
     return count;
 }
+
+int data_parser_parse_frame(const uint8_t *raw_data, size_t raw_len,
+                            parsed_field_t *fields, uint8_t max_fields)
+{
+    // 파싱 동안 plan 참조 유지 (정의 교체와 동시에 실행될 수 있음)
+    compiled_plan_t *plan = acquire_plan();
+    int count = parse_with_plan(plan, raw_data, raw_len, fields, max_fields);
+    release_plan(plan);
+    return count;
+}
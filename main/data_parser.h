@@ -19,12 +19,28 @@ extern "C" {
 esp_err_t data_parser_init(void);
 
 /**
- * @brief 필드 정의 설정
+ * @brief 필드 정의 버퍼 할당 (PSRAM 우선, 0으로 초기화, free()로 해제)
+ */
+data_definition_t* data_parser_alloc_definition(void);
+
+/**
+ * @brief v1 필드 정의 (고정 소수점, 8-bit offset) → 메모리 표현
+ */
+void data_parser_field_from_v1(const field_definition_v1_t *v1, field_definition_t *fd);
+
+/**
+ * @brief 필드가 프레임에서 읽는 바이트 수 (문자열/BCD는 bit_length 기준, 알 수 없는 타입은 0)
+ */
+uint16_t data_parser_field_size(const field_definition_t *fd);
+
+/**
+ * @brief 필드 정의 설정 (필드 추출기를 컴파일해 교체)
+ * @return ESP_OK, ESP_ERR_NO_MEM (기존 정의 유지)
  */
 esp_err_t data_parser_set_definition(const data_definition_t *def);
 
 /**
- * @brief 현재 필드 정의 반환
+ * @brief 현재 필드 정의 반환 (PSRAM)
  */
 const data_definition_t* data_parser_get_definition(void);
 
@@ -45,6 +61,11 @@ int data_parser_parse_frame(const uint8_t *raw_data, size_t raw_len,
 void data_parser_get_field_name(const data_definition_t *def,
                                 uint8_t index, char *name, size_t max_len);
 
+/**
+ * @brief 데이터 타입 이름 (MQTT "type" 문자열)
+ */
+const char* data_parser_type_name(data_type_t type);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,153 @@
+/**
+ * @file encode_utils.c
+ * @brief Table-based Hex / Base64 Encoders, LZSS Compressor Implementation
+ *
+ * Hex는 바이트당 2문자를 256 x 2 테이블에서 한 번에 복사한다.
+ * LZSS는 3바이트 해시 체인으로 후보 위치만 비교한다 (체인 길이 제한).
+ */
+
+#include "encode_utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LZSS_WINDOW         4096
+#define LZSS_MIN_MATCH      3
+#define LZSS_MAX_MATCH      18
+#define LZSS_HASH_BITS      12
+#define LZSS_MAX_CHAIN      32
+
+// "000102...FEFF"
+static const char s_hex_pairs[513] =
+    "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+static const char s_b64_chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+size_t encode_hex(const uint8_t *in, size_t len, char *out)
+{
+    if (!in || !out) return 0;
+
+    for (size_t i = 0; i < len; i++) {
+        memcpy(&out[i * 2], &s_hex_pairs[in[i] * 2], 2);
+    }
+    return len * 2;
+}
+
+size_t encode_base64(const uint8_t *in, size_t len, char *out)
+{
+    if (!in || !out) return 0;
+
+    char *p = out;
+    size_t i = 0;
+
+    for (; i + 2 < len; i += 3) {
+        uint32_t v = ((uint32_t)in[i] << 16) | ((uint32_t)in[i + 1] << 8) | in[i + 2];
+        *p++ = s_b64_chars[(v >> 18) & 0x3F];
+        *p++ = s_b64_chars[(v >> 12) & 0x3F];
+        *p++ = s_b64_chars[(v >> 6) & 0x3F];
+        *p++ = s_b64_chars[v & 0x3F];
+    }
+
+    if (i < len) {
+        uint32_t v = (uint32_t)in[i] << 16;
+        if (i + 1 < len) v |= (uint32_t)in[i + 1] << 8;
+
+        *p++ = s_b64_chars[(v >> 18) & 0x3F];
+        *p++ = s_b64_chars[(v >> 12) & 0x3F];
+        *p++ = (i + 1 < len) ? s_b64_chars[(v >> 6) & 0x3F] : '=';
+        *p++ = '=';
+    }
+
+    return (size_t)(p - out);
+}
+
+static inline uint32_t lzss_hash(const uint8_t *p)
+{
+    return ((p[0] << 8) ^ (p[1] << 4) ^ p[2]) & ((1 << LZSS_HASH_BITS) - 1);
+}
+
+size_t encode_lzss(const uint8_t *in, size_t len, uint8_t *out, size_t out_size)
+{
+    if (!in || !out) return 0;
+
+    int32_t *head = malloc(sizeof(int32_t) * (1 << LZSS_HASH_BITS));
+    int32_t *prev = malloc(sizeof(int32_t) * LZSS_WINDOW);
+    if (!head || !prev) {
+        free(head);
+        free(prev);
+        return 0;
+    }
+    memset(head, 0xFF, sizeof(int32_t) * (1 << LZSS_HASH_BITS));
+
+    size_t o = 0;
+    size_t flag_pos = 0;
+    uint8_t flag_bit = 8;
+    size_t i = 0;
+
+    while (i < len) {
+        if (flag_bit == 8) {
+            if (o >= out_size) goto overflow;
+            flag_pos = o++;
+            out[flag_pos] = 0;
+            flag_bit = 0;
+        }
+
+        // 해시 체인에서 가장 긴 일치 탐색
+        size_t best_len = 0;
+        size_t best_dist = 0;
+        if (i + LZSS_MIN_MATCH <= len) {
+            size_t max = len - i;
+            if (max > LZSS_MAX_MATCH) max = LZSS_MAX_MATCH;
+            int32_t cand = head[lzss_hash(&in[i])];
+            int chain = LZSS_MAX_CHAIN;
+            while (cand >= 0 && i - (size_t)cand <= LZSS_WINDOW && chain-- > 0) {
+                size_t l = 0;
+                while (l < max && in[cand + l] == in[i + l]) l++;
+                if (l > best_len) {
+                    best_len = l;
+                    best_dist = i - cand;
+                    if (l == max) break;
+                }
+                cand = prev[cand % LZSS_WINDOW];
+            }
+        }
+
+        size_t step;
+        if (best_len >= LZSS_MIN_MATCH) {
+            if (o + 2 > out_size) goto overflow;
+            out[o++] = (best_dist - 1) & 0xFF;
+            out[o++] = (((best_dist - 1) >> 8) << 4) | (best_len - LZSS_MIN_MATCH);
+            step = best_len;
+        } else {
+            if (o >= out_size) goto overflow;
+            out[flag_pos] |= 1 << flag_bit;
+            out[o++] = in[i];
+            step = 1;
+        }
+        flag_bit++;
+
+        for (size_t end = i + step; i < end; i++) {
+            if (i + LZSS_MIN_MATCH <= len) {
+                uint32_t h = lzss_hash(&in[i]);
+                prev[i % LZSS_WINDOW] = head[h];
+                head[h] = (int32_t)i;
+            }
+        }
+    }
+
+    free(head);
+    free(prev);
+    return o;
+
+overflow:
+    free(head);
+    free(prev);
+    return 0;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file encode_utils.h
+ * @brief Table-based Hex / Base64 Encoders, LZSS Compressor
+ */
+
+#ifndef ENCODE_UTILS_H
+#define ENCODE_UTILS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Hex 인코딩 출력 길이 (null 제외)
+ */
+#define ENCODE_HEX_LEN(n)       ((n) * 2)
+
+/**
+ * @brief Base64 인코딩 출력 길이 (padding 포함, null 제외)
+ */
+#define ENCODE_BASE64_LEN(n)    ((((n) + 2) / 3) * 4)
+
+/**
+ * @brief 대문자 Hex 인코딩 (null 종료하지 않음)
+ * @param in 입력
+ * @param len 입력 길이
+ * @param out 출력 (ENCODE_HEX_LEN(len) 이상)
+ * @return 기록된 문자 수
+ */
+size_t encode_hex(const uint8_t *in, size_t len, char *out);
+
+/**
+ * @brief 표준 Base64 인코딩 (RFC 4648, padding 포함, null 종료하지 않음)
+ * @param in 입력
+ * @param len 입력 길이
+ * @param out 출력 (ENCODE_BASE64_LEN(len) 이상)
+ * @return 기록된 문자 수
+ */
+size_t encode_base64(const uint8_t *in, size_t len, char *out);
+
+/**
+ * @brief LZSS 압축 출력 최대 길이 (압축 불가 입력: 8바이트당 flag 1바이트)
+ */
+#define ENCODE_LZSS_MAX_LEN(n)  ((n) + ((n) + 7) / 8)
+
+/**
+ * @brief LZSS 압축 (window 4096, 일치 길이 3~18)
+ *
+ * flag 바이트 1개가 뒤따르는 8개 항목을 LSB부터 나타낸다.
+ * bit=1: literal 1바이트 / bit=0: 일치 2바이트
+ *   byte0 = (distance-1) & 0xFF, byte1 = ((distance-1) >> 8) << 4 | (length-3)
+ * @param in 입력
+ * @param len 입력 길이
+ * @param out 출력
+ * @param out_size 출력 버퍼 크기 (ENCODE_LZSS_MAX_LEN(len) 이상이면 항상 성공)
+ * @return 압축 길이, 출력이 넘치거나 작업 메모리 할당 실패 시 0
+ */
+size_t encode_lzss(const uint8_t *in, size_t len, uint8_t *out, size_t out_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ENCODE_UTILS_H
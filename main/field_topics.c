@@ -0,0 +1,190 @@
+/**
+ * @file field_topics.c
+ * @brief Per-field Topic Publisher Implementation
+ *
+ * 변경 감지: 필드별 직전 발행 payload 사본과 바이트 비교 (해시 충돌로 변경을 놓치지 않음).
+ * 발행은 MQTT sink 태스크에서만 일어나며, 토픽 테이블 교체/이력 초기화와는
+ * mutex로 직렬화한다.
+ */
+
+#include "field_topics.h"
+#include "mqtt_handler.h"
+#include "json_template.h"
+#include "data_parser.h"
+#include "stats.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "FieldTopics";
+
+// payload 최대 길이: 문자열 필드 크기 (숫자 포맷은 JSON_TEMPLATE_NUMBER_MAX_LEN으로 더 짧음)
+#define PAYLOAD_MAX     sizeof(((field_value_t *)0)->str)
+
+typedef struct {
+    uint8_t len;
+    char data[PAYLOAD_MAX];
+} last_payload_t;
+
+static field_topic_config_t s_config = {
+    .enable = 0,
+    .qos = 0,
+    .retain = 0,
+};
+static SemaphoreHandle_t s_mutex = NULL;
+
+// 데이터 정의 기준 사전 계산 토픽 (NULL = 미설정)
+static char *s_topics[MAX_FIELD_COUNT];
+static uint8_t s_topic_count = 0;
+
+// 변경 감지 (필드별 직전 payload, PSRAM)
+static last_payload_t *s_last = NULL;
+static bool s_has_last[MAX_FIELD_COUNT];       // s_last 유효 여부
+
+static stats_id_t s_stat_published = STATS_INVALID_ID;
+
+static void ensure_init(void)
+{
+    if (!s_mutex) {
+        s_mutex = xSemaphoreCreateMutex();
+    }
+    if (!s_last) {
+        s_last = heap_caps_calloc(MAX_FIELD_COUNT, sizeof(last_payload_t), MALLOC_CAP_SPIRAM);
+        if (!s_last) s_last = calloc(MAX_FIELD_COUNT, sizeof(last_payload_t));
+    }
+    if (s_stat_published == STATS_INVALID_ID) {
+        s_stat_published = stats_register("fields.published", STATS_COUNTER);
+    }
+}
+
+// MQTT 와일드카드/구분자는 토픽 레벨 이름에 쓸 수 없음
+static void sanitize_level(char *name)
+{
+    for (char *p = name; *p; p++) {
+        if (*p == '/' || *p == '+' || *p == '#') *p = '_';
+    }
+}
+
+static void free_topics(void)
+{
+    for (uint8_t i = 0; i < s_topic_count; i++) {
+        free(s_topics[i]);
+        s_topics[i] = NULL;
+    }
+    s_topic_count = 0;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+void field_topics_set_config(const field_topic_config_t *config)
+{
+    field_topic_config_t cfg = {0};
+    if (config) {
+        memcpy(&cfg, config, sizeof(field_topic_config_t));
+    }
+    if (cfg.qos > 2) cfg.qos = DEFAULT_MQTT_QOS;
+
+    ensure_init();
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    memcpy(&s_config, &cfg, sizeof(field_topic_config_t));
+    memset(s_has_last, 0, sizeof(s_has_last));  // 대상/retain 변경 → 다음 record에서 전체 재발행
+    xSemaphoreGive(s_mutex);
+
+    ESP_LOGI(TAG, "Config: enable=%d qos=%d retain=%d mask=0x%016llX",
+             cfg.enable, cfg.qos, cfg.retain, (unsigned long long)cfg.field_mask);
+}
+
+const field_topic_config_t* field_topics_get_config(void)
+{
+    return &s_config;
+}
+
+void field_topics_set_definition(const data_definition_t *def)
+{
+    if (!def) return;
+
+    ensure_init();
+    const mqtt_config_data_t *mqtt = mqtt_handler_get_config();
+    bool ids_set = (strlen(mqtt->user_id) > 0 && strlen(mqtt->device_id) > 0);
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    free_topics();
+    memset(s_has_last, 0, sizeof(s_has_last));
+
+    if (ids_set) {
+        for (uint8_t i = 0; i < def->field_count; i++) {
+            char name[MAX_FIELD_NAME_LEN];
+            char suffix[sizeof(FIELD_TOPICS_SUFFIX) + MAX_FIELD_NAME_LEN];
+            char topic[256];
+
+            data_parser_get_field_name(def, i, name, sizeof(name));
+            sanitize_level(name);
+            snprintf(suffix, sizeof(suffix), FIELD_TOPICS_SUFFIX "/%s", name);
+            mqtt_handler_build_topic(topic, sizeof(topic), suffix);
+
+            s_topics[i] = strdup(topic);
+            if (!s_topics[i]) {
+                ESP_LOGE(TAG, "Out of memory building topics");
+                s_topic_count = i;
+                free_topics();
+                break;
+            }
+            s_topic_count = i + 1;
+        }
+    }
+    xSemaphoreGive(s_mutex);
+
+    ESP_LOGI(TAG, "Prepared %d field topics", s_topic_count);
+}
+
+void field_topics_publish(const parsed_field_t *fields, uint8_t field_count)
+{
+    if (!s_config.enable || !fields || !s_mutex || !s_last) return;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+
+    uint8_t count = (field_count < s_topic_count) ? field_count : s_topic_count;
+    for (uint8_t i = 0; i < count; i++) {
+        // 선택 mask는 앞 FIELD_MASK_BITS개 필드만 - 그 뒤 필드는 항상 발행
+        if (s_config.field_mask && i < FIELD_MASK_BITS &&
+            !(s_config.field_mask & FIELD_MASK_BIT(i))) continue;
+
+        // 스칼라 payload: 숫자는 data 토픽의 value와 같은 포맷, 문자열은 그대로
+        char num[JSON_TEMPLATE_NUMBER_MAX_LEN];
+        const char *payload;
+        size_t len;
+        if (fields[i].type == DATA_TYPE_STRING || fields[i].type == DATA_TYPE_HEX_STRING) {
+            payload = fields[i].value.str;
+            len = strnlen(payload, sizeof(fields[i].value.str));
+        } else {
+            len = (size_t)json_template_format_number(num, fields[i].scaled_value);
+            payload = num;
+        }
+
+        if (len > PAYLOAD_MAX) len = PAYLOAD_MAX;
+        last_payload_t *last = &s_last[i];
+        if (s_has_last[i] && last->len == len && memcmp(last->data, payload, len) == 0) continue;
+
+        if (mqtt_handler_publish_topic(s_topics[i], payload, len,
+                                       s_config.qos, s_config.retain) == ESP_OK) {
+            last->len = (uint8_t)len;
+            memcpy(last->data, payload, len);
+            s_has_last[i] = true;
+            stats_inc(s_stat_published);
+        }
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+void field_topics_on_mqtt_state(bool connected)
+{
+    // 재연결 시 비-retain 구독자도 현재 값을 받도록 변경 이력 초기화
+    if (connected && s_mutex) {
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        memset(s_has_last, 0, sizeof(s_has_last));
+        xSemaphoreGive(s_mutex);
+    }
+}
@@ -0,0 +1,59 @@
+/**
+ * @file field_topics.h
+ * @brief Per-field Topic Publisher (Unified Namespace)
+ *
+ * 각 필드(또는 설정된 일부)를 {base}/fields/{name} 토픽에 스칼라 payload로
+ * 발행한다. 값이 바뀔 때만 발행하며 retain 옵션을 지원한다.
+ * 단일 값만 필요한 구독자가 전체 data JSON을 받아 디코딩할 필요가 없다.
+ * 토픽 문자열은 데이터 정의/MQTT ID 변경 시점에 미리 만들어 둔다.
+ */
+
+#ifndef FIELD_TOPICS_H
+#define FIELD_TOPICS_H
+
+#include "protocol_def.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FIELD_TOPICS_SUFFIX     "fields"
+
+/**
+ * @brief 설정 적용
+ * @param config 설정 (NULL이면 기본값: 비활성)
+ */
+void field_topics_set_config(const field_topic_config_t *config);
+
+/**
+ * @brief 현재 설정 반환
+ */
+const field_topic_config_t* field_topics_get_config(void);
+
+/**
+ * @brief 데이터 정의 기준으로 필드별 토픽 재계산
+ *
+ * mqtt_handler_set_data_definition()에서 호출된다 (device_id/user_id 변경 포함).
+ * @param def 데이터 정의
+ */
+void field_topics_set_definition(const data_definition_t *def);
+
+/**
+ * @brief 파싱 결과 중 값이 바뀐 필드를 각 토픽에 발행 (MQTT sink에서 호출)
+ * @param fields 파싱된 필드
+ * @param field_count 필드 수
+ */
+void field_topics_publish(const parsed_field_t *fields, uint8_t field_count);
+
+/**
+ * @brief MQTT 연결 상태 변경 알림 (재연결 시 전체 값을 다시 발행)
+ * @param connected true if connected
+ */
+void field_topics_on_mqtt_state(bool connected);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FIELD_TOPICS_H
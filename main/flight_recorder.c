@@ -0,0 +1,337 @@
+/**
+ * @file flight_recorder.c
+ * @brief Black-box Flight Recorder Implementation
+ *
+ * 기록은 UART RX 태스크와 파서 워커에서 s_lock 안에서 ring에 이어 쓰며,
+ * 공간이 부족하면 가장 오래된 record부터 밀어낸다.
+ * 덤프 중에는 ring을 동결(기록 무시)하므로 덤프 태스크는 잠금 없이 읽는다.
+ */
+
+#include "flight_recorder.h"
+#include "mqtt_handler.h"
+#include "encode_utils.h"
+#include "stats.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "Flight";
+
+#define REC_HDR_LEN         7       // type(1) t_ms(4) len(2)
+#define REC_DATA_MAX        256
+#define DUMP_HDR_LEN        10
+#define DUMP_PART_GAP_MS    50
+
+static flight_config_t s_config = {
+    .enable = 1,
+    .window_s = DEFAULT_FLIGHT_WINDOW_S,
+    .crc_threshold = DEFAULT_FLIGHT_CRC_THRESH,
+    .parse_threshold = DEFAULT_FLIGHT_PARSE_THRESH,
+    .cooldown_s = DEFAULT_FLIGHT_COOLDOWN_S,
+};
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Ring (PSRAM)
+static uint8_t *s_ring = NULL;
+static size_t s_head = 0;           // 다음 기록 위치
+static size_t s_tail = 0;           // 가장 오래된 record
+static size_t s_used = 0;
+static bool s_frozen = false;
+
+// 트리거 카운트 (초 단위 구간)
+static uint16_t s_crc_now = 0;
+static uint16_t s_parse_now = 0;
+static uint16_t s_crc_buckets[FLIGHT_TRIGGER_WINDOW_S];
+static uint16_t s_parse_buckets[FLIGHT_TRIGGER_WINDOW_S];
+static uint8_t s_bucket_idx = 0;
+
+static int64_t s_last_dump_us = 0;
+static uint16_t s_dump_id = 0;
+
+static stats_id_t s_stat_dumps = STATS_INVALID_ID;
+static stats_id_t s_stat_bytes = STATS_INVALID_ID;
+
+/*******************************************************************************
+ * Ring
+ ******************************************************************************/
+static void ring_write(size_t pos, const void *src, size_t n)
+{
+    size_t first = FLIGHT_RING_SIZE - pos;
+    if (first > n) first = n;
+    memcpy(&s_ring[pos], src, first);
+    memcpy(s_ring, (const uint8_t *)src + first, n - first);
+}
+
+static void ring_read(size_t pos, void *dst, size_t n)
+{
+    size_t first = FLIGHT_RING_SIZE - pos;
+    if (first > n) first = n;
+    memcpy(dst, &s_ring[pos], first);
+    memcpy((uint8_t *)dst + first, s_ring, n - first);
+}
+
+static uint16_t ring_rec_len(size_t pos)
+{
+    uint16_t len;
+    ring_read((pos + 5) % FLIGHT_RING_SIZE, &len, sizeof(len));
+    return len;
+}
+
+static void record(uint8_t type, const void *data, size_t len)
+{
+    if (len > REC_DATA_MAX) len = REC_DATA_MAX;
+
+    uint8_t hdr[REC_HDR_LEN];
+    uint32_t t_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    uint16_t len16 = (uint16_t)len;
+    hdr[0] = type;
+    memcpy(&hdr[1], &t_ms, sizeof(t_ms));
+    memcpy(&hdr[5], &len16, sizeof(len16));
+    size_t need = REC_HDR_LEN + len;
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_frozen) {
+        portEXIT_CRITICAL(&s_lock);
+        return;
+    }
+    while (s_used + need > FLIGHT_RING_SIZE) {
+        size_t old = REC_HDR_LEN + ring_rec_len(s_tail);
+        s_tail = (s_tail + old) % FLIGHT_RING_SIZE;
+        s_used -= old;
+    }
+    ring_write(s_head, hdr, REC_HDR_LEN);
+    if (len > 0) ring_write((s_head + REC_HDR_LEN) % FLIGHT_RING_SIZE, data, len);
+    s_head = (s_head + need) % FLIGHT_RING_SIZE;
+    s_used += need;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+/*******************************************************************************
+ * Dump
+ ******************************************************************************/
+static esp_err_t publish_part(const char *topic, uint8_t reason, uint16_t part, bool last,
+                              const uint8_t *block, size_t block_len, uint8_t *out)
+{
+    uint8_t *body = &out[DUMP_HDR_LEN];
+    size_t body_len = encode_lzss(block, block_len, body, ENCODE_LZSS_MAX_LEN(block_len));
+    uint8_t flags = last ? FLIGHT_FLAG_LAST : 0;
+    if (body_len > 0 && body_len < block_len) {
+        flags |= FLIGHT_FLAG_LZSS;
+    } else {
+        memcpy(body, block, block_len);
+        body_len = block_len;
+    }
+
+    uint16_t raw_len = (uint16_t)block_len;
+    out[0] = FLIGHT_DUMP_MAGIC;
+    out[1] = FLIGHT_DUMP_VERSION;
+    memcpy(&out[2], &s_dump_id, 2);
+    memcpy(&out[4], &part, 2);
+    out[6] = flags;
+    out[7] = reason;
+    memcpy(&out[8], &raw_len, 2);
+
+    esp_err_t ret = mqtt_handler_publish_topic(topic, (const char *)out,
+                                               DUMP_HDR_LEN + body_len, 1, false);
+    if (ret == ESP_OK) {
+        stats_add(s_stat_bytes, DUMP_HDR_LEN + body_len);
+    }
+    return ret;
+}
+
+static void dump_task(void *arg)
+{
+    uint8_t reason = (uint8_t)(uintptr_t)arg;
+    uint8_t *block = malloc(FLIGHT_BLOCK_SIZE);
+    uint8_t *out = malloc(DUMP_HDR_LEN + ENCODE_LZSS_MAX_LEN(FLIGHT_BLOCK_SIZE));
+    char topic[256];
+    mqtt_handler_build_topic(topic, sizeof(topic), "diag/flight");
+
+    uint32_t start_ms = (uint32_t)(esp_timer_get_time() / 1000) - (uint32_t)s_config.window_s * 1000;
+    size_t pos = s_tail;
+    size_t remaining = s_used;
+    size_t block_len = 0;
+    uint16_t part = 0;
+    esp_err_t ret = (block && out) ? ESP_OK : ESP_ERR_NO_MEM;
+
+    ESP_LOGW(TAG, "Dump %u (reason=%d, %d bytes in ring)", s_dump_id, reason, s_used);
+
+    while (ret == ESP_OK && remaining > 0) {
+        uint8_t hdr[REC_HDR_LEN];
+        ring_read(pos, hdr, REC_HDR_LEN);
+        uint32_t t_ms;
+        uint16_t len;
+        memcpy(&t_ms, &hdr[1], sizeof(t_ms));
+        memcpy(&len, &hdr[5], sizeof(len));
+        size_t rec_len = REC_HDR_LEN + len;
+
+        // window 이전 record 건너뜀
+        if ((int32_t)(t_ms - start_ms) >= 0) {
+            if (block_len + rec_len > FLIGHT_BLOCK_SIZE) {
+                ret = publish_part(topic, reason, part++, false, block, block_len, out);
+                block_len = 0;
+                vTaskDelay(pdMS_TO_TICKS(DUMP_PART_GAP_MS));
+            }
+            ring_read(pos, &block[block_len], rec_len);
+            block_len += rec_len;
+        }
+
+        pos = (pos + rec_len) % FLIGHT_RING_SIZE;
+        remaining -= rec_len;
+    }
+
+    if (ret == ESP_OK) {
+        ret = publish_part(topic, reason, part++, true, block, block_len, out);
+    }
+
+    if (ret == ESP_OK) {
+        stats_inc(s_stat_dumps);
+        ESP_LOGI(TAG, "Dump %u published: %d parts", s_dump_id, part);
+    } else {
+        ESP_LOGE(TAG, "Dump %u failed: %s", s_dump_id, esp_err_to_name(ret));
+    }
+    free(block);
+    free(out);
+
+    s_dump_id++;
+    portENTER_CRITICAL(&s_lock);
+    s_frozen = false;
+    portEXIT_CRITICAL(&s_lock);
+
+    vTaskDelete(NULL);
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+esp_err_t flight_recorder_init(void)
+{
+    if (s_ring) return ESP_OK;
+
+    s_ring = heap_caps_malloc(FLIGHT_RING_SIZE, MALLOC_CAP_SPIRAM);
+    if (!s_ring) {
+        ESP_LOGW(TAG, "PSRAM not available, flight recorder disabled");
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_stat_dumps = stats_register("flight.dumps", STATS_COUNTER);
+    s_stat_bytes = stats_register("flight.bytes", STATS_COUNTER);
+    ESP_LOGI(TAG, "Initialized: %d KB ring", FLIGHT_RING_SIZE / 1024);
+    return ESP_OK;
+}
+
+void flight_recorder_set_config(const flight_config_t *config)
+{
+    flight_config_t cfg = {
+        .enable = 1,
+        .window_s = DEFAULT_FLIGHT_WINDOW_S,
+        .crc_threshold = DEFAULT_FLIGHT_CRC_THRESH,
+        .parse_threshold = DEFAULT_FLIGHT_PARSE_THRESH,
+        .cooldown_s = DEFAULT_FLIGHT_COOLDOWN_S,
+    };
+    if (config) {
+        memcpy(&cfg, config, sizeof(flight_config_t));
+    }
+    if (cfg.window_s == 0) cfg.window_s = DEFAULT_FLIGHT_WINDOW_S;
+
+    portENTER_CRITICAL(&s_lock);
+    memcpy(&s_config, &cfg, sizeof(flight_config_t));
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "Config: enable=%d window=%ds crc>=%d parse>=%d cooldown=%ds",
+             cfg.enable, cfg.window_s, cfg.crc_threshold, cfg.parse_threshold, cfg.cooldown_s);
+}
+
+const flight_config_t* flight_recorder_get_config(void)
+{
+    return &s_config;
+}
+
+void flight_recorder_on_rx(const uint8_t *data, size_t len)
+{
+    if (!s_ring || !s_config.enable) return;
+    record(FLIGHT_REC_RX, data, len);
+}
+
+void flight_recorder_on_frame(size_t len, bool crc_valid)
+{
+    if (!s_ring || !s_config.enable) return;
+
+    uint8_t data[3] = { len & 0xFF, (len >> 8) & 0xFF, crc_valid ? 1 : 0 };
+    record(FLIGHT_REC_FRAME, data, sizeof(data));
+    if (!crc_valid) {
+        portENTER_CRITICAL(&s_lock);
+        s_crc_now++;
+        portEXIT_CRITICAL(&s_lock);
+    }
+}
+
+void flight_recorder_on_event(uint8_t code)
+{
+    if (!s_ring || !s_config.enable) return;
+    record(FLIGHT_REC_EVENT, &code, 1);
+}
+
+void flight_recorder_on_parse_failure(void)
+{
+    if (!s_ring || !s_config.enable) return;
+
+    record(FLIGHT_REC_PARSE_FAIL, NULL, 0);
+    portENTER_CRITICAL(&s_lock);
+    s_parse_now++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void flight_recorder_tick(void)
+{
+    if (!s_ring || !s_config.enable) return;
+
+    portENTER_CRITICAL(&s_lock);
+    s_crc_buckets[s_bucket_idx] = s_crc_now;
+    s_parse_buckets[s_bucket_idx] = s_parse_now;
+    s_crc_now = 0;
+    s_parse_now = 0;
+    bool frozen = s_frozen;
+    portEXIT_CRITICAL(&s_lock);
+    s_bucket_idx = (s_bucket_idx + 1) % FLIGHT_TRIGGER_WINDOW_S;
+
+    if (frozen) return;
+
+    uint32_t crc_errors = 0, parse_failures = 0;
+    for (int i = 0; i < FLIGHT_TRIGGER_WINDOW_S; i++) {
+        crc_errors += s_crc_buckets[i];
+        parse_failures += s_parse_buckets[i];
+    }
+
+    uint8_t reason = 0;
+    if (s_config.crc_threshold > 0 && crc_errors >= s_config.crc_threshold) {
+        reason = FLIGHT_REASON_CRC;
+    } else if (s_config.parse_threshold > 0 && parse_failures >= s_config.parse_threshold) {
+        reason = FLIGHT_REASON_PARSE;
+    }
+    if (!reason) return;
+
+    int64_t now_us = esp_timer_get_time();
+    if (s_last_dump_us != 0 && now_us - s_last_dump_us < (int64_t)s_config.cooldown_s * 1000000) {
+        return;
+    }
+    // 미연결이면 계속 기록하고 연결 후 조건이 유지되면 덤프
+    if (!mqtt_handler_is_connected()) return;
+
+    portENTER_CRITICAL(&s_lock);
+    s_frozen = true;
+    portEXIT_CRITICAL(&s_lock);
+    s_last_dump_us = now_us;
+
+    if (xTaskCreate(dump_task, "flight_dump", TASK_STACK_FLIGHT,
+                    (void *)(uintptr_t)reason, TASK_PRIORITY_FLIGHT, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create dump task");
+        portENTER_CRITICAL(&s_lock);
+        s_frozen = false;
+        portEXIT_CRITICAL(&s_lock);
+    }
+}
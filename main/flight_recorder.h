@@ -0,0 +1,91 @@
+/**
+ * @file flight_recorder.h
+ * @brief Black-box Flight Recorder of Recent Raw Traffic
+ *
+ * 최근 원시 수신 바이트와 프레이밍 판정, 라인 오류, 파싱 실패를 PSRAM ring에 계속 기록한다.
+ * CRC 오류 또는 파싱 실패가 트리거 구간(FLIGHT_TRIGGER_WINDOW_S) 안에 임계값을 넘으면
+ * ring을 동결하고 최근 window_s 초 분량을 LZSS 압축해 {base}/diag/flight 에 발행한다.
+ *
+ * 메시지 형식 (little endian):
+ *   header : 'F'(1) version(1) dump_id(2) part(2) flags(1) reason(1) raw_len(2)
+ *            flags bit0 = 마지막 part, bit1 = LZSS 압축 (encode_lzss 형식)
+ *   body   : raw_len 바이트로 풀리는 record 열
+ *   record : type(1) t_ms(4, 부팅 후 ms) len(2) data(len)
+ */
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include "protocol_def.h"
+#include "esp_err.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLIGHT_DUMP_MAGIC       0x46    // 'F'
+#define FLIGHT_DUMP_VERSION     1
+#define FLIGHT_FLAG_LAST        0x01
+#define FLIGHT_FLAG_LZSS        0x02
+
+// Record type
+typedef enum {
+    FLIGHT_REC_RX           = 0x01,     // 수신 바이트
+    FLIGHT_REC_FRAME        = 0x02,     // 프레임 판정: len(2) + crc_ok(1)
+    FLIGHT_REC_EVENT        = 0x03,     // 라인 오류: monitor_event_t 코드(1)
+    FLIGHT_REC_PARSE_FAIL   = 0x04,     // 파싱 실패 (데이터 없음)
+} flight_rec_type_t;
+
+// Dump 사유
+typedef enum {
+    FLIGHT_REASON_CRC       = 0x01,
+    FLIGHT_REASON_PARSE     = 0x02,
+} flight_reason_t;
+
+/**
+ * @brief PSRAM ring 할당 (PSRAM 없으면 ESP_ERR_NO_MEM, 기록 비활성)
+ */
+esp_err_t flight_recorder_init(void);
+
+/**
+ * @brief 설정 적용
+ * @param config 설정 (NULL이면 기본값: 활성)
+ */
+void flight_recorder_set_config(const flight_config_t *config);
+
+/**
+ * @brief 현재 설정 반환
+ */
+const flight_config_t* flight_recorder_get_config(void);
+
+/**
+ * @brief 수신 바이트 기록 (UART RX 태스크)
+ */
+void flight_recorder_on_rx(const uint8_t *data, size_t len);
+
+/**
+ * @brief 프레이밍 판정 기록 (UART RX 태스크)
+ */
+void flight_recorder_on_frame(size_t len, bool crc_valid);
+
+/**
+ * @brief 라인 오류 기록 (UART RX 태스크, monitor_event_t 코드)
+ */
+void flight_recorder_on_event(uint8_t code);
+
+/**
+ * @brief 파싱 실패 기록 (파서 워커)
+ */
+void flight_recorder_on_parse_failure(void);
+
+/**
+ * @brief 트리거 평가 (1초 주기 호출) - 조건 충족 시 덤프 태스크 시작
+ */
+void flight_recorder_tick(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLIGHT_RECORDER_H
@@ -0,0 +1,149 @@
+/**
+ * @file frame_dedupe.c
+ * @brief Duplicate Frame Suppression Implementation
+ *
+ * 해시: 64-bit FNV-1a, 제외 구간 바이트는 건너뛴다.
+ * 해시가 같으면 보관한 직전 프레임과 바이트 단위로 다시 비교해 충돌로 다른 프레임을 버리지 않는다.
+ */
+
+#include "frame_dedupe.h"
+#include "stats.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "Dedupe";
+
+#define FNV64_OFFSET    0xCBF29CE484222325ULL
+#define FNV64_PRIME     0x00000100000001B3ULL
+
+static dedupe_config_t s_config = {
+    .enable = 0,
+    .holdoff_ms = DEFAULT_DEDUPE_HOLDOFF_MS,
+};
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// 직전 통과 프레임 (수신 경로 전용)
+static bool s_has_last = false;
+static uint64_t s_last_hash = 0;
+static size_t s_last_len = 0;
+static uint8_t s_last_frame[FRAME_BUF_SIZE];
+static int64_t s_last_pass_us = 0;
+
+static stats_id_t s_stat_suppressed = STATS_INVALID_ID;
+
+static bool is_excluded(const dedupe_config_t *cfg, size_t pos)
+{
+    for (uint8_t r = 0; r < cfg->exclude_count; r++) {
+        if (pos >= cfg->exclude[r].offset &&
+            pos < (size_t)cfg->exclude[r].offset + cfg->exclude[r].length) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t frame_hash(const dedupe_config_t *cfg, const uint8_t *data, size_t len)
+{
+    uint64_t hash = FNV64_OFFSET;
+
+    if (cfg->exclude_count == 0) {
+        for (size_t i = 0; i < len; i++) {
+            hash = (hash ^ data[i]) * FNV64_PRIME;
+        }
+    } else {
+        for (size_t i = 0; i < len; i++) {
+            if (is_excluded(cfg, i)) continue;
+            hash = (hash ^ data[i]) * FNV64_PRIME;
+        }
+    }
+    return hash;
+}
+
+// 해시 일치 시 확인용 (제외 구간은 비교하지 않음)
+static bool frame_equal(const dedupe_config_t *cfg, const uint8_t *data, size_t len)
+{
+    if (len != s_last_len) return false;
+
+    if (cfg->exclude_count == 0) {
+        return memcmp(data, s_last_frame, len) == 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] != s_last_frame[i] && !is_excluded(cfg, i)) return false;
+    }
+    return true;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+void frame_dedupe_set_config(const dedupe_config_t *config)
+{
+    dedupe_config_t cfg = {
+        .enable = 0,
+        .holdoff_ms = DEFAULT_DEDUPE_HOLDOFF_MS,
+    };
+    if (config) {
+        memcpy(&cfg, config, sizeof(dedupe_config_t));
+    }
+    if (cfg.exclude_count > DEDUPE_MAX_EXCLUDE) cfg.exclude_count = DEDUPE_MAX_EXCLUDE;
+    if (cfg.holdoff_ms == 0) cfg.holdoff_ms = DEFAULT_DEDUPE_HOLDOFF_MS;
+
+    if (s_stat_suppressed == STATS_INVALID_ID) {
+        s_stat_suppressed = stats_register("dedupe.suppressed", STATS_COUNTER);
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    memcpy(&s_config, &cfg, sizeof(dedupe_config_t));
+    s_has_last = false;     // 해시 기준이 바뀌었으므로 다음 프레임은 통과
+    taskEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "Config: enable=%d holdoff=%dms exclude=%d",
+             cfg.enable, cfg.holdoff_ms, cfg.exclude_count);
+}
+
+const dedupe_config_t* frame_dedupe_get_config(void)
+{
+    return &s_config;
+}
+
+bool frame_dedupe_accept(const uint8_t *data, size_t len, int64_t now_us)
+{
+    if (!s_config.enable || !data) return true;
+
+    dedupe_config_t cfg;
+    taskENTER_CRITICAL(&s_lock);
+    memcpy(&cfg, &s_config, sizeof(dedupe_config_t));
+    bool has_last = s_has_last;
+    taskEXIT_CRITICAL(&s_lock);
+
+    uint64_t hash = frame_hash(&cfg, data, len);
+
+    if (has_last && hash == s_last_hash && len == s_last_len &&
+        (now_us - s_last_pass_us) < (int64_t)cfg.holdoff_ms * 1000 &&
+        frame_equal(&cfg, data, len)) {
+        stats_inc(s_stat_suppressed);
+        return false;
+    }
+
+    // 새 내용이거나 hold-off 경과 (heartbeat)
+    // 비교용 사본을 보관할 수 없는 길이는 기준으로 삼지 않음 (다음 프레임은 통과)
+    if (len > sizeof(s_last_frame)) {
+        s_has_last = false;
+        return true;
+    }
+    memcpy(s_last_frame, data, len);
+    s_last_hash = hash;
+    s_last_len = len;
+    s_last_pass_us = now_us;
+    s_has_last = true;
+    return true;
+}
+
+void frame_dedupe_reset(void)
+{
+    taskENTER_CRITICAL(&s_lock);
+    s_has_last = false;
+    taskEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,49 @@
+/**
+ * @file frame_dedupe.h
+ * @brief Duplicate Frame Suppression
+ *
+ * CRC 검증을 통과한 프레임의 해시(제외 구간 마스킹)를 직전 통과 프레임과
+ * 비교해, hold-off 시간 내 동일 프레임은 큐잉/파싱/발행 전에 버린다.
+ * hold-off가 지나면 동일 프레임도 1회 통과시켜 heartbeat 역할을 한다.
+ */
+
+#ifndef FRAME_DEDUPE_H
+#define FRAME_DEDUPE_H
+
+#include "protocol_def.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Dedupe 설정 적용
+ * @param config 설정 (NULL이면 비활성 기본값)
+ */
+void frame_dedupe_set_config(const dedupe_config_t *config);
+
+/**
+ * @brief 현재 dedupe 설정 반환
+ */
+const dedupe_config_t* frame_dedupe_get_config(void);
+
+/**
+ * @brief 프레임 통과 여부 판정 (UART 수신 경로 단일 호출자 전용)
+ * @param data 프레임 데이터
+ * @param len 프레임 길이
+ * @param now_us 수신 시각 (esp_timer, us)
+ * @return true면 처리, false면 중복으로 버림
+ */
+bool frame_dedupe_accept(const uint8_t *data, size_t len, int64_t now_us);
+
+/**
+ * @brief 직전 프레임 기록 초기화 (다음 프레임은 무조건 통과)
+ */
+void frame_dedupe_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FRAME_DEDUPE_H
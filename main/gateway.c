@@ -0,0 +1,312 @@
+/**
+ * @file gateway.c
+ * @brief Gateway Mode Implementation
+ *
+ * 자식 장치 테이블은 고정 크기 배열(GATEWAY_MAX_CHILDREN)이며,
+ * death가 발행된 자식의 슬롯은 재사용된다. status 발행에 실패하면
+ * (MQTT 단절 등) dirty로 남겨 두고 다음 tick에서 재시도한다.
+ * 설정 변경 시 기존 자식은 retired로 표시되어 주소 검색에서 빠지고,
+ * death(offline) status가 발행된 뒤에야 슬롯이 반환된다.
+ */
+
+#include "gateway.h"
+#include "mqtt_handler.h"
+#include "time_sync.h"
+#include "stats.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "cJSON.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "Gateway";
+
+typedef struct {
+    bool in_use;
+    bool online;
+    bool status_dirty;          // birth/death status 미발행
+    bool retired;               // 설정 변경으로 폐기됨 (death 발행 후 슬롯 반환)
+    uint16_t addr;
+    uint16_t sequence;
+    int64_t last_seen_us;
+    int64_t last_status_us;
+    uint32_t rx_count;
+    uint32_t error_count;
+    char id[MQTT_DEVICE_ID_MAX_LEN + 8];
+} gateway_child_t;
+
+static gateway_config_t s_config = {
+    .enable = 0,
+    .addr_width = 1,
+    .timeout_s = DEFAULT_GATEWAY_TIMEOUT_S,
+};
+static gateway_child_t s_children[GATEWAY_MAX_CHILDREN];
+static SemaphoreHandle_t s_mutex = NULL;
+
+static stats_id_t s_stat_children = STATS_INVALID_ID;
+static stats_id_t s_stat_overflow = STATS_INVALID_ID;
+
+static void ensure_init(void)
+{
+    if (!s_mutex) {
+        s_mutex = xSemaphoreCreateMutex();
+    }
+    if (s_stat_children == STATS_INVALID_ID) {
+        s_stat_children = stats_register("gateway.children", STATS_GAUGE);
+        s_stat_overflow = stats_register("gateway.overflow", STATS_COUNTER);
+    }
+}
+
+static bool read_address(const record_t *rec, uint16_t *addr)
+{
+    if (!rec->raw || (size_t)s_config.addr_offset + s_config.addr_width > rec->raw_len) {
+        return false;
+    }
+
+    const uint8_t *p = &rec->raw[s_config.addr_offset];
+    if (s_config.addr_width == 2) {
+        *addr = s_config.addr_big_endian ? (uint16_t)((p[0] << 8) | p[1])
+                                         : (uint16_t)((p[1] << 8) | p[0]);
+    } else {
+        *addr = p[0];
+    }
+    return true;
+}
+
+static uint8_t count_online(void)
+{
+    uint8_t n = 0;
+    for (int i = 0; i < GATEWAY_MAX_CHILDREN; i++) {
+        if (s_children[i].in_use && s_children[i].online) n++;
+    }
+    return n;
+}
+
+// s_mutex 보유 상태에서 호출
+static gateway_child_t* find_child(uint16_t addr)
+{
+    for (int i = 0; i < GATEWAY_MAX_CHILDREN; i++) {
+        if (s_children[i].in_use && !s_children[i].retired &&
+            s_children[i].addr == addr) {
+            return &s_children[i];
+        }
+    }
+    return NULL;
+}
+
+// s_mutex 보유 상태에서 호출
+static gateway_child_t* find_or_add_child(uint16_t addr, const char *parent_id)
+{
+    gateway_child_t *free_slot = NULL;
+    gateway_child_t *found = find_child(addr);
+    if (found) return found;
+
+    char id[sizeof(free_slot->id)];
+    snprintf(id, sizeof(id), "%s_%u", parent_id, addr);
+
+    for (int i = 0; i < GATEWAY_MAX_CHILDREN; i++) {
+        if (s_children[i].in_use) {
+            // death 미발행 retired 자식과 같은 topic → 그 슬롯에서 새 birth로 덮어씀
+            if (s_children[i].retired && strcmp(s_children[i].id, id) == 0) {
+                free_slot = &s_children[i];
+                break;
+            }
+        } else if (!free_slot) {
+            free_slot = &s_children[i];
+        }
+    }
+
+    if (!free_slot) {
+        stats_inc(s_stat_overflow);
+        return NULL;
+    }
+
+    memset(free_slot, 0, sizeof(gateway_child_t));
+    free_slot->in_use = true;
+    free_slot->addr = addr;
+    memcpy(free_slot->id, id, sizeof(free_slot->id));
+    ESP_LOGI(TAG, "New child device: %s", free_slot->id);
+    return free_slot;
+}
+
+// 자식 status (birth/death/주기) - retain
+static bool publish_child_status(gateway_child_t *child)
+{
+    if (!mqtt_handler_is_connected()) return false;
+
+    const mqtt_config_data_t *mqtt = mqtt_handler_get_config();
+    cJSON *root = cJSON_CreateObject();
+    if (!root) return false;
+
+    cJSON_AddStringToObject(root, "device_id", child->id);
+    if (strlen(mqtt->user_id) > 0) {
+        cJSON_AddStringToObject(root, "user_id", mqtt->user_id);
+    }
+    cJSON_AddStringToObject(root, "gateway_id", mqtt->device_id);
+    cJSON_AddNumberToObject(root, "address", child->addr);
+    cJSON_AddBoolToObject(root, "online", child->online);
+    cJSON_AddNumberToObject(root, "timestamp", time_sync_now());
+    cJSON_AddNumberToObject(root, "rx_count", child->rx_count);
+    cJSON_AddNumberToObject(root, "error_count", child->error_count);
+
+    bool ok = false;
+    char *json = cJSON_PrintUnformatted(root);
+    if (json) {
+        char topic[256];
+        mqtt_handler_build_device_topic(topic, sizeof(topic), child->id, "status");
+        ok = (mqtt_handler_publish_topic(topic, json, strlen(json), 1, true) == ESP_OK);
+        free(json);
+    }
+    cJSON_Delete(root);
+
+    if (ok) {
+        child->status_dirty = false;
+        child->last_status_us = esp_timer_get_time();
+    }
+    return ok;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+void gateway_set_config(const gateway_config_t *config)
+{
+    gateway_config_t cfg = {
+        .enable = 0,
+        .addr_width = 1,
+        .timeout_s = DEFAULT_GATEWAY_TIMEOUT_S,
+    };
+    if (config) {
+        memcpy(&cfg, config, sizeof(gateway_config_t));
+    }
+    if (cfg.addr_width != 2) cfg.addr_width = 1;
+    if (cfg.timeout_s == 0) cfg.timeout_s = DEFAULT_GATEWAY_TIMEOUT_S;
+
+    ensure_init();
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    memcpy(&s_config, &cfg, sizeof(gateway_config_t));
+    // 주소 해석이 바뀌므로 기존 자식은 폐기. retain된 "online": true가 broker에
+    // 남지 않도록 offline status를 먼저 발행하고, 실패분은 tick에서 재시도
+    for (int i = 0; i < GATEWAY_MAX_CHILDREN; i++) {
+        gateway_child_t *child = &s_children[i];
+        if (!child->in_use) continue;
+
+        child->retired = true;
+        if (child->online) {
+            child->online = false;
+            child->status_dirty = true;
+        }
+        if (child->status_dirty) {
+            publish_child_status(child);
+        }
+        if (!child->status_dirty) {
+            child->in_use = false;
+        }
+    }
+    stats_set(s_stat_children, 0);
+    xSemaphoreGive(s_mutex);
+
+    ESP_LOGI(TAG, "Config: enable=%d addr@%d/%d timeout=%ds",
+             cfg.enable, cfg.addr_offset, cfg.addr_width, cfg.timeout_s);
+}
+
+const gateway_config_t* gateway_get_config(void)
+{
+    return &s_config;
+}
+
+bool gateway_on_record(const record_t *rec)
+{
+    if (!s_config.enable || !rec || !s_mutex) return false;
+
+    const char *parent_id = mqtt_handler_get_config()->device_id;
+    uint16_t addr;
+    if (strlen(parent_id) == 0 || !read_address(rec, &addr)) return false;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    // CRC 오류/파싱 실패 프레임의 주소는 신뢰할 수 없음 → 자식을 만들지 않고 부모 장치로 발행
+    // (이미 알려진 주소면 그 자식의 오류로만 집계)
+    if (!rec->crc_valid || rec->field_count == 0) {
+        gateway_child_t *known = find_child(addr);
+        if (known) known->error_count++;
+        xSemaphoreGive(s_mutex);
+        return false;
+    }
+
+    gateway_child_t *child = find_or_add_child(addr, parent_id);
+    if (!child) {
+        xSemaphoreGive(s_mutex);
+        return false;   // 테이블 가득 참 → 부모 장치로 발행
+    }
+
+    child->last_seen_us = rec->capture_us;
+    child->rx_count++;
+
+    // 첫 수신 (또는 death 이후 재등장) → birth
+    if (!child->online) {
+        child->online = true;
+        child->status_dirty = true;
+        stats_set(s_stat_children, count_online());
+    }
+    if (child->status_dirty) {
+        publish_child_status(child);
+    }
+
+    if (mqtt_handler_is_connected()) {
+        mqtt_handler_publish_child_data(child->id, rec, child->sequence++);
+    }
+    xSemaphoreGive(s_mutex);
+    return true;
+}
+
+void gateway_tick(void)
+{
+    // gateway 비활성 상태에서도 retired 자식의 death 재시도는 계속
+    if (!s_mutex) return;
+
+    int64_t now_us = esp_timer_get_time();
+    int64_t timeout_us = (int64_t)s_config.timeout_s * 1000000;
+    int64_t interval_us = (int64_t)GATEWAY_STATUS_INTERVAL_S * 1000000;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    for (int i = 0; i < GATEWAY_MAX_CHILDREN; i++) {
+        gateway_child_t *child = &s_children[i];
+        if (!child->in_use) continue;
+
+        if (child->online && now_us - child->last_seen_us > timeout_us) {
+            ESP_LOGW(TAG, "Child device timeout: %s", child->id);
+            child->online = false;
+            child->status_dirty = true;
+            stats_set(s_stat_children, count_online());
+        }
+
+        if (child->status_dirty ||
+            (child->online && now_us - child->last_status_us > interval_us)) {
+            publish_child_status(child);
+        }
+
+        // death 발행 완료 → 슬롯 반환
+        if (!child->online && !child->status_dirty) {
+            child->in_use = false;
+        }
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+void gateway_on_mqtt_state(bool connected)
+{
+    if (!connected || !s_mutex) return;
+
+    // 단절 중 놓친 birth/death 포함, 다음 tick에서 전체 status 재발행
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    for (int i = 0; i < GATEWAY_MAX_CHILDREN; i++) {
+        if (s_children[i].in_use) {
+            s_children[i].status_dirty = true;
+        }
+    }
+    xSemaphoreGive(s_mutex);
+}
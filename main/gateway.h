@@ -0,0 +1,57 @@
+/**
+ * @file gateway.h
+ * @brief Gateway Mode - Virtual Child Devices per Slave Address
+ *
+ * 멀티드롭(RS485) 라인에서 원시 프레임의 슬레이브/링크 주소로 레코드를
+ * 자식 장치({device_id}_{addr})에 귀속시킨다. 자식 장치마다
+ * - 자체 토픽 네임스페이스 (user/{user_id}/device/{child_id}/...)
+ * - 자체 sequence / 수신·오류 카운터 / status
+ * 를 가지며, 처음 수신 시 birth, timeout 시 death status(retain)를 발행한다.
+ */
+
+#ifndef GATEWAY_H
+#define GATEWAY_H
+
+#include "protocol_def.h"
+#include "record_bus.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 설정 적용 (자식 장치 테이블 초기화)
+ * @param config 설정 (NULL이면 기본값: 비활성)
+ */
+void gateway_set_config(const gateway_config_t *config);
+
+/**
+ * @brief 현재 설정 반환
+ */
+const gateway_config_t* gateway_get_config(void);
+
+/**
+ * @brief 레코드를 자식 장치로 발행 (MQTT sink에서 호출)
+ *        CRC 오류/파싱 실패 레코드는 자식을 만들지 않고 부모 장치 경로로 넘긴다
+ * @param rec 파싱 결과 레코드
+ * @return true if published as a child device (false면 부모 장치 경로로 처리)
+ */
+bool gateway_on_record(const record_t *rec);
+
+/**
+ * @brief 주기 처리 - timeout 자식 death 발행, 주기 status 발행 (1초 주기 호출)
+ */
+void gateway_tick(void);
+
+/**
+ * @brief MQTT 연결 상태 변경 알림 (재연결 시 online 자식 status 재발행)
+ * @param connected true if connected
+ */
+void gateway_on_mqtt_state(bool connected);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GATEWAY_H
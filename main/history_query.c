@@ -0,0 +1,319 @@
+/**
+ * @file history_query.c
+ * @brief On-demand History Query Implementation
+ *
+ * sample_store에서 HISTORY_CHUNK_VALUES 단위 블록으로 시각 열과 선택 필드 열을 읽고,
+ * 다운샘플 시 버킷별로 집계해 chunk 버퍼에 쌓는다. chunk가 차면 발행 후
+ * HISTORY_CHUNK_DELAY_MS 만큼 쉬어 라이브 data 발행을 밀어내지 않게 한다.
+ * 조회 중 MQTT가 끊기면 중단한다 (요청자가 다시 조회).
+ */
+
+#include "history_query.h"
+#include "sample_store.h"
+#include "data_parser.h"
+#include "mqtt_handler.h"
+#include "stats.h"
+#include "time_sync.h"
+#include "cJSON.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "History";
+
+typedef struct {
+    uint8_t fields[MAX_FIELD_COUNT];
+    uint8_t field_count;
+    uint32_t rows;              // chunk당 최대 행 수
+    int64_t *t;                 // [rows]
+    float *v;                   // [field_count][rows]
+    uint32_t n;                 // 현재 chunk 행 수
+    uint16_t part;
+    uint32_t total;
+    bool truncated;
+} chunk_t;
+
+static history_query_t s_query;
+static volatile bool s_busy = false;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static stats_id_t s_stat_queries = STATS_INVALID_ID;
+static stats_id_t s_stat_chunks = STATS_INVALID_ID;
+
+/*******************************************************************************
+ * Helpers
+ ******************************************************************************/
+// wall clock 초 ↔ 수신 시각(esp_timer us)
+static int64_t wall_to_capture_us(double wall_s)
+{
+    return time_sync_mono_us((int64_t)(wall_s * 1000.0));
+}
+
+static double capture_to_wall(int64_t capture_us)
+{
+    return time_sync_timestamp(capture_us, NULL);
+}
+
+static esp_err_t emit_chunk(chunk_t *ch, bool last)
+{
+    const data_definition_t *def = data_parser_get_definition();
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root) return ESP_ERR_NO_MEM;
+
+    cJSON_AddStringToObject(root, "request_id", s_query.request_id);
+    cJSON_AddNumberToObject(root, "part", ch->part);
+    cJSON_AddBoolToObject(root, "last", last);
+    if (ch->n > 0) {
+        cJSON_AddNumberToObject(root, "t0", capture_to_wall(ch->t[0]));
+    }
+    if (s_query.step_ms > 0) {
+        cJSON_AddNumberToObject(root, "stepMs", s_query.step_ms);
+    }
+
+    cJSON *t_arr = cJSON_CreateArray();
+    cJSON *fields = cJSON_CreateObject();
+    if (t_arr) {
+        for (uint32_t r = 0; r < ch->n; r++) {
+            cJSON_AddItemToArray(t_arr, cJSON_CreateNumber((double)((ch->t[r] - ch->t[0]) / 1000)));
+        }
+        cJSON_AddItemToObject(root, "t", t_arr);
+    }
+    if (fields) {
+        for (uint8_t f = 0; f < ch->field_count; f++) {
+            char name[MAX_FIELD_NAME_LEN];
+            data_parser_get_field_name(def, ch->fields[f], name, sizeof(name));
+            if (name[0] == '\0') snprintf(name, sizeof(name), "Field%d", ch->fields[f]);
+
+            cJSON *col = cJSON_CreateArray();
+            if (!col) continue;
+            const float *v = &ch->v[(size_t)f * ch->rows];
+            for (uint32_t r = 0; r < ch->n; r++) {
+                cJSON_AddItemToArray(col, cJSON_CreateNumber(v[r]));
+            }
+            cJSON_AddItemToObject(fields, name, col);
+        }
+        cJSON_AddItemToObject(root, "fields", fields);
+    }
+
+    ch->total += ch->n;
+    if (last) {
+        cJSON_AddNumberToObject(root, "rows", ch->total);
+        cJSON_AddBoolToObject(root, "truncated", ch->truncated);
+    }
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (json_str) {
+        ret = mqtt_handler_publish(HISTORY_TOPIC_SUFFIX, json_str, strlen(json_str),
+                                   mqtt_handler_get_config()->qos, false);
+        free(json_str);
+    }
+    if (ret == ESP_OK) {
+        stats_inc(s_stat_chunks);
+        ch->part++;
+        ch->n = 0;
+        if (!last) vTaskDelay(pdMS_TO_TICKS(HISTORY_CHUNK_DELAY_MS));
+    }
+    return ret;
+}
+
+// chunk에 한 행 추가 (가득 차면 먼저 발행)
+static esp_err_t push_row(chunk_t *ch, int64_t t_us, const float *values, size_t stride)
+{
+    if (ch->n == ch->rows) {
+        esp_err_t ret = emit_chunk(ch, false);
+        if (ret != ESP_OK) return ret;
+    }
+    ch->t[ch->n] = t_us;
+    for (uint8_t f = 0; f < ch->field_count; f++) {
+        ch->v[(size_t)f * ch->rows + ch->n] = values[(size_t)f * stride];
+    }
+    ch->n++;
+    return ESP_OK;
+}
+
+/*******************************************************************************
+ * Query Task
+ ******************************************************************************/
+static void bucket_result(const double *acc, uint32_t count, uint8_t field_count, float *out)
+{
+    for (uint8_t f = 0; f < field_count; f++) {
+        out[f] = (float)((s_query.agg == HISTORY_AGG_MEAN) ? acc[f] / count : acc[f]);
+    }
+}
+
+static esp_err_t run_query(chunk_t *ch, int64_t *bt, float *bv)
+{
+    uint8_t width = sample_store_width();
+    int64_t now_us = esp_timer_get_time();
+
+    int64_t from_us = 0;
+    if (s_query.last_s > 0) {
+        from_us = now_us - (int64_t)s_query.last_s * 1000000;
+    } else if (s_query.from > 0) {
+        from_us = wall_to_capture_us(s_query.from);
+    }
+    int64_t to_us = (s_query.to > 0) ? wall_to_capture_us(s_query.to) : now_us + 1;
+
+    uint32_t idx = sample_store_find(from_us);
+    uint32_t end = sample_store_find(to_us);
+    // 요청 시작 시각이 보관 중인 가장 오래된 행보다 이전
+    ch->truncated = (from_us > 0 && idx == sample_store_oldest() &&
+                     sample_store_read_column(0, idx, 1, NULL, bt) == 1 && bt[0] > from_us);
+
+    int64_t step_us = (int64_t)s_query.step_ms * 1000;
+    int64_t bucket = -1;
+    int64_t base_us = from_us;
+    uint32_t count = 0;
+    double acc[MAX_FIELD_COUNT];
+    float out[MAX_FIELD_COUNT];
+
+    while ((int32_t)(end - idx) > 0) {
+        if (!mqtt_handler_is_connected() || sample_store_width() != width) {
+            return ESP_ERR_INVALID_STATE;
+        }
+
+        uint32_t want = end - idx;
+        if (want > ch->rows) want = ch->rows;
+
+        uint32_t got = sample_store_read_column(0, idx, want, NULL, bt);
+        if (got == 0) {
+            // 조회 중 ring이 덮어씀 → 남은 가장 오래된 행부터
+            idx = sample_store_oldest();
+            ch->truncated = true;
+            continue;
+        }
+        for (uint8_t f = 0; f < ch->field_count; f++) {
+            if (sample_store_read_column(ch->fields[f], idx, got, &bv[(size_t)f * ch->rows], NULL) != got) {
+                ch->truncated = true;
+            }
+        }
+
+        for (uint32_t r = 0; r < got; r++) {
+            const float *row = &bv[r];
+            esp_err_t ret = ESP_OK;
+
+            if (step_us == 0) {
+                ret = push_row(ch, bt[r], row, ch->rows);
+            } else {
+                if (bucket < 0 && base_us == 0) base_us = bt[r];
+                int64_t b = (bt[r] - base_us) / step_us;
+                if (count > 0 && b != bucket) {
+                    bucket_result(acc, count, ch->field_count, out);
+                    ret = push_row(ch, base_us + bucket * step_us, out, 1);
+                    count = 0;
+                }
+                bucket = b;
+                for (uint8_t f = 0; f < ch->field_count; f++) {
+                    float v = row[(size_t)f * ch->rows];
+                    if (count == 0) {
+                        acc[f] = v;
+                    } else if (s_query.agg == HISTORY_AGG_MIN) {
+                        if (v < acc[f]) acc[f] = v;
+                    } else if (s_query.agg == HISTORY_AGG_MAX) {
+                        if (v > acc[f]) acc[f] = v;
+                    } else if (s_query.agg == HISTORY_AGG_LAST) {
+                        acc[f] = v;
+                    } else {
+                        acc[f] += v;
+                    }
+                }
+                count++;
+            }
+            if (ret != ESP_OK) return ret;
+        }
+        idx += got;
+    }
+
+    if (count > 0) {
+        bucket_result(acc, count, ch->field_count, out);
+        esp_err_t ret = push_row(ch, base_us + bucket * step_us, out, 1);
+        if (ret != ESP_OK) return ret;
+    }
+
+    return emit_chunk(ch, true);
+}
+
+static void history_task(void *arg)
+{
+    chunk_t ch = { 0 };
+    uint8_t width = sample_store_width();
+
+    for (uint8_t f = 0; f < width; f++) {
+        if (s_query.field_mask == 0 || (s_query.field_mask & FIELD_MASK_BIT(f))) {
+            ch.fields[ch.field_count++] = f;
+        }
+    }
+
+    uint8_t columns = ch.field_count ? ch.field_count : 1;
+    ch.rows = HISTORY_CHUNK_VALUES / columns;
+    if (ch.rows < 16) ch.rows = 16;
+
+    ch.t = malloc(sizeof(int64_t) * ch.rows);
+    ch.v = malloc(sizeof(float) * columns * ch.rows);
+    int64_t *bt = malloc(sizeof(int64_t) * ch.rows);
+    float *bv = malloc(sizeof(float) * columns * ch.rows);
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    if (ch.t && ch.v && bt && bv) {
+        ret = run_query(&ch, bt, bv);
+    }
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Query %s done: %lu rows, %d parts",
+                 s_query.request_id, (unsigned long)ch.total, ch.part);
+    } else {
+        ESP_LOGW(TAG, "Query %s aborted: %s", s_query.request_id, esp_err_to_name(ret));
+    }
+
+    free(ch.t);
+    free(ch.v);
+    free(bt);
+    free(bv);
+
+    s_busy = false;
+    vTaskDelete(NULL);
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+esp_err_t history_query_start(const history_query_t *query)
+{
+    if (!query) return ESP_ERR_INVALID_ARG;
+    if (sample_store_capacity() == 0) return ESP_ERR_NOT_SUPPORTED;
+
+    portENTER_CRITICAL(&s_lock);
+    bool busy = s_busy;
+    s_busy = true;
+    portEXIT_CRITICAL(&s_lock);
+    if (busy) return ESP_ERR_INVALID_STATE;
+
+    if (s_stat_queries == STATS_INVALID_ID) {
+        s_stat_queries = stats_register("history.queries", STATS_COUNTER);
+        s_stat_chunks = stats_register("history.chunks", STATS_COUNTER);
+    }
+
+    memcpy(&s_query, query, sizeof(history_query_t));
+    if (s_query.agg > HISTORY_AGG_LAST) s_query.agg = HISTORY_AGG_MEAN;
+
+    if (xTaskCreate(history_task, "history", TASK_STACK_HISTORY, NULL,
+                    TASK_PRIORITY_HISTORY, NULL) != pdPASS) {
+        s_busy = false;
+        return ESP_ERR_NO_MEM;
+    }
+
+    stats_inc(s_stat_queries);
+    ESP_LOGI(TAG, "Query %s started (mask=0x%llx, step=%lums)", s_query.request_id,
+             (unsigned long long)s_query.field_mask, (unsigned long)s_query.step_ms);
+    return ESP_OK;
+}
+
+bool history_query_busy(void)
+{
+    return s_busy;
+}
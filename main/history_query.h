@@ -0,0 +1,70 @@
+/**
+ * @file history_query.h
+ * @brief On-demand History Query over MQTT
+ *
+ * sample_store(PSRAM 열 단위 ring)에 남아 있는 전체 해상도 값을 요청 시에만
+ * 시간 구간/필드 선택/다운샘플 조건으로 읽어 {base}/history 토픽에 chunk로 보낸다.
+ * 상시 전체 해상도 업로드 없이도 최근 구간을 조회할 수 있다.
+ *
+ * 요청 (cmd 토픽):
+ *   {"command":"query_history","request_id":"...",
+ *    "payload":{"fields":["Temp",2],"from":1700000000,"to":1700003600,
+ *               "lastSec":3600,"stepMs":1000,"agg":"mean"}}
+ *   fields 생략 = 전체, lastSec 지정 시 from 대신 (현재 - lastSec),
+ *   stepMs 0/생략 = 전체 해상도, agg: mean | min | max | last
+ *
+ * 응답 chunk (열 단위):
+ *   {"request_id":"...","part":0,"last":false,"t0":1700000000.25,
+ *    "t":[0,100,200,...],"fields":{"Temp":[21.5,21.6,...],...}}
+ *   t = t0 기준 ms 오프셋, 마지막 chunk에 "rows"(총 행 수), "truncated"(요청 시작 시각이 보관 범위보다 이전)
+ *
+ * 한 번에 하나의 조회만 실행한다.
+ */
+
+#ifndef HISTORY_QUERY_H
+#define HISTORY_QUERY_H
+
+#include "protocol_def.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HISTORY_TOPIC_SUFFIX    "history"
+
+typedef enum {
+    HISTORY_AGG_MEAN        = 0x00,
+    HISTORY_AGG_MIN         = 0x01,
+    HISTORY_AGG_MAX         = 0x02,
+    HISTORY_AGG_LAST        = 0x03,
+} history_agg_t;
+
+typedef struct {
+    char request_id[37];
+    uint64_t field_mask;        // bit i = 필드 i (0 = 전체)
+    double from;                // wall clock epoch 초 (0 = 가장 오래된 행부터)
+    double to;                  // wall clock epoch 초 (0 = 현재까지)
+    uint32_t last_s;            // 0이 아니면 from = 현재 - last_s
+    uint32_t step_ms;           // 다운샘플 버킷 (0 = 전체 해상도)
+    uint8_t agg;                // history_agg_t
+} history_query_t;
+
+/**
+ * @brief 조회 시작 (전용 태스크에서 chunk 전송)
+ * @param query 조회 조건 (복사됨)
+ * @return ESP_OK, ESP_ERR_INVALID_STATE (다른 조회 진행 중),
+ *         ESP_ERR_NOT_SUPPORTED (sample store 없음), ESP_ERR_NO_MEM
+ */
+esp_err_t history_query_start(const history_query_t *query);
+
+/**
+ * @brief 조회 진행 중 여부
+ */
+bool history_query_busy(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HISTORY_QUERY_H
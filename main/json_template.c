@@ -0,0 +1,313 @@
+/**
+ * @file json_template.c
+ * @brief Precompiled JSON Payload Template Implementation
+ *
+ * 문자열 이스케이프와 숫자 포맷은 cJSON(print_string_ptr / print_number)과
+ * 같은 규칙을 따라 기존 data 메시지와 바이트 호환을 유지한다.
+ */
+
+#include "json_template.h"
+#include "data_parser.h"
+#include "encode_utils.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <float.h>
+
+static const char *TAG = "JsonTpl";
+
+/*******************************************************************************
+ * Builder
+ ******************************************************************************/
+typedef struct {
+    json_template_t *tpl;
+    size_t capacity;
+    size_t run_start;
+    uint16_t op_capacity;
+    bool overflow;
+} tpl_builder_t;
+
+static void put_raw(tpl_builder_t *b, const char *s, size_t len)
+{
+    if (b->tpl->text_length + len > b->capacity) {
+        b->overflow = true;
+        return;
+    }
+    memcpy(b->tpl->text + b->tpl->text_length, s, len);
+    b->tpl->text_length += len;
+}
+
+static void put_str(tpl_builder_t *b, const char *s)
+{
+    put_raw(b, s, strlen(s));
+}
+
+// cJSON print_string_ptr 과 동일한 이스케이프
+static void put_escaped(tpl_builder_t *b, const char *s)
+{
+    put_raw(b, "\"", 1);
+    for (const unsigned char *p = (const unsigned char *)s; *p; p++) {
+        char esc[8];
+        switch (*p) {
+            case '\"': put_raw(b, "\\\"", 2); break;
+            case '\\': put_raw(b, "\\\\", 2); break;
+            case '\b': put_raw(b, "\\b", 2); break;
+            case '\f': put_raw(b, "\\f", 2); break;
+            case '\n': put_raw(b, "\\n", 2); break;
+            case '\r': put_raw(b, "\\r", 2); break;
+            case '\t': put_raw(b, "\\t", 2); break;
+            default:
+                if (*p < 32) {
+                    snprintf(esc, sizeof(esc), "\\u%04x", *p);
+                    put_raw(b, esc, 6);
+                } else {
+                    put_raw(b, (const char *)p, 1);
+                }
+                break;
+        }
+    }
+    put_raw(b, "\"", 1);
+}
+
+// 현재까지의 고정 구간을 닫고 뒤에 값 슬롯 추가
+static void put_slot(tpl_builder_t *b, json_tpl_slot_t slot, uint8_t field)
+{
+    json_template_t *tpl = b->tpl;
+    if (tpl->op_count >= b->op_capacity) {
+        b->overflow = true;
+        return;
+    }
+
+    json_tpl_op_t *op = &tpl->ops[tpl->op_count++];
+    op->run_offset = (uint16_t)b->run_start;
+    op->run_length = (uint16_t)(tpl->text_length - b->run_start);
+    op->slot = slot;
+    op->field = field;
+    b->run_start = tpl->text_length;
+}
+
+/*******************************************************************************
+ * Number Formatting (cJSON print_number 호환)
+ ******************************************************************************/
+static bool compare_double(double a, double b)
+{
+    double max_val = fabs(a) > fabs(b) ? fabs(a) : fabs(b);
+    return (fabs(a - b) <= max_val * DBL_EPSILON);
+}
+
+int json_template_format_number(char *buf, double d)
+{
+    if (isnan(d) || isinf(d)) {
+        return sprintf(buf, "null");
+    }
+
+    // cJSON_CreateNumber 의 valueint 포화 규칙
+    int value_int;
+    if (d >= INT_MAX) {
+        value_int = INT_MAX;
+    } else if (d <= (double)INT_MIN) {
+        value_int = INT_MIN;
+    } else {
+        value_int = (int)d;
+    }
+
+    if (d == (double)value_int) {
+        return sprintf(buf, "%d", value_int);
+    }
+
+    double test = 0.0;
+    int len = sprintf(buf, "%1.15g", d);
+    if (sscanf(buf, "%lg", &test) != 1 || !compare_double(test, d)) {
+        len = sprintf(buf, "%1.17g", d);
+    }
+    return len;
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+void json_template_free(json_template_t *tpl)
+{
+    if (!tpl) return;
+    free(tpl->text);
+    free(tpl->ops);
+    free(tpl->out);
+    memset(tpl, 0, sizeof(json_template_t));
+}
+
+esp_err_t json_template_compile(json_template_t *tpl, const char *device_id,
+                                const char *user_id, const data_definition_t *def)
+{
+    if (!tpl || !device_id || !def) return ESP_ERR_INVALID_ARG;
+
+    json_template_free(tpl);
+    if (device_id[0] == '\0' || def->field_count == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t id_len = strlen(device_id) + (user_id ? strlen(user_id) : 0);
+    tpl_builder_t b = {
+        .tpl = tpl,
+        .capacity = 256 + id_len * 6 + def->field_count * (MAX_FIELD_NAME_LEN * 6 + 64),
+        .op_capacity = 7 + def->field_count * 3,
+    };
+
+    tpl->text = malloc(b.capacity);
+    tpl->ops = calloc(b.op_capacity, sizeof(json_tpl_op_t));
+    if (!tpl->text || !tpl->ops) {
+        json_template_free(tpl);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // mqtt_handler_publish_data() 의 키 순서와 동일
+    put_str(&b, "{\"device_id\":");
+    put_escaped(&b, device_id);
+    if (user_id && user_id[0] != '\0') {
+        put_str(&b, ",\"user_id\":");
+        put_escaped(&b, user_id);
+    }
+    put_str(&b, ",\"timestamp\":");
+    put_slot(&b, TPL_SLOT_TIMESTAMP, 0);
+    put_str(&b, ",\"time_valid\":");
+    put_slot(&b, TPL_SLOT_TIME_VALID, 0);
+    put_str(&b, ",\"sequence\":");
+    put_slot(&b, TPL_SLOT_SEQUENCE, 0);
+    put_str(&b, ",\"protocol\":\"custom\",\"crc_valid\":");
+    put_slot(&b, TPL_SLOT_CRC_VALID, 0);
+    put_str(&b, ",\"schema_version\":");
+    put_escaped(&b, SCHEMA_VERSION_STRING);
+    put_slot(&b, TPL_SLOT_RAW, 0);
+    put_str(&b, ",\"fields\":{");
+
+    for (uint8_t i = 0; i < def->field_count; i++) {
+        char name[MAX_FIELD_NAME_LEN];
+        data_type_t type = (data_type_t)def->fields[i].field_type;
+
+        data_parser_get_field_name(def, i, name, sizeof(name));
+        tpl->types[i] = (uint8_t)type;
+
+        // 구분자 ','는 렌더링 시 포함된 필드 사이에만 넣는다
+        put_slot(&b, TPL_SLOT_FIELD_BEGIN, i);
+        put_escaped(&b, name);
+        put_str(&b, ":{\"value\":");
+        put_slot(&b, TPL_SLOT_FIELD_VALUE, i);
+        put_str(&b, ",\"type\":");
+        put_escaped(&b, data_parser_type_name(type));
+        if (type == DATA_TYPE_UINT32 || type == DATA_TYPE_INT32) {
+            put_str(&b, ",\"raw\":");
+            put_slot(&b, TPL_SLOT_FIELD_RAW, i);
+        }
+        put_str(&b, "}");
+    }
+    put_slot(&b, TPL_SLOT_FIELDS_END, 0);
+    put_str(&b, "}}");
+    put_slot(&b, TPL_SLOT_NONE, 0);
+
+    if (b.overflow) {
+        ESP_LOGE(TAG, "Template overflow");
+        json_template_free(tpl);
+        return ESP_ERR_NO_MEM;
+    }
+
+    tpl->field_count = def->field_count;
+    tpl->out_capacity = tpl->text_length + 16 + FRAME_BUF_SIZE * 2 +
+                        tpl->op_count * JSON_TEMPLATE_NUMBER_MAX_LEN + 1;
+    tpl->out = malloc(tpl->out_capacity);
+    if (!tpl->out) {
+        json_template_free(tpl);
+        return ESP_ERR_NO_MEM;
+    }
+
+    tpl->valid = true;
+    ESP_LOGI(TAG, "Compiled: %d fields, %d static bytes, %d ops",
+             tpl->field_count, (int)tpl->text_length, tpl->op_count);
+    return ESP_OK;
+}
+
+const char* json_template_render(json_template_t *tpl, double timestamp,
+                                 bool time_valid, uint16_t sequence, bool crc_valid,
+                                 const uint8_t *raw_data, size_t raw_len,
+                                 uint8_t raw_encoding,
+                                 const parsed_field_t *fields, uint8_t field_count,
+                                 uint64_t field_mask, size_t *out_len)
+{
+    if (!tpl || !tpl->valid || !fields || field_count != tpl->field_count ||
+        raw_len > FRAME_BUF_SIZE) {
+        return NULL;
+    }
+    for (uint8_t i = 0; i < field_count; i++) {
+        if ((uint8_t)fields[i].type != tpl->types[i]) return NULL;
+    }
+
+    char *p = tpl->out;
+    bool skip = false;          // 제외 필드 구간
+    bool first_field = true;
+    for (uint16_t n = 0; n < tpl->op_count; n++) {
+        const json_tpl_op_t *op = &tpl->ops[n];
+
+        if (!skip) {
+            memcpy(p, tpl->text + op->run_offset, op->run_length);
+            p += op->run_length;
+        } else if (op->slot != TPL_SLOT_FIELD_BEGIN && op->slot != TPL_SLOT_FIELDS_END) {
+            continue;
+        }
+
+        switch (op->slot) {
+            case TPL_SLOT_TIMESTAMP:
+                p += json_template_format_number(p, timestamp);
+                break;
+            case TPL_SLOT_SEQUENCE:
+                p += json_template_format_number(p, sequence);
+                break;
+            case TPL_SLOT_TIME_VALID:
+            case TPL_SLOT_CRC_VALID:
+                if (op->slot == TPL_SLOT_TIME_VALID ? time_valid : crc_valid) {
+                    memcpy(p, "true", 4);
+                    p += 4;
+                } else {
+                    memcpy(p, "false", 5);
+                    p += 5;
+                }
+                break;
+            case TPL_SLOT_RAW:
+                if (raw_data && raw_len > 0) {
+                    if (raw_encoding == RAW_ENCODING_BASE64) {
+                        memcpy(p, ",\"raw_b64\":\"", 12);
+                        p += 12;
+                        p += encode_base64(raw_data, raw_len, p);
+                    } else {
+                        memcpy(p, ",\"raw_hex\":\"", 12);
+                        p += 12;
+                        p += encode_hex(raw_data, raw_len, p);
+                    }
+                    *p++ = '\"';
+                }
+                break;
+            case TPL_SLOT_FIELD_VALUE:
+                p += json_template_format_number(p, fields[op->field].scaled_value);
+                break;
+            case TPL_SLOT_FIELD_RAW:
+                p += json_template_format_number(p, fields[op->field].value.u32);
+                break;
+            case TPL_SLOT_FIELD_BEGIN:
+                skip = op->field < FIELD_MASK_BITS && !(field_mask & FIELD_MASK_BIT(op->field));
+                if (!skip) {
+                    if (!first_field) *p++ = ',';
+                    first_field = false;
+                }
+                break;
+            case TPL_SLOT_FIELDS_END:
+                skip = false;
+                break;
+            default:
+                break;
+        }
+    }
+    *p = '\0';
+
+    if (out_len) *out_len = (size_t)(p - tpl->out);
+    return tpl->out;
+}
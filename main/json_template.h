@@ -0,0 +1,100 @@
+/**
+ * @file json_template.h
+ * @brief Precompiled JSON Payload Template for Data Messages
+ *
+ * 데이터 정의가 정해지면 data 토픽 JSON의 고정 부분(키, type 문자열,
+ * device_id, user_id, schema_version)을 미리 한 번 직렬화해 두고,
+ * 프레임마다 고정 구간 memcpy + 값 슬롯 숫자 포맷만 수행한다.
+ * 출력은 cJSON_PrintUnformatted() 기반 기존 출력과 바이트 단위로 동일하다.
+ */
+
+#ifndef JSON_TEMPLATE_H
+#define JSON_TEMPLATE_H
+
+#include "protocol_def.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JSON_TEMPLATE_NUMBER_MAX_LEN    32      // "%1.17g" 최대 길이 + 여유
+
+typedef enum {
+    TPL_SLOT_NONE = 0,          // 고정 구간만
+    TPL_SLOT_TIMESTAMP,
+    TPL_SLOT_TIME_VALID,
+    TPL_SLOT_SEQUENCE,
+    TPL_SLOT_CRC_VALID,
+    TPL_SLOT_RAW,               // ,"raw_hex":"..." 또는 ,"raw_b64":"..." (raw 없으면 생략)
+    TPL_SLOT_FIELD_VALUE,
+    TPL_SLOT_FIELD_RAW,
+    TPL_SLOT_FIELD_BEGIN,       // 필드 시작 (제외 필드는 다음 FIELD_BEGIN/FIELDS_END까지 생략)
+    TPL_SLOT_FIELDS_END,
+} json_tpl_slot_t;
+
+typedef struct {
+    uint16_t run_offset;        // text 내 고정 구간 시작
+    uint16_t run_length;        // 고정 구간 길이
+    uint8_t slot;               // 고정 구간 뒤에 올 값 (json_tpl_slot_t)
+    uint8_t field;              // FIELD_* 슬롯의 필드 인덱스
+} json_tpl_op_t;
+
+typedef struct {
+    bool valid;
+    char *text;                 // 고정 구간 연결 버퍼
+    size_t text_length;
+    json_tpl_op_t *ops;
+    uint16_t op_count;
+    uint8_t field_count;
+    uint8_t types[MAX_FIELD_COUNT];
+    char *out;                  // 렌더링 출력 버퍼
+    size_t out_capacity;
+} json_template_t;
+
+/**
+ * @brief 템플릿 컴파일 (기존 템플릿은 해제 후 재생성)
+ * @param tpl 템플릿
+ * @param device_id 장치 ID (필수)
+ * @param user_id 사용자 ID (빈 문자열이면 키 생략)
+ * @param def 데이터 정의
+ * @return ESP_OK on success
+ */
+esp_err_t json_template_compile(json_template_t *tpl, const char *device_id,
+                                const char *user_id, const data_definition_t *def);
+
+/**
+ * @brief 템플릿 해제
+ */
+void json_template_free(json_template_t *tpl);
+
+/**
+ * @brief 파싱 결과를 템플릿으로 직렬화
+ *
+ * 필드 수/타입이 템플릿과 다르면 NULL을 반환하며, 호출자는 cJSON 경로로 처리한다.
+ * @param timestamp 수신 시각 (epoch 초, ms 해상도)
+ * @param time_valid wall clock 동기화 여부
+ * @param raw_data 원시 프레임 (NULL이면 raw 키 생략)
+ * @param raw_encoding raw_encoding_t
+ * @param field_mask 포함할 필드 (bit i = 필드 i, FIELD_MASK_ALL = 전체)
+ * @return tpl->out (다음 렌더링 전까지 유효), 실패 시 NULL
+ */
+const char* json_template_render(json_template_t *tpl, double timestamp,
+                                 bool time_valid, uint16_t sequence, bool crc_valid,
+                                 const uint8_t *raw_data, size_t raw_len,
+                                 uint8_t raw_encoding,
+                                 const parsed_field_t *fields, uint8_t field_count,
+                                 uint64_t field_mask, size_t *out_len);
+
+/**
+ * @brief cJSON print_number 과 동일한 숫자 포맷 (null 종료)
+ * @param buf 출력 (JSON_TEMPLATE_NUMBER_MAX_LEN 이상)
+ * @return 기록된 문자 수
+ */
+int json_template_format_number(char *buf, double d);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JSON_TEMPLATE_H
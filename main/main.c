@@ -38,6 +38,19 @@
 #include "data_parser.h"
 #include "cmd_handler.h"
 #include "ota_handler.h"
+#include "sample_store.h"
+#include "backfill.h"
+#include "stats.h"
+#include "frame_dedupe.h"
+#include "record_bus.h"
+#include "field_topics.h"
+#include "topic_router.h"
+#include "gateway.h"
+#include "mqtt_batch.h"
+#include "flight_recorder.h"
+#include "alarm_engine.h"
+#include "rate_plan.h"
+#include "time_sync.h"
 
 static const char *TAG = "MAIN";
 
@@ -50,7 +63,7 @@ wifi_config_data_t g_wifi_config = {0};
 mqtt_config_data_t g_mqtt_config = {0};
 uart_config_data_t g_uart_config = {0};
 protocol_config_data_t g_protocol_config = {0};
-data_definition_t g_data_definition = {0};
+data_definition_t *g_data_definition = NULL;     // PSRAM
 
 char g_device_id[32] = {0};  // Non-static for extern access from cmd_handler
 static uint16_t g_sequence = 0;
@@ -58,13 +71,32 @@ static uint32_t g_start_time = 0;
 
 static SemaphoreHandle_t g_config_mutex = NULL;
 static QueueHandle_t g_frame_queue = NULL;
+static stats_id_t g_stat_queue_drops = STATS_INVALID_ID;
+static stats_id_t g_stat_reorder_depth = STATS_INVALID_ID;
 
 // Frame queue item
 typedef struct {
     uint8_t data[FRAME_BUF_SIZE];
     size_t length;
+    int64_t capture_us;     // 프레임 수신 시각 (esp_timer)
+    uint32_t ticket;        // 수신 순번 (병렬 파싱 후 재정렬 기준)
+    bool crc_valid;         // false는 raw on-error 정책일 때만 전달됨
 } frame_item_t;
 
+// Reorder stage: 워커가 완료한 결과를 수신 순서대로 발행
+// 동시에 미발행 상태일 수 있는 ticket 수 <= 큐 크기 + 워커 수 < REORDER_WINDOW
+#define REORDER_WINDOW          32
+
+typedef struct {
+    bool ready;
+    record_t *rec;          // 파싱 실패 시 NULL (순번만 소비)
+} reorder_slot_t;
+
+static reorder_slot_t g_reorder[REORDER_WINDOW];
+static uint32_t g_next_ticket = 0;      // uart_frame_handler 전용
+static uint32_t g_release_ticket = 0;   // 다음 발행할 ticket
+static SemaphoreHandle_t g_reorder_mutex = NULL;
+
 /*******************************************************************************
  * Helper Functions
  ******************************************************************************/
@@ -100,145 +132,309 @@ static void update_status(void)
 /*******************************************************************************
  * UART Frame Handler
  ******************************************************************************/
-static void uart_frame_handler(const uint8_t *data, size_t length)
+static void uart_frame_handler(const uint8_t *data, size_t length, bool crc_valid)
 {
     if (!g_frame_queue) return;
 
+    // 반복 전송되는 동일 프레임은 큐잉/파싱 전에 억제 (heartbeat는 통과)
+    int64_t now_us = esp_timer_get_time();
+    if (crc_valid && !frame_dedupe_accept(data, length, now_us)) return;
+
     frame_item_t item;
     if (length > FRAME_BUF_SIZE) {
         length = FRAME_BUF_SIZE;
     }
     memcpy(item.data, data, length);
     item.length = length;
+    item.capture_us = now_us;
+    item.ticket = g_next_ticket;
+    item.crc_valid = crc_valid;
+
+    // Send to queue (don't block) - 큐에 들어간 프레임만 순번 소비
+    if (xQueueSend(g_frame_queue, &item, 0) == pdTRUE) {
+        g_next_ticket++;
+    } else {
+        stats_inc(g_stat_queue_drops);
+    }
+
+    // 파이프라인 backpressure → 송신측 flow-off (flow control 사용 시, 해제는 워커가 low water에서)
+    if (uxQueueMessagesWaiting(g_frame_queue) >= FLOW_OFF_HIGH_WATER) {
+        uart_handler_set_flow_off(true);
+    }
+}
 
-    // Send to queue (don't block)
-    xQueueSend(g_frame_queue, &item, 0);
+// flow-off 해제 조건 (RX 태스크가 flow-off 대기 중 확인)
+static bool frame_queue_drained(void)
+{
+    return uxQueueMessagesWaiting(g_frame_queue) <= FLOW_ON_LOW_WATER;
 }
 
 /*******************************************************************************
- * Data Processing Task
- * 
+ * Record Sinks
+ *
+ * 파싱 결과는 record_bus를 통해 각 sink 태스크로 전달된다.
+ * 새 소비자는 sink를 하나 추가하면 되며 data_processing_task는 수정하지 않는다.
+ ******************************************************************************/
+static void mqtt_data_sink(const record_t *rec, void *ctx)
+{
+    // Gateway 모드: 슬레이브 주소별 자식 장치로 발행 (단절 중에도 last_seen 갱신)
+    if (gateway_on_record(rec)) return;
+
+    if (!mqtt_handler_is_connected()) return;
+
+    // 라우팅 규칙에 걸리는 record(알람 등)는 지연 없이 개별 발행,
+    // 나머지는 적응형 배치 (비활성이면 개별 발행)
+    char topic[256];
+    uint8_t qos;
+    if (topic_router_match(rec->fields, rec->field_count, rec->raw, rec->raw_len,
+                           topic, sizeof(topic), &qos)) {
+        mqtt_handler_publish_data_to(g_device_id, rec, topic, qos);
+    } else if (!mqtt_batch_add(rec)) {
+        mqtt_handler_publish_data_to(g_device_id, rec, NULL, 0);
+    }
+
+    // 필드별 토픽 (변경된 값만)
+    if (rec->crc_valid && rec->field_count > 0) {
+        field_topics_publish(rec->fields, rec->field_count);
+    }
+}
+
+static uint32_t mqtt_data_poll(void *ctx)
+{
+    return mqtt_batch_poll();
+}
+
+/*
  * 특허 2.4절 "실시간 검증부" 구현:
  * - 설정 전송 직후 파싱 결과를 BLE로 실시간 전송
  * - Raw Data + 파싱된 물리값 + CRC 검증 결과 포함
+ */
+static void ble_data_sink(const record_t *rec, void *ctx)
+{
+    // 특허 실시간 검증부: BLE 연결 시 항상 파싱 결과 전송
+    if (!ble_service_is_connected()) return;
+
+    uint8_t ble_data[512];
+    uint16_t offset = 0;
+
+    // Packet header
+    ble_data[offset++] = PACKET_STX;
+    ble_data[offset++] = RSP_DATA;
+    uint16_t len_offset = offset;
+    offset += 2;  // Length placeholder
+
+    // Header: timestamp(4) + sequence(2) + field_count(1) + format(1)
+    uint32_t timestamp = (uint32_t)(rec->capture_us / 1000000);
+    memcpy(&ble_data[offset], &timestamp, 4);
+    offset += 4;
+    memcpy(&ble_data[offset], &rec->sequence, 2);
+    offset += 2;
+    ble_data[offset++] = rec->field_count;
+    ble_data[offset++] = 1;  // Format: JSON-like with raw
+
+    // Raw data hex (최대 32 bytes)
+    uint8_t raw_len = (rec->raw_len > 32) ? 32 : rec->raw_len;
+    ble_data[offset++] = raw_len;
+    for (int i = 0; i < raw_len && offset + 2 < sizeof(ble_data) - 10; i++) {
+        uint8_t byte = rec->raw[i];
+        ble_data[offset++] = "0123456789ABCDEF"[byte >> 4];
+        ble_data[offset++] = "0123456789ABCDEF"[byte & 0x0F];
+    }
+
+    // CRC verification result
+    ble_data[offset++] = rec->crc_valid ? 1 : 0;
+
+    // Field values with names
+    for (int i = 0; i < rec->field_count && offset + 40 < sizeof(ble_data) - 10; i++) {
+        uint8_t name_len = strlen(rec->fields[i].name);
+        if (name_len > 16) name_len = 16;
+        ble_data[offset++] = name_len;
+        memcpy(&ble_data[offset], rec->fields[i].name, name_len);
+        offset += name_len;
+
+        float val = (float)rec->fields[i].scaled_value;
+        memcpy(&ble_data[offset], &val, 4);
+        offset += 4;
+
+        ble_data[offset++] = rec->fields[i].type;
+    }
+
+    // Fill in length
+    uint16_t payload_len = offset - 4;
+    ble_data[len_offset] = payload_len & 0xFF;
+    ble_data[len_offset + 1] = (payload_len >> 8) & 0xFF;
+
+    // CRC and ETX
+    uint8_t crc = 0;
+    for (int i = 1; i < offset; i++) {
+        crc ^= ble_data[i];
+    }
+    ble_data[offset++] = crc;
+    ble_data[offset++] = PACKET_ETX;
+
+    ble_service_notify_data(ble_data, offset);
+}
+
+static void store_data_sink(const record_t *rec, void *ctx)
+{
+    // CRC/파싱 실패 프레임(raw 디버깅용)은 보관하지 않음
+    if (!rec->crc_valid || rec->field_count == 0) return;
+
+    // 단절 구간 backfill용 보관 (연결 여부와 무관하게 항상 기록)
+    sample_store_append(rec->capture_us, rec->sequence, rec->fields, rec->field_count);
+}
+
+static void register_record_sinks(void)
+{
+    const record_sink_config_t sinks[] = {
+        { .name = "mqtt",  .fn = mqtt_data_sink,  .queue_len = SINK_QUEUE_MQTT,
+          .policy = RECORD_DROP_OLDEST, .priority = TASK_PRIORITY_SINK, .stack_size = TASK_STACK_SINK,
+          .poll_fn = mqtt_data_poll },
+        { .name = "ble",   .fn = ble_data_sink,   .queue_len = SINK_QUEUE_BLE,
+          .policy = RECORD_DROP_OLDEST, .priority = TASK_PRIORITY_SINK, .stack_size = TASK_STACK_SINK },
+        { .name = "store", .fn = store_data_sink, .queue_len = SINK_QUEUE_STORE,
+          .policy = RECORD_DROP_NEWEST, .priority = TASK_PRIORITY_SINK, .stack_size = TASK_STACK_SINK },
+    };
+
+    for (size_t i = 0; i < sizeof(sinks) / sizeof(sinks[0]); i++) {
+        if (record_bus_add_sink(&sinks[i]) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to add sink: %s", sinks[i].name);
+        }
+    }
+}
+
+/*******************************************************************************
+ * Reorder Stage
+ *
+ * 워커는 완료 순서와 무관하게 결과를 제출하고, 제출한 워커가
+ * 연속된 ticket이 준비된 만큼 수신 순서대로 시퀀스를 부여해 발행한다.
+ * record_bus_publish()는 블록하지 않으므로 mutex 안에서 호출한다.
+ * 알람 규칙도 여기서 순서대로 평가한다 (변화율/히스테리시스는 순서가 필요).
+ * 필드별 발행 주기(rate plan)도 publish 전에 record에 마스크로 기록한다.
+ ******************************************************************************/
+static void reorder_submit(uint32_t ticket, record_t *rec)
+{
+    uint32_t depth;
+
+    xSemaphoreTake(g_reorder_mutex, portMAX_DELAY);
+    reorder_slot_t *slot = &g_reorder[ticket % REORDER_WINDOW];
+    slot->rec = rec;
+    slot->ready = true;
+    depth = ticket - g_release_ticket;
+
+    // 최대 재정렬 깊이 (읽기-비교-쓰기를 mutex 안에서 - 워커 간 high-water 손실 방지)
+    if (depth > stats_get(g_stat_reorder_depth)) {
+        stats_set(g_stat_reorder_depth, depth);
+    }
+
+    while (g_reorder[g_release_ticket % REORDER_WINDOW].ready) {
+        reorder_slot_t *head = &g_reorder[g_release_ticket % REORDER_WINDOW];
+        record_t *out = head->rec;
+        head->ready = false;
+        head->rec = NULL;
+        g_release_ticket++;
+
+        if (out) {
+            out->sequence = ++g_sequence;
+            rate_plan_apply(out);
+            alarm_evaluate(out);
+            record_bus_publish(out);
+        }
+    }
+    xSemaphoreGive(g_reorder_mutex);
+}
+
+/*******************************************************************************
+ * Data Processing Workers
+ *
+ * PARSER_WORKER_COUNT개의 워커가 코어별로 고정되어 공유 프레임 큐에서
+ * 프레임을 가져와 파싱하고, record를 만들어 reorder stage에 제출한다.
  ******************************************************************************/
 static void data_processing_task(void *arg)
 {
     frame_item_t item;
-    parsed_field_t fields[MAX_FIELD_COUNT];
 
-    ESP_LOGI(TAG, "Data processing task started");
+    ESP_LOGI(TAG, "Data processing worker started on core %d", (int)xPortGetCoreID());
 
     while (1) {
-        if (xQueueReceive(g_frame_queue, &item, pdMS_TO_TICKS(100)) == pdTRUE) {
-            bool crc_valid = true;
-            int field_count = data_parser_parse_frame(item.data, item.length,
-                                                       fields, MAX_FIELD_COUNT);
-
-            if (field_count > 0) {
-                g_sequence++;
-
-                // Send to MQTT if connected
-                if (mqtt_handler_is_connected()) {
-                    mqtt_handler_publish_data(g_device_id, fields, field_count,
-                                              item.data, item.length, g_sequence, crc_valid);
-                }
-
-                // 특허 실시간 검증부: BLE 연결 시 항상 파싱 결과 전송
-                if (ble_service_is_connected()) {
-                    uint8_t ble_data[512];
-                    uint16_t offset = 0;
-
-                    // Packet header
-                    ble_data[offset++] = PACKET_STX;
-                    ble_data[offset++] = RSP_DATA;
-                    uint16_t len_offset = offset;
-                    offset += 2;  // Length placeholder
-
-                    // Header: timestamp(4) + sequence(2) + field_count(1) + format(1)
-                    uint32_t timestamp = (uint32_t)(esp_timer_get_time() / 1000000);
-                    memcpy(&ble_data[offset], &timestamp, 4);
-                    offset += 4;
-                    memcpy(&ble_data[offset], &g_sequence, 2);
-                    offset += 2;
-                    ble_data[offset++] = field_count;
-                    ble_data[offset++] = 1;  // Format: JSON-like with raw
-
-                    // Raw data hex (최대 32 bytes)
-                    uint8_t raw_len = (item.length > 32) ? 32 : item.length;
-                    ble_data[offset++] = raw_len;
-                    for (int i = 0; i < raw_len && offset + 2 < sizeof(ble_data) - 10; i++) {
-                        uint8_t byte = item.data[i];
-                        ble_data[offset++] = "0123456789ABCDEF"[byte >> 4];
-                        ble_data[offset++] = "0123456789ABCDEF"[byte & 0x0F];
-                    }
-
-                    // CRC verification result
-                    ble_data[offset++] = crc_valid ? 1 : 0;
-
-                    // Field values with names
-                    for (int i = 0; i < field_count && offset + 40 < sizeof(ble_data) - 10; i++) {
-                        uint8_t name_len = strlen(fields[i].name);
-                        if (name_len > 16) name_len = 16;
-                        ble_data[offset++] = name_len;
-                        memcpy(&ble_data[offset], fields[i].name, name_len);
-                        offset += name_len;
-
-                        float val = (float)fields[i].scaled_value;
-                        memcpy(&ble_data[offset], &val, 4);
-                        offset += 4;
-
-                        ble_data[offset++] = fields[i].type;
-                    }
-
-                    // Fill in length
-                    uint16_t payload_len = offset - 4;
-                    ble_data[len_offset] = payload_len & 0xFF;
-                    ble_data[len_offset + 1] = (payload_len >> 8) & 0xFF;
-
-                    // CRC and ETX
-                    uint8_t crc = 0;
-                    for (int i = 1; i < offset; i++) {
-                        crc ^= ble_data[i];
-                    }
-                    ble_data[offset++] = crc;
-                    ble_data[offset++] = PACKET_ETX;
-
-                    ble_service_notify_data(ble_data, offset);
-                }
+        if (xQueueReceive(g_frame_queue, &item, portMAX_DELAY) == pdTRUE) {
+            if (uxQueueMessagesWaiting(g_frame_queue) <= FLOW_ON_LOW_WATER) {
+                uart_handler_set_flow_off(false);
+            }
+
+            // 정의의 필드 수만큼 record를 잡고 바로 그 안에 파싱 (필드 수가 커도 스택 사용 없음)
+            uint8_t capacity = g_data_definition->field_count;
+            record_t *rec = record_alloc(capacity, item.length);
+            int field_count = -1;
+            if (rec && item.crc_valid) {
+                field_count = data_parser_parse_frame(item.data, item.length,
+                                                      rec->fields, capacity);
+            }
+            if (field_count < 0 && item.crc_valid && capacity > 0) {
+                flight_recorder_on_parse_failure();
             }
+            if (field_count <= 0 && rec &&
+                mqtt_handler_get_raw_config()->include != RAW_INCLUDE_ON_ERROR) {
+                record_release(rec);
+                rec = NULL;
+            }
+
+            if (rec) {
+                // 파싱 실패/CRC 오류 프레임도 raw 디버깅용으로 발행 (필드 없음)
+                // CRC 오류 프레임의 값은 신뢰할 수 없으므로 파싱하지 않음 - 값 소비자는 필드가 없어 건너뜀
+                rec->field_count = (field_count > 0) ? (uint8_t)field_count : 0;
+                rec->capture_us = item.capture_us;
+                rec->crc_valid = item.crc_valid;
+                memcpy(rec->raw, item.data, item.length);
+            }
+
+            // 파싱 실패도 순번은 제출해야 뒤 프레임이 막히지 않음
+            reorder_submit(item.ticket, rec);
         }
     }
 }
 
 /*******************************************************************************
- * Status Update Task
+ * Status Update Task (STATUS_INTERVAL_MS 고정 주기)
  ******************************************************************************/
-static void status_task(void *arg)
+static void status_tick(void)
 {
-    ESP_LOGI(TAG, "Status task started");
+    update_status();
 
-    while (1) {
-        vTaskDelay(pdMS_TO_TICKS(1000));  // Every 1 second (changed from 5s)
+    if (mqtt_handler_is_connected()) {
+        mqtt_handler_publish_status(g_device_id, &g_device_status);
+    }
 
-        update_status();
+    // Gateway 자식 장치 timeout(death) / 주기 status
+    gateway_tick();
 
-        if (mqtt_handler_is_connected()) {
-            mqtt_handler_publish_status(g_device_id, &g_device_status);
-        }
+    // Flight recorder 트리거 평가 (오류 급증 시 diag/flight 덤프)
+    flight_recorder_tick();
+    rate_plan_tick();
 
-        if (ble_service_is_connected()) {
-            ble_service_notify_status(&g_device_status);
-        }
+    if (ble_service_is_connected()) {
+        ble_service_notify_status(&g_device_status);
+    }
 
-        ESP_LOGI(TAG, "Status: WiFi=%d MQTT=%d UART=%d RX=%lu TX=%lu Err=%lu Heap=%lu",
-                 g_device_status.wifi_status,
-                 g_device_status.mqtt_status,
-                 g_device_status.uart_status,
-                 (unsigned long)g_device_status.rx_count,
-                 (unsigned long)g_device_status.tx_count,
-                 (unsigned long)g_device_status.error_count,
-                 (unsigned long)g_device_status.free_heap);
+    ESP_LOGI(TAG, "Status: WiFi=%d MQTT=%d UART=%d RX=%lu TX=%lu Err=%lu Heap=%lu",
+             g_device_status.wifi_status,
+             g_device_status.mqtt_status,
+             g_device_status.uart_status,
+             (unsigned long)g_device_status.rx_count,
+             (unsigned long)g_device_status.tx_count,
+             (unsigned long)g_device_status.error_count,
+             (unsigned long)g_device_status.free_heap);
+}
+
+static void status_task(void *arg)
+{
+    ESP_LOGI(TAG, "Status task started");
+
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1) {
+        // 발행 소요 시간과 무관하게 주기 유지 (vTaskDelay 누적 지연 없음)
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(STATUS_INTERVAL_MS));
+        status_tick();
     }
 }
 
@@ -260,6 +456,10 @@ static void wifi_event_handler(bool connected)
 
 static void mqtt_event_handler(bool connected)
 {
+    backfill_on_mqtt_state(connected);
+    field_topics_on_mqtt_state(connected);
+    gateway_on_mqtt_state(connected);
+
     if (connected) {
         ESP_LOGI(TAG, "MQTT connected");
         update_status();
@@ -319,47 +519,12 @@ static void ota_progress_callback(ota_state_t state, uint8_t progress, ota_error
 
 /*******************************************************************************
  * BLE Command Handler
- * v3.0 S2-3: OTA만 직접 처리, 나머지 모든 명령은 cmd_handler_process() 위임
+ * BTC 태스크 컨텍스트 - OTA 포함 모든 명령은 cmd_handler executor 큐로 전달
  ******************************************************************************/
-static void ble_command_handler(uint8_t cmd, const uint8_t *data, uint16_t len)
+static void ble_command_handler(uint8_t cmd, uint16_t seq, const uint8_t *data, uint16_t len)
 {
-    ESP_LOGI(TAG, "BLE cmd: 0x%02X (len=%d)", cmd, len);
-
-    // OTA commands handled locally (require ota_handler direct access)
-    switch (cmd) {
-        case CMD_OTA_CHECK:
-            ota_handler_check_version();
-            ble_service_send_ack(cmd, RESULT_SUCCESS);
-            return;
-        case CMD_OTA_START:
-            ota_handler_start();
-            ble_service_send_ack(cmd, RESULT_SUCCESS);
-            return;
-        case CMD_OTA_ABORT:
-            ota_handler_abort();
-            ble_service_send_ack(cmd, RESULT_SUCCESS);
-            return;
-        case CMD_OTA_ROLLBACK:
-            ota_handler_rollback();
-            ble_service_send_ack(cmd, RESULT_SUCCESS);
-            return;
-        case CMD_OTA_GET_VERSION: {
-            const ota_version_info_t *vi = ota_handler_get_version_info();
-            uint8_t vd[64];
-            int vl = snprintf((char*)vd, sizeof(vd),
-                "{\"current\":\"%s\",\"latest\":\"%s\",\"update\":%s}",
-                vi->current_version, vi->latest_version,
-                vi->update_available ? "true" : "false");
-            ble_service_notify_data(vd, vl);
-            ble_service_send_ack(cmd, RESULT_SUCCESS);
-            return;
-        }
-        default:
-            break;
-    }
-
-    // All other commands → cmd_handler.c (S2-3: single source of truth)
-    cmd_handler_process((cmd_code_t)cmd, data, len);
+    ESP_LOGI(TAG, "BLE cmd: 0x%02X (seq=%d, len=%d)", cmd, seq, len);
+    cmd_handler_process((cmd_code_t)cmd, seq, data, len);
 }
 
 /*******************************************************************************
@@ -384,34 +549,145 @@ void app_main(void)
         return;
     }
 
+    g_reorder_mutex = xSemaphoreCreateMutex();
+    if (!g_reorder_mutex) {
+        ESP_LOGE(TAG, "Failed to create mutex");
+        return;
+    }
+
     // Create frame queue
     g_frame_queue = xQueueCreate(UART_RX_QUEUE_SIZE, sizeof(frame_item_t));
     if (!g_frame_queue) {
         ESP_LOGE(TAG, "Failed to create frame queue");
         return;
     }
+    g_stat_queue_drops = stats_register("pipeline.queue_drops", STATS_COUNTER);
 
     // Initialize subsystems
     ESP_ERROR_CHECK(esp_event_loop_create_default());
     ESP_ERROR_CHECK(nvs_storage_init());
     generate_device_id();
 
+    // 일괄 설정 저장 중 전원이 꺼졌으면 먼저 마저 저장 (설정 혼합 방지)
+    cmd_handler_recover_provisioning();
+
+    // 데이터 정의는 크므로 PSRAM
+    g_data_definition = data_parser_alloc_definition();
+    if (!g_data_definition) {
+        ESP_LOGE(TAG, "Failed to allocate data definition");
+        return;
+    }
+
     // Load saved configurations
     nvs_load_wifi_config(&g_wifi_config);
     nvs_load_mqtt_config(&g_mqtt_config);
     nvs_load_uart_config(&g_uart_config);
     nvs_load_protocol_config(&g_protocol_config);
-    nvs_load_data_definition(&g_data_definition);
+    nvs_load_data_definition(g_data_definition);
 
     // Initialize data parser
     data_parser_init();
-    if (g_data_definition.field_count > 0) {
-        data_parser_set_definition(&g_data_definition);
+    if (g_data_definition->field_count > 0) {
+        data_parser_set_definition(g_data_definition);
+    }
+
+    // Raw frame policy (기본: 모든 메시지에 raw_hex)
+    raw_config_t raw_config;
+    if (nvs_load_feature_config("raw", &raw_config, sizeof(raw_config)) == ESP_OK) {
+        mqtt_handler_set_raw_config(&raw_config);
     }
 
+    // Per-field topics (기본 비활성)
+    field_topic_config_t field_topic_config;
+    if (nvs_load_feature_config("fields", &field_topic_config, sizeof(field_topic_config)) == ESP_OK) {
+        field_topics_set_config(&field_topic_config);
+    } else {
+        field_topics_set_config(NULL);
+    }
+
+    // Topic routing rules (기본: 규칙 없음 → data 토픽)
+    route_config_t route_config;
+    if (nvs_load_feature_config("routes", &route_config, sizeof(route_config)) == ESP_OK) {
+        topic_router_set_config(&route_config);
+    } else {
+        topic_router_set_config(NULL);
+    }
+
+    // Gateway mode (기본 비활성)
+    gateway_config_t gateway_config;
+    if (nvs_load_feature_config("gateway", &gateway_config, sizeof(gateway_config)) == ESP_OK) {
+        gateway_set_config(&gateway_config);
+    } else {
+        gateway_set_config(NULL);
+    }
+
+    // Adaptive batching (기본 비활성)
+    batch_config_t batch_config;
+    if (nvs_load_feature_config("batch", &batch_config, sizeof(batch_config)) == ESP_OK) {
+        mqtt_batch_set_config(&batch_config);
+    } else {
+        mqtt_batch_set_config(NULL);
+    }
+
+    // Frame dedupe (기본 비활성)
+    dedupe_config_t dedupe_config;
+    if (nvs_load_feature_config("dedupe", &dedupe_config, sizeof(dedupe_config)) == ESP_OK) {
+        frame_dedupe_set_config(&dedupe_config);
+    } else {
+        frame_dedupe_set_config(NULL);
+    }
+
+    // SNTP time source (기본: pool.ntp.org, 1시간 주기)
+    time_config_t time_config;
+    if (nvs_load_feature_config("time", &time_config, sizeof(time_config)) == ESP_OK) {
+        time_sync_set_config(&time_config);
+    } else {
+        time_sync_set_config(NULL);
+    }
+
+    // Per-field rate plan (기본 비활성: 매 record 전체 필드)
+    rate_plan_config_t rate_plan_config;
+    if (nvs_load_feature_config("rateplan", &rate_plan_config, sizeof(rate_plan_config)) == ESP_OK) {
+        rate_plan_set_config(&rate_plan_config);
+    } else {
+        rate_plan_set_config(NULL);
+    }
+
+    // Threshold alarms (기본 규칙 없음)
+    alarm_config_t alarm_config;
+    if (nvs_load_feature_config("alarms", &alarm_config, sizeof(alarm_config)) == ESP_OK) {
+        alarm_set_config(&alarm_config);
+    } else {
+        alarm_set_config(NULL);
+    }
+    ESP_ERROR_CHECK(alarm_init());
+
+    // Flight recorder (PSRAM 미탑재 시 비활성, 기본 활성)
+    flight_config_t flight_config;
+    if (nvs_load_feature_config("flight", &flight_config, sizeof(flight_config)) == ESP_OK) {
+        flight_recorder_set_config(&flight_config);
+    } else {
+        flight_recorder_set_config(NULL);
+    }
+    flight_recorder_init();
+
+    // Initialize sample store + backfill (PSRAM 미탑재 시 backfill 없이 동작)
+    backfill_config_t backfill_config;
+    if (nvs_load_feature_config("backfill", &backfill_config, sizeof(backfill_config)) == ESP_OK) {
+        backfill_set_config(&backfill_config);
+    }
+    if (sample_store_init() == ESP_OK) {
+        sample_store_reset(g_data_definition->field_count);
+        backfill_init();
+    }
+
+    // Command executor (BLE/MQTT 명령 콜백보다 먼저)
+    ESP_ERROR_CHECK(cmd_handler_init());
+
     // Initialize WiFi
     ESP_ERROR_CHECK(wifi_manager_init());
     wifi_manager_set_callback(wifi_event_handler);
+    time_sync_init();
 
     // Initialize MQTT
     ESP_ERROR_CHECK(mqtt_handler_init());
@@ -421,6 +697,9 @@ void app_main(void)
     // Initialize UART
     ESP_ERROR_CHECK(uart_handler_init());
     uart_handler_set_callback(uart_frame_handler);
+    uart_handler_set_flow_check(frame_queue_drained);
+    uart_handler_set_forward_crc_errors(
+        mqtt_handler_get_raw_config()->include == RAW_INCLUDE_ON_ERROR);
 
     // Initialize OTA
     ESP_ERROR_CHECK(ota_handler_init());
@@ -431,9 +710,17 @@ void app_main(void)
     ble_service_set_callback(ble_command_handler);
     ble_service_start();
 
-    // Create data processing task
-    xTaskCreate(data_processing_task, "data_proc", TASK_STACK_PARSER,
-                NULL, TASK_PRIORITY_PARSER, NULL);
+    // Record bus sinks (MQTT / BLE / sample store)
+    register_record_sinks();
+
+    // Create data processing workers (코어별 분산)
+    g_stat_reorder_depth = stats_register("pipeline.reorder_max", STATS_GAUGE);
+    for (int i = 0; i < PARSER_WORKER_COUNT; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "data_proc%d", i);
+        xTaskCreatePinnedToCore(data_processing_task, name, TASK_STACK_PARSER,
+                                NULL, TASK_PRIORITY_PARSER, NULL, i % portNUM_PROCESSORS);
+    }
     vTaskDelay(pdMS_TO_TICKS(100));
 
     // Start UART
@@ -448,7 +735,10 @@ void app_main(void)
     }
 
     // Create status task
-    xTaskCreate(status_task, "status", 4096, NULL, 3, NULL);
+    if (xTaskCreate(status_task, "status", TASK_STACK_STATUS, NULL,
+                    TASK_PRIORITY_STATUS, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create status task");
+    }
 
     ESP_LOGI(TAG, "System initialized - BLE: %s", DEVICE_NAME);
 }
@@ -0,0 +1,248 @@
+/**
+ * @file mqtt_batch.c
+ * @brief Adaptive Batching Controller Implementation
+ *
+ * 배치 상태와 제어 변수는 MQTT sink 태스크 전용이다.
+ * 설정 변경은 플래그로 전달되어 다음 poll에서 대기 배치를 flush하고 제어기를 초기화한다.
+ *
+ * 지연 p99: record별 (flush 시각 - 수신 시각 + RTT 평균)을 목표의 2배 범위를
+ * 32구간으로 나눈 히스토그램에 모아 LAT_WINDOW 개마다 계산한다.
+ * AIMD 증감은 새 p99가 나올 때(창 1개 완료)마다 한 번만 적용한다 - flush마다 적용하면
+ * 같은 p99로 여러 번 증감해 AIMD가 아니라 on/off 진동이 된다.
+ *
+ * RTT는 QoS>0 발행의 브로커 ACK로만 측정된다. QoS 0에서는 RTT가 0으로 남아
+ * 지연 예산에 네트워크 구간이 빠진다 (device → 브로커 송신 전까지의 지연만 제어).
+ */
+
+#include "mqtt_batch.h"
+#include "mqtt_handler.h"
+#include "stats.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+
+static const char *TAG = "Batch";
+
+#define LAT_BUCKETS         32
+#define LAT_WINDOW          200         // p99 계산 주기 (record 수)
+#define ARRIVAL_IDLE_US     1000000     // 도착 간격 상한 (저속 구간에서 EWMA 폭주 방지)
+
+static batch_config_t s_config = {
+    .enable = 0,
+    .max_records = BATCH_MAX_RECORDS,
+    .latency_ms = DEFAULT_BATCH_LATENCY_MS,
+};
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool s_config_changed = false;
+
+// 대기 배치 (sink 태스크 전용)
+static const record_t *s_pending[BATCH_MAX_RECORDS];
+static uint8_t s_pending_count = 0;
+
+// 제어 상태
+static int64_t s_last_arrival_us = 0;
+static int32_t s_arrival_us = ARRIVAL_IDLE_US;  // 도착 간격 EWMA
+static uint32_t s_deadline_us = 0;
+static uint8_t s_batch_size = 1;
+
+// e2e 지연 히스토그램
+static uint16_t s_hist[LAT_BUCKETS];
+static uint16_t s_hist_count = 0;
+static uint32_t s_p99_us = 0;
+
+static stats_id_t s_stat_size = STATS_INVALID_ID;
+static stats_id_t s_stat_deadline = STATS_INVALID_ID;
+static stats_id_t s_stat_rate = STATS_INVALID_ID;
+static stats_id_t s_stat_rtt = STATS_INVALID_ID;
+static stats_id_t s_stat_p99 = STATS_INVALID_ID;
+static stats_id_t s_stat_flushes = STATS_INVALID_ID;
+static stats_id_t s_stat_dropped = STATS_INVALID_ID;
+
+static void reset_controller(void)
+{
+    s_last_arrival_us = 0;
+    s_arrival_us = ARRIVAL_IDLE_US;
+    s_deadline_us = 0;
+    s_batch_size = 1;
+    memset(s_hist, 0, sizeof(s_hist));
+    s_hist_count = 0;
+    s_p99_us = 0;
+}
+
+static uint32_t target_us(void)
+{
+    return (uint32_t)s_config.latency_ms * 1000;
+}
+
+// 창이 완료되어 새 p99가 계산되면 true
+static bool record_latency(uint32_t latency_us)
+{
+    uint32_t width = (target_us() * 2) / LAT_BUCKETS;
+    if (width == 0) width = 1;
+
+    uint32_t idx = latency_us / width;
+    if (idx >= LAT_BUCKETS) idx = LAT_BUCKETS - 1;
+    s_hist[idx]++;
+
+    if (++s_hist_count < LAT_WINDOW) return false;
+
+    // 누적 99% 구간의 상한 = p99 (마지막 구간은 목표의 2배 이상 전체)
+    uint32_t threshold = (s_hist_count * 99 + 99) / 100;
+    uint32_t cumulative = 0;
+    for (uint32_t i = 0; i < LAT_BUCKETS; i++) {
+        cumulative += s_hist[i];
+        if (cumulative >= threshold) {
+            s_p99_us = (i + 1) * width;
+            break;
+        }
+    }
+    memset(s_hist, 0, sizeof(s_hist));
+    s_hist_count = 0;
+    return true;
+}
+
+// new_sample: 지난 호출 이후 새 p99가 나왔으면 true (AIMD 한 단계 적용)
+static void update_controller(bool new_sample)
+{
+    uint32_t rtt_mean_us, rtt_dev_us;
+    mqtt_handler_get_publish_rtt(&rtt_mean_us, &rtt_dev_us);
+
+    uint32_t target = target_us();
+    uint32_t rtt_p99 = rtt_mean_us + 3 * rtt_dev_us;
+    uint32_t budget = (target > rtt_p99) ? target - rtt_p99 : 0;
+
+    // AIMD (p99 표본당 1회): 목표 초과 시 절반, 여유 있으면 목표/16 씩 증가
+    if (new_sample) {
+        if (s_p99_us > target) {
+            s_deadline_us /= 2;
+        } else if (s_p99_us < target / 4 * 3) {
+            s_deadline_us += target / 16;
+        }
+    }
+    if (s_deadline_us > budget) s_deadline_us = budget;
+
+    uint32_t expected = (s_arrival_us > 0) ? s_deadline_us / (uint32_t)s_arrival_us + 1 : 1;
+    if (expected > s_config.max_records) expected = s_config.max_records;
+    s_batch_size = (uint8_t)expected;
+
+    stats_set(s_stat_size, s_batch_size);
+    stats_set(s_stat_deadline, s_deadline_us / 1000);
+    stats_set(s_stat_rate, (s_arrival_us > 0) ? 1000000 / (uint32_t)s_arrival_us : 0);
+    stats_set(s_stat_rtt, rtt_mean_us / 1000);
+    stats_set(s_stat_p99, s_p99_us / 1000);
+}
+
+static void flush(void)
+{
+    if (s_pending_count == 0) return;
+
+    esp_err_t ret = mqtt_handler_publish_batch(s_pending, s_pending_count);
+    int64_t now_us = esp_timer_get_time();
+
+    uint32_t rtt_mean_us;
+    mqtt_handler_get_publish_rtt(&rtt_mean_us, NULL);
+
+    bool new_sample = false;
+    for (uint8_t i = 0; i < s_pending_count; i++) {
+        if (ret == ESP_OK &&
+            record_latency((uint32_t)(now_us - s_pending[i]->capture_us) + rtt_mean_us)) {
+            new_sample = true;
+        }
+        record_release(s_pending[i]);
+        s_pending[i] = NULL;
+    }
+
+    if (ret == ESP_OK) {
+        stats_inc(s_stat_flushes);
+    } else {
+        stats_add(s_stat_dropped, s_pending_count);
+    }
+    s_pending_count = 0;
+
+    update_controller(new_sample);
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+void mqtt_batch_set_config(const batch_config_t *config)
+{
+    batch_config_t cfg = {
+        .enable = 0,
+        .max_records = BATCH_MAX_RECORDS,
+        .latency_ms = DEFAULT_BATCH_LATENCY_MS,
+    };
+    if (config) {
+        memcpy(&cfg, config, sizeof(batch_config_t));
+    }
+    if (cfg.max_records == 0 || cfg.max_records > BATCH_MAX_RECORDS) {
+        cfg.max_records = BATCH_MAX_RECORDS;
+    }
+    if (cfg.latency_ms == 0) cfg.latency_ms = DEFAULT_BATCH_LATENCY_MS;
+
+    if (s_stat_size == STATS_INVALID_ID) {
+        s_stat_size = stats_register("batch.size", STATS_GAUGE);
+        s_stat_deadline = stats_register("batch.deadline_ms", STATS_GAUGE);
+        s_stat_rate = stats_register("batch.rate_hz", STATS_GAUGE);
+        s_stat_rtt = stats_register("batch.rtt_ms", STATS_GAUGE);
+        s_stat_p99 = stats_register("batch.p99_ms", STATS_GAUGE);
+        s_stat_flushes = stats_register("batch.flushes", STATS_COUNTER);
+        s_stat_dropped = stats_register("batch.dropped", STATS_COUNTER);
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    memcpy(&s_config, &cfg, sizeof(batch_config_t));
+    s_config_changed = true;
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "Config: enable=%d max=%d p99 target=%dms",
+             cfg.enable, cfg.max_records, cfg.latency_ms);
+}
+
+const batch_config_t* mqtt_batch_get_config(void)
+{
+    return &s_config;
+}
+
+bool mqtt_batch_add(const record_t *rec)
+{
+    if (!s_config.enable || !rec || s_config_changed) return false;
+
+    // 도착 간격 EWMA (1/8)
+    if (s_last_arrival_us > 0) {
+        int64_t interval = rec->capture_us - s_last_arrival_us;
+        if (interval < 0) interval = 0;
+        if (interval > ARRIVAL_IDLE_US) interval = ARRIVAL_IDLE_US;
+        s_arrival_us += ((int32_t)interval - s_arrival_us) / 8;
+    }
+    s_last_arrival_us = rec->capture_us;
+
+    record_retain(rec);
+    s_pending[s_pending_count++] = rec;
+
+    if (s_pending_count >= s_batch_size || s_pending_count >= BATCH_MAX_RECORDS) {
+        flush();
+    }
+    return true;
+}
+
+uint32_t mqtt_batch_poll(void)
+{
+    if (s_config_changed) {
+        flush();
+        reset_controller();
+        s_config_changed = false;
+        update_controller(false);
+    }
+
+    if (s_pending_count == 0) return RECORD_SINK_WAIT_FOREVER;
+
+    int64_t now_us = esp_timer_get_time();
+    int64_t due_us = s_pending[0]->capture_us + s_deadline_us;
+    if (now_us >= due_us) {
+        flush();
+        return RECORD_SINK_WAIT_FOREVER;
+    }
+    return (uint32_t)((due_us - now_us + 999) / 1000);
+}
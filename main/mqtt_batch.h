@@ -0,0 +1,58 @@
+/**
+ * @file mqtt_batch.h
+ * @brief Adaptive Batching Controller for Data Publishing
+ *
+ * MQTT sink에서 record를 모아 .../data/batch 토픽에 JSON 배열로 발행한다.
+ * 도착률과 publish RTT를 측정해 p99 end-to-end 지연 목표를 지키는 범위에서
+ * flush deadline과 배치 크기를 키워 초당 메시지 수를 최소화한다.
+ * - 지연 측정치 p99 > 목표 → deadline 절반 (multiplicative decrease)
+ * - p99 < 목표 x 3/4 → deadline 증가 (additive increase)
+ * - deadline 상한 = 목표 - RTT p99 추정 (mean + 3 x deviation)
+ * - 배치 크기 = deadline 동안 예상 도착 수 (1 ~ max_records)
+ * 증감은 p99 표본(LAT_WINDOW record)마다 한 번. RTT는 QoS>0에서만 측정되므로
+ * QoS 0이면 지연 목표에 네트워크 RTT가 포함되지 않는다.
+ * 제어 상태는 batch.* 통계로 노출된다.
+ */
+
+#ifndef MQTT_BATCH_H
+#define MQTT_BATCH_H
+
+#include "protocol_def.h"
+#include "record_bus.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 설정 적용 (대기 중인 배치는 다음 poll에서 flush)
+ * @param config 설정 (NULL이면 기본값: 비활성)
+ */
+void mqtt_batch_set_config(const batch_config_t *config);
+
+/**
+ * @brief 현재 설정 반환
+ */
+const batch_config_t* mqtt_batch_get_config(void);
+
+/**
+ * @brief Record를 배치에 추가 (MQTT sink 태스크에서 호출)
+ *
+ * 라우팅 규칙에 매칭되는 record는 호출자가 먼저 걸러 개별 발행한다.
+ * @param rec 파싱 결과 record (배치가 참조를 보유)
+ * @return true if batched (false면 호출자가 개별 발행)
+ */
+bool mqtt_batch_add(const record_t *rec);
+
+/**
+ * @brief Deadline 도달 시 flush (MQTT sink poll 함수에서 호출)
+ * @return 다음 deadline까지 남은 시간 (ms), 대기 배치 없으면 RECORD_SINK_WAIT_FOREVER
+ */
+uint32_t mqtt_batch_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MQTT_BATCH_H
@@ -13,14 +13,23 @@
 #include "mqtt_handler.h"
 #include "mqtt_client.h"
 #include "wifi_manager.h"
+#include "stats.h"
+#include "data_parser.h"
+#include "json_template.h"
+#include "encode_utils.h"
+#include "field_topics.h"
+#include "topic_router.h"
+#include "alarm_engine.h"
+#include "rate_plan.h"
+#include "time_sync.h"
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_timer.h"
 #include "cJSON.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
 #include <string.h>
-#include <time.h>
 
 static const char *TAG = "MQTT";
 
@@ -29,13 +38,74 @@ static bool s_connected = false;
 static mqtt_event_cb_t s_event_callback = NULL;
 static mqtt_cmd_cb_t s_cmd_callback = NULL;         // v2.1: 원격 명령 콜백
 static mqtt_config_data_t s_config = {0};
-static uint32_t s_tx_count = 0;
+static stats_id_t s_stat_tx = STATS_INVALID_ID;
+static stats_id_t s_stat_disconnects = STATS_INVALID_ID;
 static SemaphoreHandle_t s_mutex = NULL;
+static json_template_t s_data_tpl = {0};          // data 토픽 사전 컴파일 템플릿
+static raw_config_t s_raw_cfg = {
+    .include = RAW_INCLUDE_ALWAYS,
+    .encoding = RAW_ENCODING_HEX,
+    .sample_every = DEFAULT_RAW_SAMPLE_EVERY,
+};
+static uint32_t s_raw_sample_count = 0;
+static stats_id_t s_stat_raw = STATS_INVALID_ID;
+
+// Publish RTT 측정 (QoS>0 batch 발행 → MQTT_EVENT_PUBLISHED)
+#define RTT_TRACK_SLOTS     8
+
+typedef struct {
+    int msg_id;
+    int64_t sent_us;
+} rtt_slot_t;
+
+static rtt_slot_t s_rtt_slots[RTT_TRACK_SLOTS];
+static uint8_t s_rtt_next = 0;
+static uint32_t s_rtt_mean_us = 0;
+static uint32_t s_rtt_dev_us = 0;
+static portMUX_TYPE s_rtt_lock = portMUX_INITIALIZER_UNLOCKED;
 
 // Forward declarations
 static void handle_remote_command(const char *topic, const char *payload, int len);
 static void handle_config_download(const char *payload, int len);
 
+/*******************************************************************************
+ * Publish RTT (TCP RTO 방식 EWMA: mean 1/8, deviation 1/4)
+ ******************************************************************************/
+static void rtt_track(int msg_id)
+{
+    if (msg_id <= 0) return;    // QoS 0은 ACK 없음
+
+    portENTER_CRITICAL(&s_rtt_lock);
+    s_rtt_slots[s_rtt_next].msg_id = msg_id;
+    s_rtt_slots[s_rtt_next].sent_us = esp_timer_get_time();
+    s_rtt_next = (s_rtt_next + 1) % RTT_TRACK_SLOTS;
+    portEXIT_CRITICAL(&s_rtt_lock);
+}
+
+static void rtt_on_published(int msg_id)
+{
+    int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_rtt_lock);
+    for (int i = 0; i < RTT_TRACK_SLOTS; i++) {
+        if (s_rtt_slots[i].msg_id != msg_id || s_rtt_slots[i].sent_us == 0) continue;
+
+        int32_t rtt = (int32_t)(now_us - s_rtt_slots[i].sent_us);
+        if (s_rtt_mean_us == 0) {
+            s_rtt_mean_us = rtt;
+            s_rtt_dev_us = rtt / 2;
+        } else {
+            int32_t err = rtt - (int32_t)s_rtt_mean_us;
+            s_rtt_mean_us += err / 8;
+            s_rtt_dev_us += ((err < 0 ? -err : err) - (int32_t)s_rtt_dev_us) / 4;
+        }
+        s_rtt_slots[i].msg_id = 0;
+        s_rtt_slots[i].sent_us = 0;
+        break;
+    }
+    portEXIT_CRITICAL(&s_rtt_lock);
+}
+
 /*******************************************************************************
  * MQTT Event Handler
  ******************************************************************************/
@@ -80,9 +150,14 @@ static void mqtt_event_handler(void *args, esp_event_base_t base,
         case MQTT_EVENT_DISCONNECTED:
             ESP_LOGW(TAG, "Disconnected");
             s_connected = false;
+            stats_inc(s_stat_disconnects);
             if (s_event_callback) s_event_callback(false);
             break;
 
+        case MQTT_EVENT_PUBLISHED:
+            rtt_on_published(event->msg_id);
+            break;
+
         case MQTT_EVENT_DATA:
             ESP_LOGI(TAG, "Data received on topic: %.*s", event->topic_len, event->topic);
             
@@ -150,6 +225,8 @@ static void handle_remote_command(const char *topic, const char *payload, int le
             cmd.command = MQTT_CMD_STOP_MONITOR;
         } else if (strcmp(cmd_str, "factory_reset") == 0) {
             cmd.command = MQTT_CMD_FACTORY_RESET;
+        } else if (strcmp(cmd_str, "query_history") == 0) {
+            cmd.command = MQTT_CMD_QUERY_HISTORY;
         }
     }
     
@@ -180,14 +257,13 @@ static void handle_remote_command(const char *topic, const char *payload, int le
         }
     }
     
-    // 콜백 호출
+    // 콜백 호출 - 접수/거부/결과 응답은 모두 명령 처리부가 보냄 (중복 수신은 응답 없음)
     if (s_cmd_callback) {
         s_cmd_callback(&cmd, cmd_payload);
+    } else {
+        mqtt_handler_send_command_response(cmd.request_id, false, "Not supported");
     }
     
-    // 응답 전송
-    mqtt_handler_send_command_response(cmd.request_id, true, "Command received");
-    
     cJSON_Delete(root);
 }
 
@@ -215,7 +291,7 @@ static void handle_config_download(const char *payload, int len)
                 mqtt_remote_command_t cmd = {
                     .command = MQTT_CMD_UPDATE_CONFIG,
                     .config_type = CONFIG_TYPE_ALL,
-                    .timestamp = (uint32_t)time(NULL)
+                    .timestamp = (uint32_t)time_sync_now()
                 };
                 s_cmd_callback(&cmd, config);
             }
@@ -236,6 +312,9 @@ esp_err_t mqtt_handler_init(void)
         s_mutex = xSemaphoreCreateMutex();
         if (!s_mutex) return ESP_FAIL;
     }
+    s_stat_tx = stats_register("mqtt.tx_messages", STATS_COUNTER);
+    s_stat_disconnects = stats_register("mqtt.disconnects", STATS_COUNTER);
+    s_stat_raw = stats_register("mqtt.raw_included", STATS_COUNTER);
     ESP_LOGI(TAG, "MQTT Handler initialized (v3.0)");
     return ESP_OK;
 }
@@ -249,6 +328,9 @@ esp_err_t mqtt_handler_start(const mqtt_config_data_t *config)
     mqtt_handler_stop();
     memcpy(&s_config, config, sizeof(mqtt_config_data_t));
 
+    // device_id/user_id가 바뀌었을 수 있으므로 data 템플릿 재컴파일
+    mqtt_handler_set_data_definition(data_parser_get_definition());
+
     // URI 생성
     char uri[256];
     snprintf(uri, sizeof(uri), "%s://%s:%d",
@@ -308,92 +390,166 @@ bool mqtt_handler_is_connected(void)
 /*******************************************************************************
  * Helper Functions
  ******************************************************************************/
-static const char* data_type_str(data_type_t type)
-{
-    switch (type) {
-        case DATA_TYPE_BOOL:        return "BOOL";
-        case DATA_TYPE_UINT8:       return "UINT8";
-        case DATA_TYPE_INT8:        return "INT8";
-        case DATA_TYPE_UINT16:      return "UINT16";
-        case DATA_TYPE_INT16:       return "INT16";
-        case DATA_TYPE_UINT32:      return "UINT32";
-        case DATA_TYPE_INT32:       return "INT32";
-        case DATA_TYPE_UINT64:      return "UINT64";
-        case DATA_TYPE_INT64:       return "INT64";
-        case DATA_TYPE_FLOAT32:     return "FLOAT32";
-        case DATA_TYPE_FLOAT64:     return "FLOAT64";
-        case DATA_TYPE_STRING:      return "STRING";
-        case DATA_TYPE_TIMESTAMP:   return "TIMESTAMP";
-        default:                    return "UNKNOWN";
-    }
-}
-
 // Build topic string - v3.0: user_id/device_id 필수 (legacy 토픽 제거)
-static void build_topic(char *out, size_t out_size, const char *suffix)
+static void build_device_topic(char *out, size_t out_size, const char *device_id,
+                               const char *suffix)
 {
-    if (strlen(s_config.user_id) > 0 && strlen(s_config.device_id) > 0) {
+    if (strlen(s_config.user_id) > 0 && strlen(device_id) > 0) {
         // v3.0 SaaS format: user/{user_id}/device/{device_id}/{suffix}
         snprintf(out, out_size, "user/%s/device/%s/%s",
-                 s_config.user_id, s_config.device_id, suffix);
+                 s_config.user_id, device_id, suffix);
     } else {
         // v3.0: user_id/device_id 미설정 시 에러 로그
         ESP_LOGE(TAG, "Cannot build topic: user_id or device_id not set!");
         snprintf(out, out_size, "unconfigured/device/%s/%s", 
-                 strlen(s_config.device_id) > 0 ? s_config.device_id : "unknown", suffix);
+                 strlen(device_id) > 0 ? device_id : "unknown", suffix);
     }
 }
 
+static void build_topic(char *out, size_t out_size, const char *suffix)
+{
+    build_device_topic(out, out_size, s_config.device_id, suffix);
+}
+
 /*******************************************************************************
- * Data Publishing - v2.1 Enhanced
+ * Generic Publishing (pre-serialized payload)
  ******************************************************************************/
-esp_err_t mqtt_handler_publish_data(const char *device_id,
-                                    const parsed_field_t *fields,
-                                    uint8_t field_count,
-                                    const uint8_t *raw_data,
-                                    size_t raw_len,
-                                    uint16_t sequence,
-                                    bool crc_valid)    // v2.1: CRC 검증 결과 추가
+void mqtt_handler_build_topic(char *out, size_t out_size, const char *suffix)
+{
+    if (!out || out_size == 0 || !suffix) return;
+    build_topic(out, out_size, suffix);
+}
+
+void mqtt_handler_build_device_topic(char *out, size_t out_size, const char *device_id,
+                                     const char *suffix)
 {
+    if (!out || out_size == 0 || !device_id || !suffix) return;
+    build_device_topic(out, out_size, device_id, suffix);
+}
+
+esp_err_t mqtt_handler_publish(const char *suffix, const char *payload, size_t len,
+                               uint8_t qos, bool retain)
+{
+    if (!suffix || !payload) return ESP_ERR_INVALID_ARG;
     if (!s_connected || !s_client) return ESP_ERR_INVALID_STATE;
-    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
+
+    char topic[256];
+    build_topic(topic, sizeof(topic), suffix);
+    return mqtt_handler_publish_topic(topic, payload, len, qos, retain);
+}
+
+esp_err_t mqtt_handler_publish_topic(const char *topic, const char *payload, size_t len,
+                                     uint8_t qos, bool retain)
+{
+    if (!topic || !payload) return ESP_ERR_INVALID_ARG;
+    if (!s_connected || !s_client) return ESP_ERR_INVALID_STATE;
+
+    int msg_id = esp_mqtt_client_publish(s_client, topic, payload, len, qos, retain ? 1 : 0);
+    if (msg_id < 0) {
+        ESP_LOGW(TAG, "Publish to %s failed", topic);
+        return ESP_FAIL;
     }
 
-    esp_err_t ret = ESP_FAIL;
-    cJSON *root = cJSON_CreateObject();
-    if (!root) {
-        xSemaphoreGive(s_mutex);
-        return ESP_ERR_NO_MEM;
+    stats_inc(s_stat_tx);
+    ESP_LOGD(TAG, "Published to %s", topic);
+    return ESP_OK;
+}
+
+/*******************************************************************************
+ * Raw Frame Policy
+ ******************************************************************************/
+// field_count == 0 이면 파싱 실패 프레임
+static bool should_include_raw(bool crc_valid, uint8_t field_count)
+{
+    switch (s_raw_cfg.include) {
+        case RAW_INCLUDE_NEVER:
+            return false;
+        case RAW_INCLUDE_ON_ERROR:
+            return !crc_valid || field_count == 0;
+        case RAW_INCLUDE_SAMPLED:
+            return (s_raw_sample_count++ % s_raw_cfg.sample_every) == 0;
+        case RAW_INCLUDE_ALWAYS:
+        default:
+            return true;
+    }
+}
+
+void mqtt_handler_set_raw_config(const raw_config_t *config)
+{
+    raw_config_t cfg = {
+        .include = RAW_INCLUDE_ALWAYS,
+        .encoding = RAW_ENCODING_HEX,
+        .sample_every = DEFAULT_RAW_SAMPLE_EVERY,
+    };
+    if (config) {
+        memcpy(&cfg, config, sizeof(raw_config_t));
     }
+    if (cfg.include > RAW_INCLUDE_SAMPLED) cfg.include = RAW_INCLUDE_ALWAYS;
+    if (cfg.encoding > RAW_ENCODING_BASE64) cfg.encoding = RAW_ENCODING_HEX;
+    if (cfg.sample_every == 0) cfg.sample_every = DEFAULT_RAW_SAMPLE_EVERY;
+
+    if (s_mutex) xSemaphoreTake(s_mutex, portMAX_DELAY);
+    memcpy(&s_raw_cfg, &cfg, sizeof(raw_config_t));
+    s_raw_sample_count = 0;
+    if (s_mutex) xSemaphoreGive(s_mutex);
+
+    ESP_LOGI(TAG, "Raw policy: include=%d encoding=%d every=%d",
+             cfg.include, cfg.encoding, cfg.sample_every);
+}
+
+const raw_config_t* mqtt_handler_get_raw_config(void)
+{
+    return &s_raw_cfg;
+}
+
+/*******************************************************************************
+ * Data Publishing - v2.1 Enhanced
+ ******************************************************************************/
+// cJSON 경로 data 메시지 직렬화 (gateway_id는 gateway 자식 장치일 때만)
+// timestamp는 발행 시각이 아닌 record 수신 시각 (time_sync 매핑, ms 해상도)
+static char* build_data_json(const char *dev_id, const char *gateway_id,
+                             const record_t *rec, const uint8_t *raw_data, size_t raw_len,
+                             uint16_t sequence, uint64_t field_mask)
+{
+    const parsed_field_t *fields = rec->fields;
+    uint8_t field_count = rec->field_count;
+    bool time_valid = false;
+    double timestamp = time_sync_timestamp(rec->capture_us, &time_valid);
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root) return NULL;
 
     // v2.1 필수 필드
-    const char *dev_id = (strlen(s_config.device_id) > 0) ? s_config.device_id : device_id;
     cJSON_AddStringToObject(root, "device_id", dev_id);
     
     // v2.1: user_id 추가 (필수)
     if (strlen(s_config.user_id) > 0) {
         cJSON_AddStringToObject(root, "user_id", s_config.user_id);
     }
+    if (gateway_id) {
+        cJSON_AddStringToObject(root, "gateway_id", gateway_id);
+    }
     
-    cJSON_AddNumberToObject(root, "timestamp", (double)time(NULL));
+    cJSON_AddNumberToObject(root, "timestamp", timestamp);
+    cJSON_AddBoolToObject(root, "time_valid", time_valid);
     cJSON_AddNumberToObject(root, "sequence", sequence);
     cJSON_AddStringToObject(root, "protocol", "custom");
     
     // v2.1: crc_valid 추가
-    cJSON_AddBoolToObject(root, "crc_valid", crc_valid);
+    cJSON_AddBoolToObject(root, "crc_valid", rec->crc_valid);
     
     // v2.1: schema_version 추가
     cJSON_AddStringToObject(root, "schema_version", SCHEMA_VERSION_STRING);
 
-    // Raw hex 데이터
+    // Raw 데이터 (hex 또는 base64)
     if (raw_data && raw_len > 0) {
-        char *hex = malloc(raw_len * 2 + 1);
-        if (hex) {
-            for (size_t i = 0; i < raw_len; i++) {
-                sprintf(&hex[i * 2], "%02X", raw_data[i]);
-            }
-            cJSON_AddStringToObject(root, "raw_hex", hex);
-            free(hex);
+        bool b64 = (s_raw_cfg.encoding == RAW_ENCODING_BASE64);
+        char *enc = malloc((b64 ? ENCODE_BASE64_LEN(raw_len) : ENCODE_HEX_LEN(raw_len)) + 1);
+        if (enc) {
+            size_t n = b64 ? encode_base64(raw_data, raw_len, enc) : encode_hex(raw_data, raw_len, enc);
+            enc[n] = '\0';
+            cJSON_AddStringToObject(root, b64 ? "raw_b64" : "raw_hex", enc);
+            free(enc);
         }
     }
 
@@ -401,10 +557,11 @@ esp_err_t mqtt_handler_publish_data(const char *device_id,
     cJSON *fields_obj = cJSON_CreateObject();
     if (fields_obj) {
         for (uint8_t i = 0; i < field_count; i++) {
+            if (i < FIELD_MASK_BITS && !(field_mask & FIELD_MASK_BIT(i))) continue;  // rate plan: 발행 주기 아님
             cJSON *field = cJSON_CreateObject();
             if (field) {
                 cJSON_AddNumberToObject(field, "value", fields[i].scaled_value);
-                cJSON_AddStringToObject(field, "type", data_type_str(fields[i].type));
+                cJSON_AddStringToObject(field, "type", data_parser_type_name(fields[i].type));
                 // v2.1: raw 값도 추가 (디버깅용)
                 if (fields[i].type == DATA_TYPE_UINT32 || fields[i].type == DATA_TYPE_INT32) {
                     cJSON_AddNumberToObject(field, "raw", fields[i].value.u32);
@@ -415,27 +572,226 @@ esp_err_t mqtt_handler_publish_data(const char *device_id,
         cJSON_AddItemToObject(root, "fields", fields_obj);
     }
 
-    // JSON 문자열 변환 및 발행
     char *json_str = cJSON_PrintUnformatted(root);
-    if (json_str) {
-        char topic[256];
-        build_topic(topic, sizeof(topic), "data");
+    cJSON_Delete(root);
+    return json_str;
+}
 
-        int msg_id = esp_mqtt_client_publish(s_client, topic, json_str,
-                                              strlen(json_str), s_config.qos, 0);
+// Raw 포함 정책 적용 (제외 시 raw_data/raw_len을 비움)
+static void apply_raw_policy(const uint8_t **raw_data, size_t *raw_len,
+                             bool crc_valid, uint8_t field_count)
+{
+    if (!*raw_data || *raw_len == 0 || !should_include_raw(crc_valid, field_count)) {
+        *raw_data = NULL;
+        *raw_len = 0;
+    } else {
+        stats_inc(s_stat_raw);
+    }
+}
+
+// 템플릿 경로로 record 직렬화 (필드 구성이 템플릿과 다르면 NULL)
+static const char* render_data_template(const record_t *rec, const uint8_t *raw_data,
+                                        size_t raw_len, size_t *out_len)
+{
+    bool time_valid = false;
+    double timestamp = time_sync_timestamp(rec->capture_us, &time_valid);
+    return json_template_render(&s_data_tpl, timestamp, time_valid, rec->sequence,
+                                rec->crc_valid, raw_data, raw_len, s_raw_cfg.encoding,
+                                rec->fields, rec->field_count, rec->field_mask, out_len);
+}
+
+esp_err_t mqtt_handler_publish_data(const char *device_id, const record_t *rec)
+{
+    if (!rec) return ESP_ERR_INVALID_ARG;
+
+    // 내용 기반 라우팅 (매칭 규칙 없으면 data 토픽)
+    char topic[256];
+    uint8_t qos = s_config.qos;
+    if (topic_router_match(rec->fields, rec->field_count, rec->raw, rec->raw_len,
+                           topic, sizeof(topic), &qos)) {
+        return mqtt_handler_publish_data_to(device_id, rec, topic, qos);
+    }
+    return mqtt_handler_publish_data_to(device_id, rec, NULL, 0);
+}
+
+esp_err_t mqtt_handler_publish_data_to(const char *device_id, const record_t *rec,
+                                       const char *routed_topic, uint8_t routed_qos)
+{
+    if (!rec) return ESP_ERR_INVALID_ARG;
+    if (!s_connected || !s_client) return ESP_ERR_INVALID_STATE;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_err_t ret = ESP_FAIL;
+    char data_topic[256];
+    const char *topic = routed_topic;
+    uint8_t qos = routed_qos;
+    if (!topic) {
+        build_topic(data_topic, sizeof(data_topic), "data");
+        topic = data_topic;
+        qos = s_config.qos;
+    }
+
+    const uint8_t *raw_data = rec->raw;
+    size_t raw_len = rec->raw_len;
+
+    apply_raw_policy(&raw_data, &raw_len, rec->crc_valid, rec->field_count);
+
+    // 사전 컴파일 템플릿 경로 (필드 구성이 템플릿과 같을 때)
+    size_t tpl_len = 0;
+    const char *tpl_json = render_data_template(rec, raw_data, raw_len, &tpl_len);
+    if (tpl_json) {
+        int msg_id = esp_mqtt_client_publish(s_client, topic, tpl_json,
+                                              tpl_len, qos, 0);
         if (msg_id >= 0) {
-            s_tx_count++;
+            stats_inc(s_stat_tx);
             ret = ESP_OK;
             ESP_LOGD(TAG, "Published to %s", topic);
         }
-        free(json_str);
+        xSemaphoreGive(s_mutex);
+        return ret;
     }
 
-    cJSON_Delete(root);
+    // JSON 문자열 변환 및 발행
+    const char *dev_id = (strlen(s_config.device_id) > 0) ? s_config.device_id : device_id;
+    char *json_str = build_data_json(dev_id, NULL, rec, raw_data, raw_len,
+                                     rec->sequence, rec->field_mask);
+    if (!json_str) {
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_NO_MEM;
+    }
+
+    int msg_id = esp_mqtt_client_publish(s_client, topic, json_str,
+                                          strlen(json_str), qos, 0);
+    if (msg_id >= 0) {
+        stats_inc(s_stat_tx);
+        ret = ESP_OK;
+        ESP_LOGD(TAG, "Published to %s", topic);
+    }
+    free(json_str);
+
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+esp_err_t mqtt_handler_publish_child_data(const char *child_id, const record_t *rec,
+                                          uint16_t sequence)
+{
+    if (!child_id || !rec) return ESP_ERR_INVALID_ARG;
+    if (!s_connected || !s_client) return ESP_ERR_INVALID_STATE;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_err_t ret = ESP_FAIL;
+    char topic[256];
+    build_device_topic(topic, sizeof(topic), child_id, "data");
+
+    const uint8_t *raw_data = rec->raw;
+    size_t raw_len = rec->raw_len;
+    apply_raw_policy(&raw_data, &raw_len, rec->crc_valid, rec->field_count);
+
+    // 템플릿에는 부모 device_id가 고정되어 있으므로 자식 장치는 cJSON 경로 사용
+    char *json_str = build_data_json(child_id, s_config.device_id, rec, raw_data, raw_len,
+                                     sequence, FIELD_MASK_ALL);
+    if (!json_str) {
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_NO_MEM;
+    }
+
+    int msg_id = esp_mqtt_client_publish(s_client, topic, json_str,
+                                          strlen(json_str), s_config.qos, 0);
+    if (msg_id >= 0) {
+        stats_inc(s_stat_tx);
+        ret = ESP_OK;
+        ESP_LOGD(TAG, "Published to %s", topic);
+    }
+    free(json_str);
+
     xSemaphoreGive(s_mutex);
     return ret;
 }
 
+// 배치 버퍼에 문자열 추가 (필요 시 확장)
+static bool batch_append(char **buf, size_t *len, size_t *cap, const char *s, size_t n)
+{
+    if (*len + n + 2 > *cap) {
+        size_t new_cap = (*cap * 2 > *len + n + 2) ? *cap * 2 : *len + n + 2;
+        char *p = realloc(*buf, new_cap);
+        if (!p) return false;
+        *buf = p;
+        *cap = new_cap;
+    }
+    memcpy(*buf + *len, s, n);
+    *len += n;
+    return true;
+}
+
+esp_err_t mqtt_handler_publish_batch(const record_t *const *records, size_t count)
+{
+    if (!records || count == 0) return ESP_ERR_INVALID_ARG;
+    if (!s_connected || !s_client) return ESP_ERR_INVALID_STATE;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    char topic[256];
+    build_topic(topic, sizeof(topic), "data/batch");
+
+    size_t cap = (s_data_tpl.valid ? s_data_tpl.out_capacity : 1024) * 2;
+    size_t len = 0;
+    char *buf = malloc(cap);
+    bool ok = (buf != NULL) && batch_append(&buf, &len, &cap, "[", 1);
+
+    // 각 record는 data 토픽과 같은 인코딩 (템플릿 또는 cJSON, raw 정책 포함)
+    for (size_t i = 0; ok && i < count; i++) {
+        const record_t *rec = records[i];
+        const uint8_t *raw_data = rec->raw;
+        size_t raw_len = rec->raw_len;
+        apply_raw_policy(&raw_data, &raw_len, rec->crc_valid, rec->field_count);
+
+        if (i > 0) ok = batch_append(&buf, &len, &cap, ",", 1);
+
+        size_t item_len = 0;
+        const char *item = render_data_template(rec, raw_data, raw_len, &item_len);
+        if (item) {
+            ok = ok && batch_append(&buf, &len, &cap, item, item_len);
+        } else {
+            char *json_str = build_data_json(s_config.device_id, NULL, rec, raw_data, raw_len,
+                                             rec->sequence, rec->field_mask);
+            ok = ok && json_str && batch_append(&buf, &len, &cap, json_str, strlen(json_str));
+            free(json_str);
+        }
+    }
+    ok = ok && batch_append(&buf, &len, &cap, "]", 1);
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    if (ok) {
+        int msg_id = esp_mqtt_client_publish(s_client, topic, buf, len, s_config.qos, 0);
+        if (msg_id >= 0) {
+            rtt_track(msg_id);
+            stats_inc(s_stat_tx);
+            ret = ESP_OK;
+            ESP_LOGD(TAG, "Published %d records to %s", (int)count, topic);
+        } else {
+            ret = ESP_FAIL;
+        }
+    }
+    free(buf);
+
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+void mqtt_handler_get_publish_rtt(uint32_t *mean_us, uint32_t *dev_us)
+{
+    portENTER_CRITICAL(&s_rtt_lock);
+    if (mean_us) *mean_us = s_rtt_mean_us;
+    if (dev_us) *dev_us = s_rtt_dev_us;
+    portEXIT_CRITICAL(&s_rtt_lock);
+}
+
 /*******************************************************************************
  * Status Publishing - v2.1 Enhanced
  ******************************************************************************/
@@ -463,7 +819,7 @@ esp_err_t mqtt_handler_publish_status(const char *device_id,
         cJSON_AddStringToObject(root, "user_id", s_config.user_id);
     }
     
-    cJSON_AddNumberToObject(root, "timestamp", (double)time(NULL));
+    cJSON_AddNumberToObject(root, "timestamp", time_sync_now());
     
     // 연결 상태
     cJSON_AddBoolToObject(root, "wifi_connected", status->wifi_status != 0);
@@ -495,6 +851,17 @@ esp_err_t mqtt_handler_publish_status(const char *device_id,
         cJSON_AddStringToObject(root, "config_hash", status->config_hash);
     }
 
+    // 등록된 전체 파이프라인 통계 (stats registry 스냅샷)
+    cJSON *metrics = cJSON_CreateObject();
+    if (metrics) {
+        stats_entry_t entries[STATS_MAX_METRICS];
+        size_t n = stats_snapshot(entries, STATS_MAX_METRICS);
+        for (size_t i = 0; i < n; i++) {
+            cJSON_AddNumberToObject(metrics, entries[i].name, entries[i].value);
+        }
+        cJSON_AddItemToObject(root, "metrics", metrics);
+    }
+
     // 펌웨어 버전
     char fw[16];
     snprintf(fw, sizeof(fw), "%u.%u.%u",
@@ -553,7 +920,7 @@ esp_err_t mqtt_handler_request_config_sync(void)
     cJSON_AddStringToObject(root, "user_id", s_config.user_id);
     cJSON_AddStringToObject(root, "current_version", SCHEMA_VERSION_STRING);
     cJSON_AddStringToObject(root, "config_hash", "");  // TODO: 실제 해시 계산
-    cJSON_AddNumberToObject(root, "timestamp", (double)time(NULL));
+    cJSON_AddNumberToObject(root, "timestamp", time_sync_now());
 
     char *json_str = cJSON_PrintUnformatted(root);
     if (json_str) {
@@ -595,7 +962,7 @@ esp_err_t mqtt_handler_send_command_response(const char *request_id,
 
     cJSON_AddStringToObject(root, "request_id", request_id);
     cJSON_AddBoolToObject(root, "success", success);
-    cJSON_AddNumberToObject(root, "timestamp", (double)time(NULL));
+    cJSON_AddNumberToObject(root, "timestamp", time_sync_now());
     if (message) {
         cJSON_AddStringToObject(root, "message", message);
     }
@@ -622,9 +989,25 @@ esp_err_t mqtt_handler_send_command_response(const char *request_id,
 /*******************************************************************************
  * Callback Setters
  ******************************************************************************/
+void mqtt_handler_set_data_definition(const data_definition_t *def)
+{
+    if (!def || !s_mutex) return;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    // device_id 미설정 또는 필드 없음 → 템플릿 없이 cJSON 경로 사용
+    json_template_compile(&s_data_tpl, s_config.device_id, s_config.user_id, def);
+    xSemaphoreGive(s_mutex);
+
+    // 필드별 토픽 문자열과 라우팅 규칙도 같은 시점에 재계산
+    field_topics_set_definition(def);
+    topic_router_set_definition(def);
+    alarm_set_definition(def);
+    rate_plan_set_definition(def);
+}
+
 uint32_t mqtt_handler_get_tx_count(void)
 {
-    return s_tx_count;
+    return stats_get(s_stat_tx);
 }
 
 void mqtt_handler_set_callback(mqtt_event_cb_t cb)
@@ -748,15 +1131,15 @@ esp_err_t mqtt_handler_upload_config(const protocol_config_data_t *protocol_conf
             cJSON_AddStringToObject(field, "fieldName", field_name);
             
             // Data type string
-            const char *type_str = data_type_str((data_type_t)f->field_type);
+            const char *type_str = data_parser_type_name((data_type_t)f->field_type);
             cJSON_AddStringToObject(field, "fieldType", type_str);
             
             cJSON_AddStringToObject(field, "byteOrder", f->byte_order ? "big" : "little");
             cJSON_AddNumberToObject(field, "startOffset", f->start_offset);
             cJSON_AddNumberToObject(field, "bitOffset", f->bit_offset);
             cJSON_AddNumberToObject(field, "bitLength", f->bit_length);
-            cJSON_AddNumberToObject(field, "scaleFactor", f->scale_factor / 1000.0);
-            cJSON_AddNumberToObject(field, "offsetValue", f->offset_value / 100.0);
+            cJSON_AddNumberToObject(field, "scaleFactor", f->scale);
+            cJSON_AddNumberToObject(field, "offsetValue", f->offset);
             
             cJSON_AddItemToArray(fields_array, field);
         }
@@ -765,7 +1148,7 @@ esp_err_t mqtt_handler_upload_config(const protocol_config_data_t *protocol_conf
     
     // Sync version
     cJSON_AddNumberToObject(root, "syncVersion", 1);
-    cJSON_AddNumberToObject(root, "timestamp", (double)time(NULL));
+    cJSON_AddNumberToObject(root, "timestamp", time_sync_now());
 
     char *json_str = cJSON_PrintUnformatted(root);
     if (json_str) {
@@ -776,7 +1159,7 @@ esp_err_t mqtt_handler_upload_config(const protocol_config_data_t *protocol_conf
                                               strlen(json_str), 1, 0);
         if (msg_id >= 0) {
             ESP_LOGI(TAG, "Config uploaded to server: %s (%d bytes)", topic, strlen(json_str));
-            s_tx_count++;
+            stats_inc(s_stat_tx);
             ret = ESP_OK;
         } else {
             ESP_LOGE(TAG, "Config upload failed");
@@ -14,6 +14,7 @@
 
 #include "esp_err.h"
 #include "protocol_def.h"
+#include "record_bus.h"
 #include "cJSON.h"
 
 #ifdef __cplusplus
@@ -59,22 +60,102 @@ bool mqtt_handler_is_connected(void);
 
 /**
  * @brief Publish parsed data to MQTT (v2.1 enhanced)
- * @param device_id Device identifier
- * @param fields Array of parsed fields
- * @param field_count Number of fields
- * @param raw_data Raw frame data
- * @param raw_len Raw data length
- * @param sequence Sequence number
- * @param crc_valid CRC validation result (v2.1)
+ *
+ * timestamp is the record's capture time mapped to wall clock (ms resolution),
+ * with "time_valid" false until SNTP sync. Only fields set in rec->field_mask
+ * (rate plan) are included.
+ * @param device_id Device identifier (used when MQTT config has none)
+ * @param rec Parsed record
+ * @return ESP_OK on success
+ */
+esp_err_t mqtt_handler_publish_data(const char *device_id, const record_t *rec);
+
+/**
+ * @brief Publish parsed data to an already routed topic
+ *
+ * Same payload as mqtt_handler_publish_data() without evaluating the topic
+ * router again (callers that matched the rules themselves).
+ * @param device_id Device identifier (used when MQTT config has none)
+ * @param rec Parsed record
+ * @param routed_topic Topic from topic_router_match() (NULL = data topic, config QoS)
+ * @param routed_qos QoS from topic_router_match() (ignored when routed_topic is NULL)
+ * @return ESP_OK on success
+ */
+esp_err_t mqtt_handler_publish_data_to(const char *device_id, const record_t *rec,
+                                       const char *routed_topic, uint8_t routed_qos);
+
+/**
+ * @brief Publish parsed data as a gateway child device
+ *
+ * Topic: user/{user_id}/device/{child_id}/data, payload carries gateway_id.
+ * Content routing rules and rate plans are not applied to child devices.
+ * @param child_id Child device identifier
+ * @param rec Parsed record
+ * @param sequence Child device sequence number
+ * @return ESP_OK on success
+ */
+esp_err_t mqtt_handler_publish_child_data(const char *child_id, const record_t *rec,
+                                          uint16_t sequence);
+
+/**
+ * @brief Publish several records as one JSON array on .../data/batch
+ *
+ * Each element is encoded exactly like a data topic message
+ * (precompiled template or cJSON, raw policy applied per record).
+ * @param records Records to publish
+ * @param count Number of records
+ * @return ESP_OK on success
+ */
+esp_err_t mqtt_handler_publish_batch(const record_t *const *records, size_t count);
+
+/**
+ * @brief Smoothed publish round-trip time (publish → broker ACK, QoS>0 batches)
+ * @param mean_us Mean RTT (0 until the first ACK)
+ * @param dev_us Mean deviation
+ */
+void mqtt_handler_get_publish_rtt(uint32_t *mean_us, uint32_t *dev_us);
+
+/**
+ * @brief Build a full device topic
+ * @param out Output buffer
+ * @param out_size Output buffer size
+ * @param suffix Topic suffix (user/{user_id}/device/{device_id}/{suffix})
+ */
+void mqtt_handler_build_topic(char *out, size_t out_size, const char *suffix);
+
+/**
+ * @brief Build a full topic for another device id (gateway child devices)
+ * @param out Output buffer
+ * @param out_size Output buffer size
+ * @param device_id Device id used in place of the configured one
+ * @param suffix Topic suffix (user/{user_id}/device/{device_id}/{suffix})
+ */
+void mqtt_handler_build_device_topic(char *out, size_t out_size, const char *device_id,
+                                     const char *suffix);
+
+/**
+ * @brief Publish a pre-serialized payload to a full topic
+ * @param topic Full topic (e.g. from mqtt_handler_build_topic)
+ * @param payload Payload bytes
+ * @param len Payload length
+ * @param qos QoS level
+ * @param retain Retain flag
+ * @return ESP_OK on success
+ */
+esp_err_t mqtt_handler_publish_topic(const char *topic, const char *payload, size_t len,
+                                     uint8_t qos, bool retain);
+
+/**
+ * @brief Publish a pre-serialized payload under the device topic
+ * @param suffix Topic suffix (user/{user_id}/device/{device_id}/{suffix})
+ * @param payload Payload bytes
+ * @param len Payload length
+ * @param qos QoS level
+ * @param retain Retain flag
  * @return ESP_OK on success
  */
-esp_err_t mqtt_handler_publish_data(const char *device_id,
-                                    const parsed_field_t *fields,
-                                    uint8_t field_count,
-                                    const uint8_t *raw_data,
-                                    size_t raw_len,
-                                    uint16_t sequence,
-                                    bool crc_valid);
+esp_err_t mqtt_handler_publish(const char *suffix, const char *payload, size_t len,
+                               uint8_t qos, bool retain);
 
 /**
  * @brief Publish device status to MQTT (v2.1 enhanced)
@@ -102,6 +183,23 @@ esp_err_t mqtt_handler_send_command_response(const char *request_id,
                                               bool success, 
                                               const char *message);
 
+/**
+ * @brief Recompile the data payload template for a new data definition
+ * @param def Data definition now bound to the parser
+ */
+void mqtt_handler_set_data_definition(const data_definition_t *def);
+
+/**
+ * @brief Set raw frame inclusion policy for data messages
+ * @param config Policy (NULL = include hex on every message)
+ */
+void mqtt_handler_set_raw_config(const raw_config_t *config);
+
+/**
+ * @brief Get current raw frame inclusion policy
+ */
+const raw_config_t* mqtt_handler_get_raw_config(void);
+
 /**
  * @brief Get transmitted message count
  * @return Number of messages sent
@@ -116,6 +214,9 @@ void mqtt_handler_set_callback(mqtt_event_cb_t cb);
 
 /**
  * @brief Set remote command callback (P0-3)
+ *
+ * The callback owns all command responses (receipt, rejection, result);
+ * the MQTT handler does not acknowledge commands itself.
  * @param cb Callback function
  */
 void mqtt_handler_set_cmd_callback(mqtt_cmd_cb_t cb);
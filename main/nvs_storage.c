@@ -10,9 +10,14 @@
  */
 
 #include "nvs_storage.h"
+#include "data_parser.h"
+#include "crc_utils.h"
 #include "nvs_flash.h"
 #include "nvs.h"
+#include "esp_partition.h"
 #include "esp_log.h"
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "NVS";
@@ -23,6 +28,7 @@ static const char *TAG = "NVS";
 #define NVS_NS_UART         "uart"
 #define NVS_NS_PROTOCOL     "protocol"
 #define NVS_NS_DATA         "data"
+#define NVS_NS_FEATURE      "feature"     // 부가 기능 설정 (key별 고정 크기 blob)
 
 esp_err_t nvs_storage_init(void)
 {
@@ -356,34 +362,248 @@ esp_err_t nvs_load_protocol_config(protocol_config_data_t *config)
     return ESP_OK;
 }
 
+/*******************************************************************************
+ * Data Definition Store (defstore partition)
+ *
+ * v2 정의는 최대 ~9KB라 NVS(24KB)에서는 덮어쓰기 시 새/이전 사본이 함께 들어가지 못한다.
+ * 전용 defstore partition(사용자 정의 data subtype - 파일시스템이 mount/format하지
+ * 않음)에 A/B slot을 두고 번갈아 기록한다:
+ *   [def_store_header_t][fields: field_count x field_definition_t][names]
+ * 본문을 먼저 쓰고 헤더를 마지막에 쓰므로, 기록 중 전원이 꺼지면 그 slot은 무효이고
+ * 이전 slot이 그대로 남는다. 유효한 slot 중 seq가 큰 쪽이 최신.
+ ******************************************************************************/
+#define DEF_STORE_LABEL         "defstore"
+#define DEF_STORE_SUBTYPE       0x40            // partitions.csv와 일치 (custom data 0x40~0xFE)
+#define DEF_STORE_MAGIC         0x46454432UL    // "2DEF"
+#define DEF_STORE_SLOT_SIZE     0x4000          // sector(4KB) 배수
+#define DEF_STORE_SLOTS         2
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t field_size;        // sizeof(field_definition_t) - 구조체 변경 감지
+    uint16_t data_offset;
+    uint16_t names_length;
+    uint8_t field_count;
+    uint8_t reserved;
+    uint32_t fields_crc;
+    uint32_t names_crc;
+    uint32_t header_crc;        // 이 필드 앞까지
+} def_store_header_t;
+
+static uint32_t s_def_seq = 0;          // 최신 slot의 seq
+static int s_def_slot = -1;             // 최신 slot (-1 = 없음)
+
+static const esp_partition_t* def_store_partition(void)
+{
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           (esp_partition_subtype_t)DEF_STORE_SUBTYPE,
+                                                           DEF_STORE_LABEL);
+    if (part && part->size < DEF_STORE_SLOT_SIZE * DEF_STORE_SLOTS) return NULL;
+    return part;
+}
+
+static bool def_header_valid(const def_store_header_t *hdr)
+{
+    return hdr->magic == DEF_STORE_MAGIC &&
+           hdr->header_crc == crc_calc_crc32((const uint8_t *)hdr,
+                                             offsetof(def_store_header_t, header_crc)) &&
+           hdr->field_size == sizeof(field_definition_t) &&
+           hdr->names_length <= MAX_FIELD_NAMES_SIZE;
+}
+
+static uint32_t def_fields_crc(const data_definition_t *def)
+{
+    return crc_calc_crc32((const uint8_t *)def->fields,
+                          def->field_count * sizeof(field_definition_t));
+}
+
+static uint32_t def_names_crc(const data_definition_t *def)
+{
+    return crc_calc_crc32((const uint8_t *)def->field_names, def->names_length);
+}
+
+static esp_err_t def_store_save(const data_definition_t *def)
+{
+    const esp_partition_t *part = def_store_partition();
+    if (!part) return ESP_ERR_NOT_FOUND;
+
+    if (s_def_slot < 0) {
+        // 부팅 후 첫 저장 - 현재 최신 slot을 확인해 덮어쓰지 않도록
+        for (int i = 0; i < DEF_STORE_SLOTS; i++) {
+            def_store_header_t hdr;
+            if (esp_partition_read(part, i * DEF_STORE_SLOT_SIZE, &hdr, sizeof(hdr)) == ESP_OK &&
+                def_header_valid(&hdr) && (s_def_slot < 0 || (int32_t)(hdr.seq - s_def_seq) > 0)) {
+                s_def_slot = i;
+                s_def_seq = hdr.seq;
+            }
+        }
+    }
+
+    int slot = (s_def_slot + 1) % DEF_STORE_SLOTS;
+    size_t base = slot * DEF_STORE_SLOT_SIZE;
+    size_t fields_size = def->field_count * sizeof(field_definition_t);
+
+    def_store_header_t hdr = {
+        .magic = DEF_STORE_MAGIC,
+        .seq = s_def_seq + 1,
+        .field_size = sizeof(field_definition_t),
+        .data_offset = def->data_offset,
+        .names_length = def->names_length,
+        .field_count = def->field_count,
+        .fields_crc = def_fields_crc(def),
+        .names_crc = def_names_crc(def),
+    };
+    hdr.header_crc = crc_calc_crc32((const uint8_t *)&hdr, offsetof(def_store_header_t, header_crc));
+
+    esp_err_t ret = esp_partition_erase_range(part, base, DEF_STORE_SLOT_SIZE);
+    if (ret == ESP_OK && fields_size > 0) {
+        ret = esp_partition_write(part, base + sizeof(hdr), def->fields, fields_size);
+    }
+    if (ret == ESP_OK && def->names_length > 0) {
+        ret = esp_partition_write(part, base + sizeof(hdr) + fields_size,
+                                  def->field_names, def->names_length);
+    }
+    if (ret == ESP_OK) {
+        ret = esp_partition_write(part, base, &hdr, sizeof(hdr));
+    }
+    if (ret != ESP_OK) return ret;
+
+    s_def_slot = slot;
+    s_def_seq = hdr.seq;
+    return ESP_OK;
+}
+
+static esp_err_t def_store_load(data_definition_t *def)
+{
+    const esp_partition_t *part = def_store_partition();
+    if (!part) return ESP_ERR_NOT_FOUND;
+
+    // 최신 slot부터 시도, 본문 CRC가 틀리면 다른 slot으로
+    def_store_header_t hdrs[DEF_STORE_SLOTS];
+    bool valid[DEF_STORE_SLOTS];
+    uint32_t max_seq = 0;
+    for (int i = 0; i < DEF_STORE_SLOTS; i++) {
+        valid[i] = esp_partition_read(part, i * DEF_STORE_SLOT_SIZE, &hdrs[i], sizeof(hdrs[i])) == ESP_OK &&
+                   def_header_valid(&hdrs[i]);
+        if (valid[i] && (int32_t)(hdrs[i].seq - max_seq) > 0) max_seq = hdrs[i].seq;
+    }
+
+    for (int attempt = 0; attempt < DEF_STORE_SLOTS; attempt++) {
+        int best = -1;
+        for (int i = 0; i < DEF_STORE_SLOTS; i++) {
+            if (valid[i] && (best < 0 || (int32_t)(hdrs[i].seq - hdrs[best].seq) > 0)) best = i;
+        }
+        if (best < 0) break;
+        valid[best] = false;
+
+        const def_store_header_t *hdr = &hdrs[best];
+        size_t base = best * DEF_STORE_SLOT_SIZE;
+        size_t fields_size = hdr->field_count * sizeof(field_definition_t);
+
+        def->field_count = hdr->field_count;
+        def->data_offset = hdr->data_offset;
+        def->names_length = hdr->names_length;
+        if (esp_partition_read(part, base + sizeof(*hdr), def->fields, fields_size) != ESP_OK ||
+            esp_partition_read(part, base + sizeof(*hdr) + fields_size,
+                               def->field_names, hdr->names_length) != ESP_OK ||
+            def_fields_crc(def) != hdr->fields_crc || def_names_crc(def) != hdr->names_crc) {
+            ESP_LOGW(TAG, "Data definition slot %d corrupt", best);
+            continue;
+        }
+
+        // 다음 저장은 읽은 slot이 아닌 쪽에, 기존 어느 slot보다 큰 seq로
+        s_def_slot = best;
+        s_def_seq = max_seq;
+        return ESP_OK;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+static esp_err_t def_store_erase(void)
+{
+    const esp_partition_t *part = def_store_partition();
+    if (!part) return ESP_OK;
+
+    s_def_slot = -1;
+    s_def_seq = 0;
+    return esp_partition_erase_range(part, 0, DEF_STORE_SLOT_SIZE * DEF_STORE_SLOTS);
+}
+
 /*******************************************************************************
  * Data Definition
  ******************************************************************************/
-esp_err_t nvs_save_data_definition(const data_definition_t *def)
+// 이전 펌웨어가 NVS에 저장한 데이터 정의 키
+static const char *const s_def_nvs_keys[] = {
+    "field_cnt", "data_off", "data_off2", "fields", "fields2", "names", "names_len",
+};
+
+static esp_err_t nvs_erase_optional(nvs_handle_t handle, const char *key)
+{
+    esp_err_t ret = nvs_erase_key(handle, key);
+    return (ret == ESP_ERR_NVS_NOT_FOUND) ? ESP_OK : ret;
+}
+
+// defstore partition이 없을 때의 NVS 저장 (v1 키는 새 키가 모두 기록된 뒤에만 제거)
+static esp_err_t save_definition_nvs(const data_definition_t *def)
 {
     nvs_handle_t handle;
     esp_err_t ret = nvs_open(NVS_NS_DATA, NVS_READWRITE, &handle);
     if (ret != ESP_OK) return ret;
 
-    nvs_set_u8(handle, "field_cnt", def->field_count);
-    nvs_set_u8(handle, "data_off", def->data_offset);
-
-    if (def->field_count > 0) {
-        size_t fields_size = def->field_count * sizeof(field_definition_t);
-        nvs_set_blob(handle, "fields", def->fields, fields_size);
+    ret = nvs_set_u8(handle, "field_cnt", def->field_count);
+    if (ret == ESP_OK) {
+        ret = nvs_set_u16(handle, "data_off2", def->data_offset);
+    }
+    if (ret == ESP_OK && def->field_count > 0) {
+        ret = nvs_set_blob(handle, "fields2", def->fields,
+                           def->field_count * sizeof(field_definition_t));
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_set_u16(handle, "names_len", def->names_length);
+    }
+    if (ret == ESP_OK && def->names_length > 0) {
+        ret = nvs_set_blob(handle, "names", def->field_names, def->names_length);
+    }
+    // v1 형식 키 제거 (load 시 변환 대상이 남지 않게)
+    if (ret == ESP_OK) {
+        ret = nvs_erase_optional(handle, "fields");
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_erase_optional(handle, "data_off");
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
     }
 
-    if (def->names_length > 0) {
-        nvs_set_blob(handle, "names", def->field_names, def->names_length);
-        nvs_set_u16(handle, "names_len", def->names_length);
+    nvs_close(handle);
+    return ret;
+}
+
+esp_err_t nvs_save_data_definition(const data_definition_t *def)
+{
+    if (!def) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t ret = def_store_save(def);
+    if (ret == ESP_ERR_NOT_FOUND) {
+        ret = save_definition_nvs(def);
+    } else if (ret == ESP_OK) {
+        // partition 저장 성공 후에만 NVS의 이전 정의 제거 (공간 반환)
+        nvs_handle_t handle;
+        if (nvs_open(NVS_NS_DATA, NVS_READWRITE, &handle) == ESP_OK) {
+            for (size_t i = 0; i < sizeof(s_def_nvs_keys) / sizeof(s_def_nvs_keys[0]); i++) {
+                nvs_erase_optional(handle, s_def_nvs_keys[i]);
+            }
+            nvs_commit(handle);
+            nvs_close(handle);
+        }
     }
 
-    ret = nvs_commit(handle);
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "Data definition saved: %d fields", def->field_count);
+    } else {
+        ESP_LOGE(TAG, "Data definition save failed: %s", esp_err_to_name(ret));
     }
-
-    nvs_close(handle);
     return ret;
 }
 
@@ -391,6 +611,13 @@ esp_err_t nvs_load_data_definition(data_definition_t *def)
 {
     memset(def, 0, sizeof(data_definition_t));
 
+    if (def_store_load(def) == ESP_OK) {
+        ESP_LOGI(TAG, "Data definition loaded: %d fields", def->field_count);
+        return ESP_OK;
+    }
+    memset(def, 0, sizeof(data_definition_t));
+
+    // 이전 펌웨어가 NVS에 저장한 정의 (다음 저장 시 partition으로 이동)
     nvs_handle_t handle;
     esp_err_t ret = nvs_open(NVS_NS_DATA, NVS_READONLY, &handle);
     if (ret != ESP_OK) {
@@ -399,11 +626,28 @@ esp_err_t nvs_load_data_definition(data_definition_t *def)
     }
 
     nvs_get_u8(handle, "field_cnt", &def->field_count);
-    nvs_get_u8(handle, "data_off", &def->data_offset);
+    if (nvs_get_u16(handle, "data_off2", &def->data_offset) != ESP_OK) {
+        uint8_t data_off = 0;
+        nvs_get_u8(handle, "data_off", &data_off);
+        def->data_offset = data_off;
+    }
 
-    if (def->field_count > 0 && def->field_count <= MAX_FIELD_COUNT) {
+    if (def->field_count > 0) {
         size_t len = def->field_count * sizeof(field_definition_t);
-        nvs_get_blob(handle, "fields", def->fields, &len);
+        if (nvs_get_blob(handle, "fields2", def->fields, &len) != ESP_OK) {
+            // 이전 펌웨어가 저장한 v1 필드 정의 → 변환 (다음 저장 시 v2 키로 교체)
+            len = def->field_count * sizeof(field_definition_v1_t);
+            field_definition_v1_t *v1 = malloc(len);
+            if (v1 && nvs_get_blob(handle, "fields", v1, &len) == ESP_OK) {
+                for (uint8_t i = 0; i < def->field_count; i++) {
+                    data_parser_field_from_v1(&v1[i], &def->fields[i]);
+                }
+                ESP_LOGI(TAG, "Data definition migrated from v1 format");
+            } else {
+                def->field_count = 0;
+            }
+            free(v1);
+        }
     }
 
     nvs_get_u16(handle, "names_len", &def->names_length);
@@ -417,6 +661,105 @@ esp_err_t nvs_load_data_definition(data_definition_t *def)
     return ESP_OK;
 }
 
+/*******************************************************************************
+ * Feature Config (generic fixed-size blob)
+ ******************************************************************************/
+esp_err_t nvs_save_feature_config(const char *key, const void *config, size_t size)
+{
+    if (!key || !config || size == 0) return ESP_ERR_INVALID_ARG;
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NS_FEATURE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) return ret;
+
+    ret = nvs_set_blob(handle, key, config, size);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Feature config saved: %s (%d bytes)", key, (int)size);
+    }
+
+    nvs_close(handle);
+    return ret;
+}
+
+esp_err_t nvs_load_feature_config(const char *key, void *config, size_t size)
+{
+    if (!key || !config || size == 0) return ESP_ERR_INVALID_ARG;
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NS_FEATURE, NVS_READONLY, &handle);
+    if (ret != ESP_OK) return ret;
+
+    size_t len = 0;
+    ret = nvs_get_blob(handle, key, NULL, &len);
+    if (ret == ESP_OK && len != size) {
+        // 구조체 크기가 바뀐 이전 펌웨어의 blob은 무시 (기본값 사용)
+        ESP_LOGW(TAG, "Feature config %s size mismatch (%d != %d)", key, (int)len, (int)size);
+        ret = ESP_ERR_INVALID_SIZE;
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_get_blob(handle, key, config, &len);
+    }
+
+    nvs_close(handle);
+    return ret;
+}
+
+/*******************************************************************************
+ * Provisioning Journal (CMD_PROVISION bundle)
+ ******************************************************************************/
+#define PROVISION_JOURNAL_KEY   "provision"
+
+esp_err_t nvs_save_provision_journal(const uint8_t *data, size_t len)
+{
+    if (!data || len == 0) return ESP_ERR_INVALID_ARG;
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NS_FEATURE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) return ret;
+
+    ret = nvs_set_blob(handle, PROVISION_JOURNAL_KEY, data, len);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+
+    nvs_close(handle);
+    return ret;
+}
+
+esp_err_t nvs_load_provision_journal(uint8_t *buf, size_t *len)
+{
+    if (!buf || !len) return ESP_ERR_INVALID_ARG;
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NS_FEATURE, NVS_READONLY, &handle);
+    if (ret != ESP_OK) return ret;
+
+    ret = nvs_get_blob(handle, PROVISION_JOURNAL_KEY, buf, len);
+
+    nvs_close(handle);
+    return ret;
+}
+
+esp_err_t nvs_clear_provision_journal(void)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NS_FEATURE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) return ret;
+
+    ret = nvs_erase_key(handle, PROVISION_JOURNAL_KEY);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    } else if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        ret = ESP_OK;
+    }
+
+    nvs_close(handle);
+    return ret;
+}
+
 /*******************************************************************************
  * Factory Reset
  ******************************************************************************/
@@ -429,6 +772,11 @@ esp_err_t nvs_reset_to_defaults(void)
         return ret;
     }
 
+    // 데이터 정의는 defstore partition에 있으므로 함께 지움
+    if (def_store_erase() != ESP_OK) {
+        ESP_LOGW(TAG, "Data definition store erase failed");
+    }
+
     ret = nvs_flash_init();
     ESP_LOGI(TAG, "Factory reset complete");
     return ret;
@@ -68,11 +68,46 @@ esp_err_t nvs_save_data_definition(const data_definition_t *def);
  */
 esp_err_t nvs_load_data_definition(data_definition_t *def);
 
+/**
+ * @brief 부가 기능 설정 저장 (고정 크기 blob)
+ * @param key NVS key (15자 이하)
+ * @param config 설정 구조체
+ * @param size 구조체 크기
+ */
+esp_err_t nvs_save_feature_config(const char *key, const void *config, size_t size);
+
+/**
+ * @brief 부가 기능 설정 로드
+ * @return ESP_OK, 또는 저장된 값이 없거나 크기가 다르면 에러 (호출자는 기본값 사용)
+ */
+esp_err_t nvs_load_feature_config(const char *key, void *config, size_t size);
+
 /**
  * @brief 공장 초기화
  */
 esp_err_t nvs_reset_to_defaults(void);
 
+/**
+ * @brief 일괄 설정 bundle 원본 저장 (단일 blob, 한 번의 commit)
+ *
+ * 개별 설정 저장 전에 기록하고 모두 저장한 뒤 지운다. 중간에 전원이 꺼지면
+ * 부팅 시 이 bundle로 다시 저장해 설정이 섞이지 않게 한다.
+ */
+esp_err_t nvs_save_provision_journal(const uint8_t *data, size_t len);
+
+/**
+ * @brief 미완료 bundle 읽기
+ * @param buf 출력 버퍼
+ * @param len 입력: 버퍼 크기, 출력: bundle 크기
+ * @return ESP_OK, ESP_ERR_NVS_NOT_FOUND (미완료 bundle 없음)
+ */
+esp_err_t nvs_load_provision_journal(uint8_t *buf, size_t *len);
+
+/**
+ * @brief bundle 기록 제거 (모든 설정 저장 완료)
+ */
+esp_err_t nvs_clear_provision_journal(void);
+
 /**
  * @brief 설정 완료 여부 확인
  */
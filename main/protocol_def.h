@@ -50,6 +50,19 @@ extern "C" {
 #define PACKET_HEADER_SIZE      4       // STX + CMD + LEN(2)
 #define PACKET_FOOTER_SIZE      2       // CRC + ETX (minimum)
 
+// Protocol v2: [STX_V2] [SEQ] [CMD] [LEN(2)] [payload] [CRC] [ETX]
+// CRC = XOR(SEQ..payload). ACK/응답/에러가 같은 형식으로 요청 SEQ를 되돌려준다.
+#define PACKET_STX_V2           0x12
+#define PACKET_V2_HEADER_SIZE   5       // STX_V2 + SEQ + CMD + LEN(2)
+#define BLE_SEQ_NONE            0xFFFF  // v1 요청 (SEQ 없음)
+#define BLE_CMD_WINDOW          4       // 응답 전 동시 처리 가능한 v2 명령 수
+
+// CMD_PROVISION bundle: [version(1)] [count(1)] {[section(1)] [len(2)] [data]} x count [crc32(4)]
+#define PROVISION_BUNDLE_VERSION    1
+#define PROVISION_HEADER_SIZE       2
+#define PROVISION_SECTION_HDR_SIZE  3
+#define PROVISION_CRC_SIZE          4
+
 /*******************************************************************************
  * Command Codes (Section 3.2)
  ******************************************************************************/
@@ -65,6 +78,8 @@ typedef enum {
     CMD_START_MONITOR   = 0x09,
     CMD_STOP_MONITOR    = 0x0A,
     CMD_REQUEST_SYNC    = 0x0B,     // v2.1: 설정 동기화 요청
+    CMD_PROVISION       = 0x0C,     // 일괄 설정 bundle (WiFi/MQTT/UART/Protocol/Data Def)
+    CMD_SET_DATA_DEF_V2 = 0x0D,     // v2 데이터 정의 (chunk 전송, 16-bit offset, float scale)
     
     // OTA Commands
     CMD_OTA_CHECK       = 0x10,
@@ -79,6 +94,7 @@ typedef enum {
     RSP_OTA_PROGRESS    = 0x83,
     RSP_OTA_VERSION     = 0x84,
     RSP_CONFIG_SYNC     = 0x85,     // v2.1: 설정 동기화 응답
+    RSP_MONITOR         = 0x86,     // 시리얼 모니터 stream chunk
     RSP_ERROR           = 0xFF
 } cmd_code_t;
 
@@ -92,6 +108,7 @@ typedef enum {
     MQTT_CMD_START_MONITOR      = 0x04,     // 모니터링 시작
     MQTT_CMD_STOP_MONITOR       = 0x05,     // 모니터링 중지
     MQTT_CMD_FACTORY_RESET      = 0x06,     // 공장 초기화
+    MQTT_CMD_QUERY_HISTORY      = 0x07,     // 이력 조회 ({base}/history chunk 응답)
 } mqtt_cmd_type_t;
 
 /*******************************************************************************
@@ -187,7 +204,9 @@ typedef enum {
 typedef enum {
     RESULT_SUCCESS  = 0x00,
     RESULT_FAILED   = 0x01,
-    RESULT_INVALID  = 0x02
+    RESULT_INVALID  = 0x02,
+    RESULT_BUSY     = 0x03,     // v2: window 초과 또는 처리 중인 SEQ 재사용
+    RESULT_SUPERSEDED = 0x04    // 적용 전 같은 종류의 최신 설정 명령으로 대체됨 (미적용)
 } result_code_t;
 
 /*******************************************************************************
@@ -237,9 +256,15 @@ typedef struct {
     uint8_t data_bits;      // 7 or 8
     uint8_t parity;         // 0=None, 1=Odd, 2=Even
     uint8_t stop_bits;      // 1 or 2
-    uint8_t flow_control;   // 0=None, 1=RTS/CTS, 2=XON/XOFF
+    uint8_t flow_control;   // uart_flow_control_t
 } uart_config_data_t;
 
+typedef enum {
+    UART_FLOW_NONE          = 0x00,
+    UART_FLOW_RTS_CTS       = 0x01,
+    UART_FLOW_XON_XOFF      = 0x02,     // 텍스트 프로토콜 전용 (0x11/0x13 바이트 예약)
+} uart_flow_control_t;
+
 // Custom Protocol Configuration (Section 5.2)
 typedef struct {
     uint16_t frame_length;
@@ -301,11 +326,15 @@ typedef struct {
 /*******************************************************************************
  * Data Field Definition (Section 6)
  ******************************************************************************/
-#define MAX_FIELD_COUNT         64
+#define MAX_FIELD_COUNT         255     // record/필드 경로의 field_count가 uint8_t
 #define MAX_FIELD_NAME_LEN      32
-#define MAX_FIELD_NAMES_SIZE    1024
+#define MAX_FIELD_NAMES_SIZE    4096
 
-// Field Definition (12 bytes) - Section 6.2
+// 필드 선택 비트맵 (rate plan, 필드 토픽, 이력 조회) - bit i = 필드 i, 앞 64개 필드만 선택 대상
+#define FIELD_MASK_BITS         64
+#define FIELD_MASK_BIT(i)       ((i) < FIELD_MASK_BITS ? (1ULL << (i)) : 0)
+
+// v1 Field Definition 전송 형식 (12 bytes) - Section 6.2
 typedef struct __attribute__((packed)) {
     uint8_t field_type;
     uint8_t byte_order;     // 0=Little, 1=Big Endian
@@ -316,11 +345,40 @@ typedef struct __attribute__((packed)) {
     int16_t offset_value;   // Offset * 100
     uint8_t name_length;
     uint16_t name_index;
+} field_definition_v1_t;
+
+// v2 데이터 정의 (CMD_SET_DATA_DEF_V2, chunk 재조립 후):
+// [version=2] [field_count(2)] [data_offset(2)] [names_len(2)]
+// {[type] [flags] [start_offset(2)] [bit_offset] [bit_length] [scale(f32)]? [offset(f32)]?} x field_count
+// [names: field 순서대로 NUL 구분] [crc32(4)]   (multi-byte는 LE, crc32는 version부터)
+// chunk payload: [chunk_offset(2)] [total_len(2)] [bytes] - chunk_offset 0이 새 전송 시작
+#define DATA_DEF_V2_VERSION         2
+#define DATA_DEF_V2_HEADER_SIZE     7
+#define DATA_DEF_V2_FIELD_SIZE      6       // scale/offset 제외
+#define DATA_DEF_V2_CHUNK_HDR_SIZE  4
+#define DATA_DEF_V2_MAX_SIZE        (DATA_DEF_V2_HEADER_SIZE + MAX_FIELD_COUNT * (DATA_DEF_V2_FIELD_SIZE + 8) + \
+                                     MAX_FIELD_NAMES_SIZE + 4)
+#define DATA_DEF_FLAG_BIG_ENDIAN    0x01
+#define DATA_DEF_FLAG_SCALE         0x02    // scale(f32) 포함 (없으면 1.0)
+#define DATA_DEF_FLAG_OFFSET        0x04    // offset(f32) 포함 (없으면 0)
+
+// Field Definition (메모리 표현, v1/v2 공통)
+typedef struct {
+    uint8_t field_type;
+    uint8_t byte_order;     // 0=Little, 1=Big Endian
+    uint16_t start_offset;  // data_offset 기준
+    uint8_t bit_offset;
+    uint8_t bit_length;
+    uint8_t name_length;
+    uint16_t name_index;    // field_names 내 위치
+    float scale;            // 물리값 = raw * scale + offset
+    float offset;
 } field_definition_t;
 
+// 크기가 커서 PSRAM에 둔다 (data_parser_alloc_definition)
 typedef struct {
     uint8_t field_count;
-    uint8_t data_offset;
+    uint16_t data_offset;
     field_definition_t fields[MAX_FIELD_COUNT];
     char field_names[MAX_FIELD_NAMES_SIZE];
     uint16_t names_length;
@@ -420,6 +478,201 @@ typedef struct {
     bool crc_valid;             // v2.1: CRC 검증 결과
 } parsed_field_t;
 
+/*******************************************************************************
+ * Backfill Configuration (재연결 시 저장 데이터 업로드)
+ ******************************************************************************/
+typedef enum {
+    BACKFILL_MODE_OFF       = 0x00,     // 업로드 안 함
+    BACKFILL_MODE_SUMMARY   = 0x01,     // min/max 버킷 요약만 업로드
+    BACKFILL_MODE_FULL      = 0x02,     // 요약 후 전체 해상도 (속도 제한)
+} backfill_mode_t;
+
+typedef struct {
+    uint8_t mode;               // backfill_mode_t
+    uint8_t reserved;
+    uint16_t buckets;           // 필드당 요약 버킷 수
+    uint16_t rate;              // backfill 메시지 전송 속도 (msg/s)
+} backfill_config_t;
+
+/*******************************************************************************
+ * Raw Frame Inclusion Policy (data 토픽의 원시 프레임 포함 규칙)
+ ******************************************************************************/
+typedef enum {
+    RAW_INCLUDE_ALWAYS      = 0x00,     // 모든 메시지 (기존 동작)
+    RAW_INCLUDE_NEVER       = 0x01,     // 포함 안 함
+    RAW_INCLUDE_ON_ERROR    = 0x02,     // CRC 실패/파싱 실패 프레임만
+    RAW_INCLUDE_SAMPLED     = 0x03,     // N개 중 1개
+} raw_include_t;
+
+typedef enum {
+    RAW_ENCODING_HEX        = 0x00,     // "raw_hex"
+    RAW_ENCODING_BASE64     = 0x01,     // "raw_b64"
+} raw_encoding_t;
+
+typedef struct {
+    uint8_t include;            // raw_include_t
+    uint8_t encoding;           // raw_encoding_t
+    uint16_t sample_every;      // RAW_INCLUDE_SAMPLED 주기 (N)
+} raw_config_t;
+
+/*******************************************************************************
+ * Per-field Topic Configuration (필드별 토픽 발행: {base}/fields/{name})
+ ******************************************************************************/
+typedef struct {
+    uint8_t enable;
+    uint8_t qos;
+    uint8_t retain;
+    uint8_t reserved;
+    uint64_t field_mask;        // 발행 대상 필드 비트맵 (bit i = 필드 i, 0 = 전체)
+} field_topic_config_t;
+
+/*******************************************************************************
+ * Topic Routing Rules (레코드 내용 기반 data 토픽 분기)
+ ******************************************************************************/
+#define ROUTE_MAX_RULES         8
+#define ROUTE_SUFFIX_MAX_LEN    32          // "{v}" 포함 시 매칭 값(정수)으로 치환
+
+typedef enum {
+    ROUTE_SOURCE_FIELD      = 0x00,     // 파싱된 필드 값 (scaled)
+    ROUTE_SOURCE_RAW_BYTE   = 0x01,     // 원시 프레임 바이트 (예: Modbus slave 주소)
+} route_source_t;
+
+typedef enum {
+    ROUTE_OP_ANY            = 0x00,     // 항상 매칭 ({v} 토픽 분기용)
+    ROUTE_OP_EQ             = 0x01,
+    ROUTE_OP_NE             = 0x02,
+    ROUTE_OP_GT             = 0x03,
+    ROUTE_OP_GE             = 0x04,
+    ROUTE_OP_LT             = 0x05,
+    ROUTE_OP_LE             = 0x06,
+} route_op_t;
+
+typedef struct {
+    uint8_t source;             // route_source_t
+    uint8_t op;                 // route_op_t
+    uint8_t qos;
+    uint8_t reserved;
+    uint16_t index;             // 필드 인덱스 또는 raw 바이트 오프셋
+    uint16_t reserved2;
+    double value;               // 비교 기준값
+    char suffix[ROUTE_SUFFIX_MAX_LEN];
+} route_rule_t;
+
+typedef struct {
+    uint8_t rule_count;         // 0 = 모든 레코드 data 토픽 (기존 동작)
+    uint8_t reserved[7];
+    route_rule_t rules[ROUTE_MAX_RULES];    // 순서대로 평가, 첫 매칭 적용
+} route_config_t;
+
+/*******************************************************************************
+ * Gateway Mode (멀티드롭 라인의 슬레이브 주소별 가상 자식 장치)
+ ******************************************************************************/
+#define GATEWAY_MAX_CHILDREN    32
+
+typedef struct {
+    uint8_t enable;
+    uint8_t addr_width;         // 주소 바이트 수 (1 또는 2)
+    uint16_t addr_offset;       // 원시 프레임 내 슬레이브/링크 주소 오프셋
+    uint16_t timeout_s;         // 이 시간 동안 수신 없으면 death 발행
+    uint8_t addr_big_endian;    // addr_width=2 일 때 바이트 순서
+    uint8_t reserved;
+} gateway_config_t;
+
+/*******************************************************************************
+ * Adaptive Batching (data/batch 토픽, 지연 목표 기반 배치 크기 조절)
+ ******************************************************************************/
+#define BATCH_MAX_RECORDS       32          // 배치당 최대 record 수
+
+typedef struct {
+    uint8_t enable;
+    uint8_t max_records;        // 1 ~ BATCH_MAX_RECORDS
+    uint16_t latency_ms;        // p99 end-to-end 지연 목표 (수신 → 브로커 ACK)
+} batch_config_t;
+
+/*******************************************************************************
+ * Threshold Alarms (필드별 상/하한, 히스테리시스, 변화율 → {base}/alarm 즉시 발행)
+ ******************************************************************************/
+#define ALARM_MAX_RULES         8
+#define ALARM_QUEUE_SIZE        16
+
+#define ALARM_CHECK_HIGH        0x01
+#define ALARM_CHECK_LOW         0x02
+#define ALARM_CHECK_ROC         0x04
+
+typedef struct {
+    uint8_t field;              // 필드 인덱스
+    uint8_t checks;             // ALARM_CHECK_* 조합
+    uint8_t severity;           // 메시지에 그대로 포함 (0~255)
+    uint8_t reserved;
+    float high;                 // 값 > high → 발생, < high - hysteresis → 해제
+    float low;                  // 값 < low → 발생, > low + hysteresis → 해제
+    float hysteresis;
+    float roc;                  // |초당 변화량| > roc → 발생, <= roc → 해제
+} alarm_rule_t;
+
+typedef struct {
+    uint8_t rule_count;
+    uint8_t qos;
+    uint8_t reserved[2];
+    alarm_rule_t rules[ALARM_MAX_RULES];
+} alarm_config_t;
+
+/*******************************************************************************
+ * Time Sync (SNTP, 단조 시계 → wall clock 매핑)
+ ******************************************************************************/
+#define TIME_SERVER_MAX_LEN     64
+
+typedef struct {
+    char server[TIME_SERVER_MAX_LEN];   // NTP 서버 (빈 문자열 = DEFAULT_TIME_SERVER)
+    uint16_t resync_s;                  // 재동기화 주기
+    uint16_t reserved;
+} time_config_t;
+
+/*******************************************************************************
+ * Per-field Publish Rate Plan (필드별 발행 주기, 최신값 snapshot)
+ ******************************************************************************/
+#define FIELD_MASK_ALL          UINT64_MAX  // bit i = 필드 i (FIELD_MASK_BITS 이후 필드는 항상 발행)
+
+typedef struct {
+    uint8_t enable;
+    uint8_t qos;                // snapshot 발행 QoS
+    uint16_t snapshot_s;        // {base}/data/snapshot 발행 주기 (0 = 안 함)
+    uint16_t divider[FIELD_MASK_BITS];      // N개 record마다 1회 (0/1 = 매 record)
+    uint32_t interval_ms[FIELD_MASK_BITS];  // 최소 발행 간격 (0이 아니면 divider 대신 적용)
+} rate_plan_config_t;
+
+/*******************************************************************************
+ * Flight Recorder (PSRAM 원시 수신 ring, 오류 급증 시 diag/flight 덤프)
+ ******************************************************************************/
+#define FLIGHT_RING_SIZE        (64 * 1024)
+#define FLIGHT_TRIGGER_WINDOW_S 10          // 트리거 카운트 구간
+#define FLIGHT_BLOCK_SIZE       8192        // 덤프 메시지당 원본 바이트
+
+typedef struct {
+    uint8_t enable;
+    uint8_t window_s;           // 덤프에 포함할 최근 구간 (초)
+    uint16_t crc_threshold;     // 트리거 구간 내 CRC 오류 수 (0 = 사용 안 함)
+    uint16_t parse_threshold;   // 트리거 구간 내 파싱 실패 수 (0 = 사용 안 함)
+    uint16_t cooldown_s;        // 덤프 간 최소 간격
+} flight_config_t;
+
+/*******************************************************************************
+ * Frame Dedupe Configuration (동일 프레임 반복 억제)
+ ******************************************************************************/
+#define DEDUPE_MAX_EXCLUDE      4           // 해시 제외 구간 최대 수
+
+typedef struct {
+    uint16_t offset;            // 프레임 내 시작 오프셋
+    uint16_t length;            // 제외 바이트 수 (카운터, CRC 등 매번 바뀌는 값)
+} dedupe_range_t;
+
+typedef struct {
+    uint8_t enable;
+    uint8_t exclude_count;
+    uint16_t holdoff_ms;        // 동일 프레임 억제 시간 (경과 후 1회 통과 = heartbeat)
+    dedupe_range_t exclude[DEDUPE_MAX_EXCLUDE];
+} dedupe_config_t;
+
 /*******************************************************************************
  * System Configuration
  ******************************************************************************/
@@ -442,29 +695,106 @@ typedef struct {
 #define UART_PORT_NUM           1
 #define UART_TX_PIN             17
 #define UART_RX_PIN             18
-#define UART_RTS_PIN            (-1)
-#define UART_CTS_PIN            (-1)
+#define UART_RTS_PIN            16          // flow_control=RTS/CTS 일 때만 사용
+#define UART_CTS_PIN            15
 #define UART_BUF_SIZE           1024
 
+// UART flow control (RX FIFO 128B 기준 하드웨어 임계값)
+#define UART_RTS_FIFO_THRESH    100         // FIFO가 이만큼 차면 RTS 해제
+#define UART_XOFF_FIFO_THRESH   100         // FIFO가 이만큼 차면 XOFF 전송
+#define UART_XON_FIFO_THRESH    32          // 이하로 비면 XON 전송
+
 // Frame buffer
 #define FRAME_BUF_SIZE          512
 
+// Sample store (PSRAM, 재연결 backfill / 이력 조회용)
+#define SAMPLE_STORE_BYTES      (2 * 1024 * 1024)   // 행 수 = BYTES / (10 + 필드 수 x 4)
+
+// Periodic status
+#define STATUS_INTERVAL_MS      1000
+
+// Time sync
+#define DEFAULT_TIME_SERVER     "pool.ntp.org"
+#define DEFAULT_TIME_RESYNC_S   3600
+#define TIME_RESYNC_MIN_S       60          // SNTP 최소 주기 (15초 이상)
+#define TIME_VALID_EPOCH        1577836800  // 2020-01-01 - 이후면 RTC 유지 시각으로 간주
+#define TIME_DRIFT_MAX_PPM      500         // 보정 추정 상한
+
+// History query (query_history 명령 → {base}/history chunk)
+#define HISTORY_CHUNK_VALUES    1024        // chunk당 값 수 (행 수 = VALUES / 필드 수)
+#define HISTORY_CHUNK_DELAY_MS  50          // chunk 간 간격
+
+// Default backfill settings
+#define DEFAULT_BACKFILL_MODE       BACKFILL_MODE_SUMMARY
+#define DEFAULT_BACKFILL_BUCKETS    60
+#define DEFAULT_BACKFILL_RATE       5       // msg/s
+
+// Default raw frame policy
+#define DEFAULT_RAW_SAMPLE_EVERY    100
+
+// Default frame dedupe settings
+#define DEFAULT_DEDUPE_HOLDOFF_MS   10000   // 변화 없어도 10초마다 1회 발행
+#define DEFAULT_GATEWAY_TIMEOUT_S   60      // 자식 장치 death 판정
+#define DEFAULT_BATCH_LATENCY_MS    1000    // p99 지연 목표
+#define GATEWAY_STATUS_INTERVAL_S   60      // 자식 장치 status 주기
+
+// Default flight recorder settings
+#define DEFAULT_FLIGHT_WINDOW_S     30
+#define DEFAULT_FLIGHT_CRC_THRESH   5
+#define DEFAULT_FLIGHT_PARSE_THRESH 5
+#define DEFAULT_FLIGHT_COOLDOWN_S   300
+
+// Serial monitor stream
+#define MONITOR_DEFAULT_DURATION_S  60      // 지정 없을 때 자동 종료
+#define MONITOR_MAX_DURATION_S      600
+#define MONITOR_RING_SIZE           8192    // UART 태스크 → 전송 태스크 버퍼
+#define MONITOR_CHUNK_MAX           1024    // MQTT chunk 최대 크기
+#define MONITOR_FLUSH_MS            100     // 미완성 chunk 전송 주기
+#define MONITOR_RATE_BLE            2000    // bytes/s
+#define MONITOR_RATE_MQTT           8000    // bytes/s
+
 // Task priorities
 #define TASK_PRIORITY_BLE       5
 #define TASK_PRIORITY_UART      6
 #define TASK_PRIORITY_MQTT      4
 #define TASK_PRIORITY_PARSER    5
+#define TASK_PRIORITY_BACKFILL  2
+#define TASK_PRIORITY_HISTORY   2
+#define TASK_PRIORITY_SINK      4
+#define TASK_PRIORITY_CMD       3
+#define TASK_PRIORITY_STATUS    3
+#define TASK_PRIORITY_MONITOR   2
+#define TASK_PRIORITY_FLIGHT    2
+#define TASK_PRIORITY_ALARM     5       // sink / MQTT 보다 높게
+
+// Parser workers (코어별 1개씩 고정)
+#define PARSER_WORKER_COUNT     2
 
 // Task stack sizes
 #define TASK_STACK_BLE          4096
 #define TASK_STACK_UART         4096
 #define TASK_STACK_MQTT         8192
 #define TASK_STACK_PARSER       8192
+#define TASK_STACK_BACKFILL     6144
+#define TASK_STACK_HISTORY      8192    // 필드별 집계 버퍼 (MAX_FIELD_COUNT)
+#define TASK_STACK_SINK         6144
+#define TASK_STACK_CMD          8192    // OTA 버전 확인 (HTTPS) 포함
+#define TASK_STACK_MONITOR      4096
+#define TASK_STACK_FLIGHT       4096
+#define TASK_STACK_ALARM        4096
+#define TASK_STACK_STATUS       4096    // status 발행 (cJSON, stats), rate plan snapshot
 
 // Queue sizes
 #define UART_RX_QUEUE_SIZE      10
+#define FLOW_OFF_HIGH_WATER     8       // 프레임 큐 점유가 이 이상이면 flow-off (flow control 사용 시)
+#define FLOW_ON_LOW_WATER       3       // 이 이하로 비면 flow-on
 #define PARSED_DATA_QUEUE_SIZE  20
-#define BLE_CMD_QUEUE_SIZE      10
+#define BLE_CMD_QUEUE_SIZE      10      // BLE + MQTT 명령 공용 executor 큐
+
+// Record bus sink queue sizes (record 포인터 단위)
+#define SINK_QUEUE_MQTT         16
+#define SINK_QUEUE_BLE          4
+#define SINK_QUEUE_STORE        32
 
 /*******************************************************************************
  * Helper Macros
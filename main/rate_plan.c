@@ -0,0 +1,245 @@
+/**
+ * @file rate_plan.c
+ * @brief Per-field Publish Rate Plans Implementation
+ *
+ * rate_plan_apply()는 재정렬 mutex 안에서 한 번에 하나씩 실행되므로 주기 카운터는 잠금 없이 갱신한다.
+ * 최신값 테이블은 status 태스크의 snapshot과 공유하므로 항목 단위로 portMUX 안에서 복사한다.
+ * 필드별 주기는 앞 FIELD_MASK_BITS개 필드에만 적용되고, 그 뒤 필드는 매 record 발행된다.
+ */
+
+#include "rate_plan.h"
+#include "mqtt_handler.h"
+#include "stats.h"
+#include "time_sync.h"
+#include "cJSON.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "RatePlan";
+
+typedef struct {
+    bool valid;
+    double value;
+    int64_t updated_us;
+    char name[MAX_FIELD_NAME_LEN];
+} latest_t;
+
+typedef struct {
+    bool sent;
+    uint16_t count;             // divider 카운터
+    int64_t sent_us;            // 마지막 발행 record 수신 시각
+} due_state_t;
+
+static rate_plan_config_t s_config = { .enable = 0, .qos = 0, .snapshot_s = 0 };
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool s_config_changed = false;
+
+// 재정렬 단계 전용
+static rate_plan_config_t s_active_cfg = { .enable = 0 };
+static due_state_t s_due[FIELD_MASK_BITS];
+
+// 최신값 테이블 (s_lock 보호, 모든 필드 - PSRAM)
+static latest_t *s_latest = NULL;       // [MAX_FIELD_COUNT]
+static volatile bool s_reset_latest = false;
+
+static int64_t s_last_snapshot_us = 0;
+static stats_id_t s_stat_skipped = STATS_INVALID_ID;
+
+/*******************************************************************************
+ * Latest-value Table
+ ******************************************************************************/
+static void update_latest(const record_t *rec)
+{
+    if (!s_latest) return;
+
+    if (s_reset_latest) {
+        portENTER_CRITICAL(&s_lock);
+        memset(s_latest, 0, sizeof(latest_t) * MAX_FIELD_COUNT);
+        s_reset_latest = false;
+        portEXIT_CRITICAL(&s_lock);
+    }
+
+    for (uint8_t i = 0; i < rec->field_count && i < MAX_FIELD_COUNT; i++) {
+        latest_t *e = &s_latest[i];
+        portENTER_CRITICAL(&s_lock);
+        if (!e->valid) {
+            strncpy(e->name, rec->fields[i].name, sizeof(e->name) - 1);
+            e->valid = true;
+        }
+        e->value = rec->fields[i].scaled_value;
+        e->updated_us = rec->capture_us;
+        portEXIT_CRITICAL(&s_lock);
+    }
+}
+
+bool rate_plan_get_latest(uint8_t index, double *out, uint32_t *age_ms)
+{
+    if (!s_latest || index >= MAX_FIELD_COUNT) return false;
+
+    portENTER_CRITICAL(&s_lock);
+    bool valid = s_latest[index].valid;
+    double value = s_latest[index].value;
+    int64_t updated_us = s_latest[index].updated_us;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (!valid) return false;
+    if (out) *out = value;
+    if (age_ms) *age_ms = (uint32_t)((esp_timer_get_time() - updated_us) / 1000);
+    return true;
+}
+
+/*******************************************************************************
+ * Due Evaluation
+ ******************************************************************************/
+void rate_plan_apply(record_t *rec)
+{
+    if (s_config_changed) {
+        portENTER_CRITICAL(&s_lock);
+        memcpy(&s_active_cfg, &s_config, sizeof(rate_plan_config_t));
+        s_config_changed = false;
+        portEXIT_CRITICAL(&s_lock);
+        memset(s_due, 0, sizeof(s_due));
+    }
+
+    rec->field_mask = FIELD_MASK_ALL;
+
+    // CRC/파싱 실패 record는 최신값을 바꾸지 않고 그대로 발행
+    if (!rec->crc_valid || rec->field_count == 0) return;
+
+    update_latest(rec);
+
+    if (!s_active_cfg.enable) return;
+
+    uint64_t mask = 0;
+    uint32_t skipped = 0;
+
+    for (uint8_t i = 0; i < rec->field_count && i < FIELD_MASK_BITS; i++) {
+        due_state_t *st = &s_due[i];
+        uint32_t interval_ms = s_active_cfg.interval_ms[i];
+        uint16_t divider = s_active_cfg.divider[i];
+        bool due;
+
+        if (interval_ms > 0) {
+            due = !st->sent || (rec->capture_us - st->sent_us) >= (int64_t)interval_ms * 1000;
+        } else if (divider > 1) {
+            due = (st->count == 0);
+            st->count = (st->count + 1) % divider;
+        } else {
+            due = true;
+        }
+
+        if (due) {
+            mask |= (1ULL << i);
+            st->sent = true;
+            st->sent_us = rec->capture_us;
+        } else {
+            skipped++;
+        }
+    }
+
+    rec->field_mask = mask;
+    if (skipped > 0) stats_add(s_stat_skipped, skipped);
+}
+
+/*******************************************************************************
+ * Snapshot
+ ******************************************************************************/
+static void publish_snapshot(void)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (!root) return;
+
+    const mqtt_config_data_t *mqtt = mqtt_handler_get_config();
+    cJSON_AddStringToObject(root, "device_id", mqtt->device_id);
+    cJSON_AddNumberToObject(root, "timestamp", time_sync_now());
+
+    cJSON *fields_obj = cJSON_CreateObject();
+    if (fields_obj) {
+        cJSON_AddItemToObject(root, "fields", fields_obj);
+    }
+    int64_t now_us = esp_timer_get_time();
+
+    for (uint8_t i = 0; fields_obj && i < MAX_FIELD_COUNT; i++) {
+        latest_t e;
+        portENTER_CRITICAL(&s_lock);
+        memcpy(&e, &s_latest[i], sizeof(latest_t));
+        portEXIT_CRITICAL(&s_lock);
+        if (!e.valid) continue;
+
+        cJSON *field = cJSON_CreateObject();
+        if (!field) break;
+        cJSON_AddNumberToObject(field, "value", e.value);
+        cJSON_AddNumberToObject(field, "age_ms", (double)((now_us - e.updated_us) / 1000));
+        cJSON_AddItemToObject(fields_obj, e.name, field);
+    }
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json) return;
+
+    if (mqtt_handler_publish(RATE_PLAN_SNAPSHOT_SUFFIX, json, strlen(json),
+                             s_config.qos, true) != ESP_OK) {
+        ESP_LOGD(TAG, "Snapshot publish failed");
+    }
+    free(json);
+}
+
+void rate_plan_tick(void)
+{
+    if (!s_config.enable || s_config.snapshot_s == 0) return;
+    if (!mqtt_handler_is_connected() || !s_latest || !s_latest[0].valid) return;
+
+    int64_t now_us = esp_timer_get_time();
+    if (s_last_snapshot_us != 0 &&
+        now_us - s_last_snapshot_us < (int64_t)s_config.snapshot_s * 1000000) {
+        return;
+    }
+    s_last_snapshot_us = now_us;
+    publish_snapshot();
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+void rate_plan_set_config(const rate_plan_config_t *config)
+{
+    rate_plan_config_t cfg = { .enable = 0, .qos = 0, .snapshot_s = 0 };
+    if (config) {
+        memcpy(&cfg, config, sizeof(rate_plan_config_t));
+    }
+    if (cfg.qos > 2) cfg.qos = 0;
+
+    if (s_stat_skipped == STATS_INVALID_ID) {
+        s_stat_skipped = stats_register("rateplan.skipped", STATS_COUNTER);
+    }
+    if (!s_latest) {
+        s_latest = heap_caps_calloc(MAX_FIELD_COUNT, sizeof(latest_t), MALLOC_CAP_SPIRAM);
+        if (!s_latest) s_latest = calloc(MAX_FIELD_COUNT, sizeof(latest_t));
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    memcpy(&s_config, &cfg, sizeof(rate_plan_config_t));
+    s_config_changed = true;
+    portEXIT_CRITICAL(&s_lock);
+    s_last_snapshot_us = 0;
+
+    ESP_LOGI(TAG, "Config: enable=%d, snapshot=%ds", cfg.enable, cfg.snapshot_s);
+}
+
+const rate_plan_config_t* rate_plan_get_config(void)
+{
+    return &s_config;
+}
+
+void rate_plan_set_definition(const data_definition_t *def)
+{
+    // 필드 인덱스 의미가 바뀌므로 최신값과 카운터를 버림
+    portENTER_CRITICAL(&s_lock);
+    s_config_changed = true;
+    s_reset_latest = true;
+    portEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,71 @@
+/**
+ * @file rate_plan.h
+ * @brief Per-field Publish Rate Plans and Latest-value Table
+ *
+ * 필드마다 발행 주기(divider: N개 record마다 1회, 또는 interval_ms: 최소 간격)를 두고,
+ * 재정렬 단계에서 record별로 발행 대상 필드 마스크(record_t.field_mask)를 정한다.
+ * data 메시지 인코더(템플릿/cJSON)는 마스크에 없는 필드를 생략하므로
+ * payload 크기는 발행 주기가 아닌 필드 수에 비례해 줄어든다.
+ * 발행 주기는 앞 FIELD_MASK_BITS(64)개 필드까지 지정할 수 있다.
+ *
+ * 모든 필드의 최신값은 메모리 테이블에 유지되며, snapshot_s 주기로
+ * {base}/data/snapshot 에 retain 발행되어 구독자는 항상 현재 전체 값을 받을 수 있다.
+ *   {"device_id":"...","timestamp":...,"fields":{"Temp":{"value":21.5,"age_ms":120},...}}
+ *
+ * Gateway 모드 자식 장치 메시지에는 적용하지 않는다.
+ */
+
+#ifndef RATE_PLAN_H
+#define RATE_PLAN_H
+
+#include "protocol_def.h"
+#include "record_bus.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RATE_PLAN_SNAPSHOT_SUFFIX   "data/snapshot"
+
+/**
+ * @brief 설정 적용 (다음 record에서 주기 카운터 초기화)
+ * @param config 설정 (NULL이면 기본값: 비활성, 모든 필드 매 record)
+ */
+void rate_plan_set_config(const rate_plan_config_t *config);
+
+/**
+ * @brief 현재 설정 반환
+ */
+const rate_plan_config_t* rate_plan_get_config(void);
+
+/**
+ * @brief 데이터 정의 변경 알림 (최신값 테이블과 카운터 초기화)
+ */
+void rate_plan_set_definition(const data_definition_t *def);
+
+/**
+ * @brief 최신값 갱신 및 발행 대상 마스크 설정 (재정렬 단계에서 publish 전에 호출)
+ * @param rec 아직 publish 되지 않은 record
+ */
+void rate_plan_apply(record_t *rec);
+
+/**
+ * @brief 최신값 조회
+ * @param index 필드 인덱스
+ * @param out 최신 값 (scaled)
+ * @param age_ms 마지막 갱신 후 경과 시간 (NULL 가능)
+ * @return true if the field has a value
+ */
+bool rate_plan_get_latest(uint8_t index, double *out, uint32_t *age_ms);
+
+/**
+ * @brief Snapshot 주기 확인 및 발행 (1초 주기 호출)
+ */
+void rate_plan_tick(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RATE_PLAN_H
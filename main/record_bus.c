@@ -0,0 +1,167 @@
+/**
+ * @file record_bus.c
+ * @brief In-process Publish/Subscribe Bus Implementation
+ *
+ * 할당 레이아웃: [record_t][parsed_field_t x field_count][raw bytes]
+ * sink 큐에는 record 포인터만 들어가며, sink마다 참조를 하나씩 보유한다.
+ */
+
+#include "record_bus.h"
+#include "stats.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "RecordBus";
+
+typedef struct {
+    record_sink_config_t config;
+    QueueHandle_t queue;
+    TaskHandle_t task;
+    stats_id_t stat_drops;
+} record_sink_t;
+
+static record_sink_t s_sinks[RECORD_BUS_MAX_SINKS];
+static _Atomic uint8_t s_sink_count = 0;
+static stats_id_t s_stat_published = STATS_INVALID_ID;
+static stats_id_t s_stat_alloc_fail = STATS_INVALID_ID;
+
+/*******************************************************************************
+ * Records
+ ******************************************************************************/
+record_t* record_alloc(uint8_t field_count, size_t raw_len)
+{
+    size_t size = sizeof(record_t) + sizeof(parsed_field_t) * field_count + raw_len;
+    record_t *rec = malloc(size);
+    if (!rec) {
+        if (s_stat_alloc_fail == STATS_INVALID_ID) {
+            s_stat_alloc_fail = stats_register("bus.alloc_fail", STATS_COUNTER);
+        }
+        stats_inc(s_stat_alloc_fail);
+        return NULL;
+    }
+
+    memset(rec, 0, sizeof(record_t));
+    atomic_init(&rec->refs, 1);
+    rec->field_count = field_count;
+    rec->field_mask = FIELD_MASK_ALL;
+    rec->raw_len = raw_len;
+    rec->fields = (parsed_field_t *)(rec + 1);
+    rec->raw = (uint8_t *)(rec->fields + field_count);
+    return rec;
+}
+
+void record_retain(const record_t *rec)
+{
+    if (!rec) return;
+    atomic_fetch_add_explicit(&((record_t *)rec)->refs, 1, memory_order_relaxed);
+}
+
+void record_release(const record_t *rec)
+{
+    if (!rec) return;
+    if (atomic_fetch_sub_explicit(&((record_t *)rec)->refs, 1, memory_order_acq_rel) == 1) {
+        free((void *)rec);
+    }
+}
+
+/*******************************************************************************
+ * Sinks
+ ******************************************************************************/
+static void sink_task(void *arg)
+{
+    record_sink_t *sink = (record_sink_t *)arg;
+    record_t *rec;
+    TickType_t wait = portMAX_DELAY;
+
+    ESP_LOGI(TAG, "Sink '%s' started", sink->config.name);
+
+    while (1) {
+        if (xQueueReceive(sink->queue, &rec, wait) == pdTRUE) {
+            sink->config.fn(rec, sink->config.ctx);
+            record_release(rec);
+        }
+
+        if (sink->config.poll_fn) {
+            uint32_t wait_ms = sink->config.poll_fn(sink->config.ctx);
+            wait = (wait_ms == RECORD_SINK_WAIT_FOREVER) ? portMAX_DELAY : pdMS_TO_TICKS(wait_ms);
+        }
+    }
+}
+
+esp_err_t record_bus_add_sink(const record_sink_config_t *config)
+{
+    if (!config || !config->fn || !config->name || config->queue_len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t index = atomic_load(&s_sink_count);
+    if (index >= RECORD_BUS_MAX_SINKS) {
+        ESP_LOGE(TAG, "Too many sinks");
+        return ESP_ERR_NO_MEM;
+    }
+
+    record_sink_t *sink = &s_sinks[index];
+    memcpy(&sink->config, config, sizeof(record_sink_config_t));
+
+    sink->queue = xQueueCreate(config->queue_len, sizeof(record_t *));
+    if (!sink->queue) return ESP_ERR_NO_MEM;
+
+    char stat_name[STATS_NAME_MAX_LEN];
+    snprintf(stat_name, sizeof(stat_name), "bus.%s.drops", config->name);
+    sink->stat_drops = stats_register(stat_name, STATS_COUNTER);
+
+    char task_name[16];
+    snprintf(task_name, sizeof(task_name), "sink_%s", config->name);
+    if (xTaskCreate(sink_task, task_name, config->stack_size, sink,
+                    config->priority, &sink->task) != pdPASS) {
+        vQueueDelete(sink->queue);
+        sink->queue = NULL;
+        return ESP_FAIL;
+    }
+
+    if (s_stat_published == STATS_INVALID_ID) {
+        s_stat_published = stats_register("bus.published", STATS_COUNTER);
+    }
+
+    // 준비가 끝난 뒤 publish 대상에 포함
+    atomic_store(&s_sink_count, index + 1);
+    ESP_LOGI(TAG, "Sink '%s' added (queue=%d, policy=%d)",
+             config->name, config->queue_len, config->policy);
+    return ESP_OK;
+}
+
+void record_bus_publish(record_t *rec)
+{
+    if (!rec) return;
+
+    uint8_t count = atomic_load(&s_sink_count);
+    for (uint8_t i = 0; i < count; i++) {
+        record_sink_t *sink = &s_sinks[i];
+
+        record_retain(rec);
+        if (xQueueSend(sink->queue, &rec, 0) == pdTRUE) continue;
+
+        if (sink->config.policy == RECORD_DROP_OLDEST) {
+            record_t *old;
+            if (xQueueReceive(sink->queue, &old, 0) == pdTRUE) {
+                record_release(old);
+            }
+            if (xQueueSend(sink->queue, &rec, 0) == pdTRUE) {
+                stats_inc(sink->stat_drops);
+                continue;
+            }
+        }
+
+        // DROP_NEWEST (또는 재시도 실패)
+        record_release(rec);
+        stats_inc(sink->stat_drops);
+    }
+
+    stats_inc(s_stat_published);
+    record_release(rec);    // 발행자 참조
+}
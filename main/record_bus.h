@@ -0,0 +1,107 @@
+/**
+ * @file record_bus.h
+ * @brief In-process Publish/Subscribe Bus for Parsed Records
+ *
+ * 파싱 결과를 참조 카운트 기반의 불변 record로 만들어 등록된 sink들에
+ * fan-out 한다. 각 sink는 자체 bounded 큐와 태스크를 가지며,
+ * 큐가 가득 차면 sink별 drop policy에 따라 버린다.
+ * - 느린 sink가 파싱이나 다른 sink를 막지 않음
+ * - record는 sink 수와 무관하게 한 번만 할당 (포인터만 전달)
+ */
+
+#ifndef RECORD_BUS_H
+#define RECORD_BUS_H
+
+#include "protocol_def.h"
+#include "esp_err.h"
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RECORD_BUS_MAX_SINKS    8
+
+/**
+ * @brief 파싱 결과 record (publish 이후 읽기 전용)
+ */
+typedef struct {
+    _Atomic uint32_t refs;      // 내부용 - record_retain/record_release 사용
+    int64_t capture_us;         // 프레임 수신 시각 (esp_timer)
+    uint16_t sequence;
+    bool crc_valid;
+    uint8_t field_count;
+    uint64_t field_mask;        // data 메시지에 포함할 필드 (rate plan, 기본 FIELD_MASK_ALL)
+    size_t raw_len;
+    parsed_field_t *fields;     // 같은 할당 블록 내부
+    uint8_t *raw;               // 같은 할당 블록 내부
+} record_t;
+
+typedef enum {
+    RECORD_DROP_NEWEST = 0,     // 큐가 가득 차면 새 record를 버림
+    RECORD_DROP_OLDEST = 1,     // 큐가 가득 차면 가장 오래된 record를 버림
+} record_drop_policy_t;
+
+/**
+ * @brief Sink 처리 함수 (sink 태스크에서 호출, rec는 호출 동안 유효)
+ */
+typedef void (*record_sink_fn_t)(const record_t *rec, void *ctx);
+
+#define RECORD_SINK_WAIT_FOREVER    UINT32_MAX
+
+/**
+ * @brief Sink poll 함수 (record 처리 후, 또는 대기 시간 만료 시 sink 태스크에서 호출)
+ * @return 다음 record 최대 대기 시간 (ms), RECORD_SINK_WAIT_FOREVER = 무기한
+ */
+typedef uint32_t (*record_sink_poll_fn_t)(void *ctx);
+
+typedef struct {
+    const char *name;           // 태스크/통계 이름 (예: "mqtt")
+    record_sink_fn_t fn;
+    record_sink_poll_fn_t poll_fn;  // 선택 (시간 기반 flush 등), NULL이면 무기한 대기
+    void *ctx;
+    uint16_t queue_len;
+    record_drop_policy_t policy;
+    uint8_t priority;
+    uint16_t stack_size;
+} record_sink_config_t;
+
+/**
+ * @brief Record 할당 (refs=1, publish 전까지 작성 가능)
+ * @param field_count 필드 수
+ * @param raw_len 원시 프레임 길이
+ * @return record, 메모리 부족 시 NULL
+ */
+record_t* record_alloc(uint8_t field_count, size_t raw_len);
+
+/**
+ * @brief 참조 추가
+ */
+void record_retain(const record_t *rec);
+
+/**
+ * @brief 참조 해제 (0이 되면 해제)
+ */
+void record_release(const record_t *rec);
+
+/**
+ * @brief Sink 등록 (전용 태스크 생성)
+ * @param config sink 설정
+ * @return ESP_OK on success
+ */
+esp_err_t record_bus_add_sink(const record_sink_config_t *config);
+
+/**
+ * @brief 모든 sink에 record 전달
+ *
+ * 블록하지 않는다. 호출자의 참조는 이 함수가 소유권을 가져가므로
+ * 호출 후 rec를 사용하지 않는다.
+ * @param rec record_alloc()으로 만든 record
+ */
+void record_bus_publish(record_t *rec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RECORD_BUS_H
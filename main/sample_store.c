@@ -0,0 +1,225 @@
+/**
+ * @file sample_store.c
+ * @brief PSRAM Sample Store Implementation
+ *
+ * SAMPLE_STORE_BYTES 블록 하나를 저장 폭(필드 수)에 맞춰 나눈다:
+ *   [times: int64 x capacity][values: float x width x capacity][seqs: uint16 x capacity]
+ * 열 단위 배치: s_values[field * s_capacity + slot]
+ * 한 필드의 구간 집계(min/max)나 열 읽기가 연속 메모리 스캔이 되도록 한다.
+ */
+
+#include "sample_store.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "SampleStore";
+
+static uint8_t *s_block = NULL;         // SAMPLE_STORE_BYTES
+static float *s_values = NULL;          // [width][capacity]
+static int64_t *s_times = NULL;         // [capacity]
+static uint16_t *s_seqs = NULL;         // [capacity]
+static uint32_t s_capacity = 0;
+static uint32_t s_head = 0;             // 다음 기록 위치 (절대 인덱스)
+static uint32_t s_oldest = 0;           // 유효한 가장 오래된 행
+static uint8_t s_width = 0;
+static SemaphoreHandle_t s_mutex = NULL;
+
+// 폭에 맞춰 블록 재배치 (mutex 보유 상태에서 호출, 기존 행 무효화)
+static void layout(uint8_t width)
+{
+    size_t columns = width ? width : 1;
+    size_t row_bytes = sizeof(int64_t) + sizeof(float) * columns + sizeof(uint16_t);
+
+    s_width = width;
+    s_capacity = SAMPLE_STORE_BYTES / row_bytes;
+    s_times = (int64_t *)s_block;
+    s_values = (float *)(s_times + s_capacity);
+    s_seqs = (uint16_t *)(s_values + columns * s_capacity);
+
+    // 인덱스는 계속 증가시키고 기존 행만 무효화 (backfill 구간 계산 유지)
+    s_oldest = s_head;
+}
+
+static inline bool is_valid(uint32_t index)
+{
+    return (int32_t)(index - s_oldest) >= 0 && (int32_t)(s_head - index) > 0;
+}
+
+esp_err_t sample_store_init(void)
+{
+    if (s_block) return ESP_OK;
+
+    s_mutex = xSemaphoreCreateMutex();
+    if (!s_mutex) return ESP_FAIL;
+
+    s_block = heap_caps_malloc(SAMPLE_STORE_BYTES, MALLOC_CAP_SPIRAM);
+    if (!s_block) {
+        ESP_LOGE(TAG, "PSRAM allocation failed");
+        return ESP_ERR_NO_MEM;
+    }
+    layout(0);
+
+    ESP_LOGI(TAG, "Initialized: %d KB (PSRAM)", SAMPLE_STORE_BYTES / 1024);
+    return ESP_OK;
+}
+
+void sample_store_reset(uint8_t field_count)
+{
+    if (!s_block) return;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    layout((field_count < MAX_FIELD_COUNT) ? field_count : MAX_FIELD_COUNT);
+    xSemaphoreGive(s_mutex);
+
+    ESP_LOGI(TAG, "Reset: width=%d, capacity=%lu rows", s_width, (unsigned long)s_capacity);
+}
+
+void sample_store_append(int64_t capture_us, uint16_t sequence,
+                         const parsed_field_t *fields, uint8_t field_count)
+{
+    if (!s_block || !fields) return;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    // 필드 수가 바뀌면 (정의 변경) 재배치 + 기존 행 무효화
+    uint8_t width = (field_count < MAX_FIELD_COUNT) ? field_count : MAX_FIELD_COUNT;
+    if (width != s_width) {
+        layout(width);
+    }
+
+    uint32_t slot = s_head % s_capacity;
+    uint8_t count = s_width;
+
+    for (uint8_t f = 0; f < count; f++) {
+        s_values[(size_t)f * s_capacity + slot] = (float)fields[f].scaled_value;
+    }
+    s_times[slot] = capture_us;
+    s_seqs[slot] = sequence;
+
+    s_head++;
+    if (s_head - s_oldest > s_capacity) {
+        s_oldest = s_head - s_capacity;
+    }
+
+    xSemaphoreGive(s_mutex);
+}
+
+uint32_t sample_store_head(void)
+{
+    return s_head;
+}
+
+uint32_t sample_store_oldest(void)
+{
+    return s_oldest;
+}
+
+uint8_t sample_store_width(void)
+{
+    return s_width;
+}
+
+uint32_t sample_store_capacity(void)
+{
+    return s_capacity;
+}
+
+bool sample_store_read(uint32_t index, int64_t *capture_us, uint16_t *sequence,
+                       float *values, uint8_t max_values)
+{
+    if (!s_block) return false;
+
+    bool valid = false;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    if (is_valid(index)) {
+        uint32_t slot = index % s_capacity;
+        if (capture_us) *capture_us = s_times[slot];
+        if (sequence) *sequence = s_seqs[slot];
+        if (values) {
+            uint8_t count = (max_values < s_width) ? max_values : s_width;
+            for (uint8_t f = 0; f < count; f++) {
+                values[f] = s_values[(size_t)f * s_capacity + slot];
+            }
+        }
+        valid = true;
+    }
+
+    xSemaphoreGive(s_mutex);
+    return valid;
+}
+
+uint32_t sample_store_read_column(uint8_t field, uint32_t from, uint32_t count,
+                                  float *values, int64_t *capture_us)
+{
+    if (!s_block) return 0;
+
+    uint32_t n = 0;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    if (is_valid(from) && (!values || field < s_width)) {
+        uint32_t avail = s_head - from;
+        if (count > avail) count = avail;
+
+        const float *col = values ? &s_values[(size_t)field * s_capacity] : NULL;
+        for (uint32_t slot = from % s_capacity; n < count; n++) {
+            if (col) values[n] = col[slot];
+            if (capture_us) capture_us[n] = s_times[slot];
+            if (++slot == s_capacity) slot = 0;
+        }
+    }
+
+    xSemaphoreGive(s_mutex);
+    return n;
+}
+
+uint32_t sample_store_find(int64_t capture_us)
+{
+    if (!s_block) return s_head;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    // 행은 수신 순서로 기록되므로 시각이 단조 증가 → 이진 탐색
+    uint32_t lo = s_oldest;
+    uint32_t hi = s_head;
+    while ((int32_t)(hi - lo) > 0) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (s_times[mid % s_capacity] < capture_us) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    xSemaphoreGive(s_mutex);
+    return lo;
+}
+
+uint32_t sample_store_min_max(uint8_t field, uint32_t from, uint32_t to,
+                              float *min_out, float *max_out)
+{
+    if (!s_block || !min_out || !max_out) return 0;
+
+    uint32_t n = 0;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    if (field < s_width) {
+        // 덮어쓴 행/미기록 행 제외
+        if ((int32_t)(from - s_oldest) < 0) from = s_oldest;
+        if ((int32_t)(to - s_head) > 0) to = s_head;
+
+        const float *col = &s_values[(size_t)field * s_capacity];
+        for (uint32_t i = from; (int32_t)(to - i) > 0; i++) {
+            float v = col[i % s_capacity];
+            if (n == 0 || v < *min_out) *min_out = v;
+            if (n == 0 || v > *max_out) *max_out = v;
+            n++;
+        }
+    }
+
+    xSemaphoreGive(s_mutex);
+    return n;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file sample_store.h
+ * @brief PSRAM Sample Store (columnar ring of parsed values)
+ *
+ * 파싱된 필드 값을 필드별 열(column) 단위로 PSRAM ring에 보관한다.
+ * MQTT 단절 기간의 backfill과 이력 조회(history_query)에 사용된다.
+ * 행 수는 고정 메모리(SAMPLE_STORE_BYTES)를 필드 수로 나눠 정하므로
+ * 필드가 적을수록 더 긴 구간을 전체 해상도로 보관한다.
+ * 행 인덱스는 단조 증가하는 절대값(uint32)이며, ring이 덮어쓴 행은
+ * sample_store_oldest() 이전 인덱스가 된다.
+ */
+
+#ifndef SAMPLE_STORE_H
+#define SAMPLE_STORE_H
+
+#include "protocol_def.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sample store 초기화 (PSRAM 할당)
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if PSRAM unavailable
+ */
+esp_err_t sample_store_init(void);
+
+/**
+ * @brief 저장 폭(필드 수) 재설정 - 기존 행은 모두 무효화
+ * @param field_count 새 필드 수
+ */
+void sample_store_reset(uint8_t field_count);
+
+/**
+ * @brief 파싱 결과 한 행 추가
+ * @param capture_us 수신 시각 (esp_timer 기준, us)
+ * @param sequence 프레임 시퀀스
+ * @param fields 파싱된 필드 배열
+ * @param field_count 필드 수
+ */
+void sample_store_append(int64_t capture_us, uint16_t sequence,
+                         const parsed_field_t *fields, uint8_t field_count);
+
+/**
+ * @brief 다음에 기록될 행 인덱스 (= 지금까지 추가된 총 행 수)
+ */
+uint32_t sample_store_head(void);
+
+/**
+ * @brief 아직 유효한 가장 오래된 행 인덱스
+ */
+uint32_t sample_store_oldest(void);
+
+/**
+ * @brief 현재 저장 폭 (필드 수)
+ */
+uint8_t sample_store_width(void);
+
+/**
+ * @brief 현재 저장 가능한 행 수 (폭에 따라 달라짐)
+ */
+uint32_t sample_store_capacity(void);
+
+/**
+ * @brief 수신 시각 이후 첫 행 인덱스
+ * @param capture_us 수신 시각 (esp_timer 기준, us)
+ * @return capture_us 이상인 가장 오래된 유효 행, 없으면 sample_store_head()
+ */
+uint32_t sample_store_find(int64_t capture_us);
+
+/**
+ * @brief 한 필드의 연속 행 읽기 (열 단위 복사)
+ * @param field 필드 인덱스 (values가 NULL이면 무시)
+ * @param from 시작 행 (포함)
+ * @param count 최대 행 수
+ * @param values 값 출력 (NULL 허용)
+ * @param capture_us 수신 시각 출력 (NULL 허용)
+ * @return 복사한 행 수 (from이 이미 덮어쓴 행이면 0)
+ */
+uint32_t sample_store_read_column(uint8_t field, uint32_t from, uint32_t count,
+                                  float *values, int64_t *capture_us);
+
+/**
+ * @brief 한 행 읽기
+ * @param index 절대 행 인덱스
+ * @param capture_us 수신 시각 출력 (NULL 허용)
+ * @param sequence 시퀀스 출력 (NULL 허용)
+ * @param values 값 출력 배열 (NULL 허용)
+ * @param max_values values 배열 크기
+ * @return true if the row is still valid
+ */
+bool sample_store_read(uint32_t index, int64_t *capture_us, uint16_t *sequence,
+                       float *values, uint8_t max_values);
+
+/**
+ * @brief 구간 [from, to) 의 한 필드 min/max 계산
+ * @param field 필드 인덱스
+ * @param from 시작 행 (포함)
+ * @param to 끝 행 (미포함)
+ * @param min_out 최소값 출력
+ * @param max_out 최대값 출력
+ * @return 실제로 집계된 행 수 (0이면 출력 미정)
+ */
+uint32_t sample_store_min_max(uint8_t field, uint32_t from, uint32_t to,
+                              float *min_out, float *max_out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SAMPLE_STORE_H
@@ -0,0 +1,379 @@
+/**
+ * @file serial_monitor.c
+ * @brief Raw Serial Monitor Stream Implementation
+ *
+ * UART RX 태스크는 record를 ring buffer에 넣기만 하고 (timeout 0, 실패 시 drop 집계),
+ * 모니터 태스크가 chunk로 묶어 속도 제한에 맞춰 전송한다.
+ * 모니터 태스크는 시작 시 생성되고 중지 후 ring을 비운 뒤 스스로 종료한다.
+ * Ring은 처음 시작할 때 한 번 만들어 재사용한다 (UART 태스크가 해제 중인 ring을 보지 않도록).
+ */
+
+#include "serial_monitor.h"
+#include "ble_service.h"
+#include "mqtt_handler.h"
+#include "stats.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/ringbuf.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "Monitor";
+
+#define CHUNK_HDR_LEN       8
+#define REC_HDR_LEN         5
+#define ITEM_HDR_LEN        5       // ring item: type(1) t_ms(4)
+#define SEGMENT_MAX         128
+#define SEGMENT_MIN         8
+#define BLE_PACKET_OVERHEAD 10      // ATT(3) + STX/CMD/LEN/CRC/ETX(7)
+
+static RingbufHandle_t s_ring = NULL;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool s_active = false;
+static bool s_task_running = false;
+
+// 세션 설정 (s_lock으로 갱신)
+static monitor_transport_t s_transport = MONITOR_TRANSPORT_BLE;
+static uint8_t s_capture = MONITOR_CAPTURE_ALL;
+static uint32_t s_rate_bps = MONITOR_RATE_BLE;
+static size_t s_segment = SEGMENT_MAX;
+static int64_t s_start_us = 0;
+static int64_t s_end_us = 0;
+static uint32_t s_dropped = 0;
+
+// Chunk 조립 (모니터 태스크 전용)
+static uint8_t *s_chunk = NULL;
+static size_t s_chunk_len = 0;
+static size_t s_chunk_cap = 0;
+static uint32_t s_chunk_t0 = 0;
+static int64_t s_chunk_open_us = 0;
+static uint16_t s_chunk_seq = 0;
+static int64_t s_tokens = 0;
+static int64_t s_refill_us = 0;
+
+static stats_id_t s_stat_active = STATS_INVALID_ID;
+static stats_id_t s_stat_bytes = STATS_INVALID_ID;
+static stats_id_t s_stat_dropped = STATS_INVALID_ID;
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)((esp_timer_get_time() - s_start_us) / 1000);
+}
+
+static size_t chunk_capacity(monitor_transport_t transport)
+{
+    if (transport == MONITOR_TRANSPORT_BLE) {
+        uint16_t mtu = ble_service_get_mtu();
+        size_t cap = (mtu > BLE_PACKET_OVERHEAD) ? mtu - BLE_PACKET_OVERHEAD : 0;
+        return (cap < MONITOR_CHUNK_MAX) ? cap : MONITOR_CHUNK_MAX;
+    }
+    return MONITOR_CHUNK_MAX;
+}
+
+/*******************************************************************************
+ * Producer (UART RX 태스크 / 명령 executor)
+ ******************************************************************************/
+static void push(uint8_t type, const uint8_t *data, size_t len)
+{
+    uint8_t item[ITEM_HDR_LEN + SEGMENT_MAX];
+    uint32_t t_ms = now_ms();
+    size_t segment = s_segment;
+    size_t off = 0;
+
+    do {
+        size_t n = len - off;
+        if (n > segment) n = segment;
+
+        item[0] = type | (off > 0 ? MONITOR_REC_CONTINUED : 0);
+        memcpy(&item[1], &t_ms, sizeof(t_ms));
+        if (n > 0) memcpy(&item[ITEM_HDR_LEN], &data[off], n);
+
+        if (xRingbufferSend(s_ring, item, ITEM_HDR_LEN + n, 0) != pdTRUE) {
+            portENTER_CRITICAL(&s_lock);
+            s_dropped += n + REC_HDR_LEN;
+            portEXIT_CRITICAL(&s_lock);
+        }
+        off += n;
+    } while (off < len);
+}
+
+/*******************************************************************************
+ * Chunk 조립 / 전송 (모니터 태스크)
+ ******************************************************************************/
+static void send_chunk(void)
+{
+    monitor_transport_t transport;
+    uint32_t rate;
+    portENTER_CRITICAL(&s_lock);
+    transport = s_transport;
+    rate = s_rate_bps;
+    portEXIT_CRITICAL(&s_lock);
+
+    // Token bucket (1초 burst) - 부족하면 기다리고, 그동안 넘치는 record는 UART 쪽에서 drop
+    int64_t now_us = esp_timer_get_time();
+    int64_t burst = (rate > s_chunk_len) ? rate : s_chunk_len;
+    s_tokens += (now_us - s_refill_us) * rate / 1000000;
+    if (s_tokens > burst) s_tokens = burst;
+    s_refill_us = now_us;
+    if (s_tokens < (int64_t)s_chunk_len) {
+        uint32_t wait_ms = (uint32_t)(((int64_t)s_chunk_len - s_tokens) * 1000 / rate) + 1;
+        vTaskDelay(pdMS_TO_TICKS(wait_ms));
+        s_tokens = s_chunk_len;
+        s_refill_us = esp_timer_get_time();
+    }
+    s_tokens -= s_chunk_len;
+
+    esp_err_t ret;
+    if (transport == MONITOR_TRANSPORT_BLE) {
+        ret = ble_service_notify_monitor(s_chunk, s_chunk_len);
+        if (ret == ESP_ERR_INVALID_STATE && s_active) {
+            ESP_LOGW(TAG, "BLE disconnected, stopping monitor");
+            s_active = false;
+        }
+    } else {
+        char topic[256];
+        mqtt_handler_build_topic(topic, sizeof(topic), "monitor");
+        ret = mqtt_handler_is_connected()
+            ? mqtt_handler_publish_topic(topic, (const char *)s_chunk, s_chunk_len, 0, false)
+            : ESP_ERR_INVALID_STATE;
+    }
+
+    if (ret == ESP_OK) {
+        stats_add(s_stat_bytes, s_chunk_len);
+    } else {
+        stats_add(s_stat_dropped, s_chunk_len);
+    }
+}
+
+static void flush_chunk(void)
+{
+    if (s_chunk_len <= CHUNK_HDR_LEN) {
+        s_chunk_len = 0;
+        return;
+    }
+    send_chunk();
+    s_chunk_len = 0;
+}
+
+static void append_record(uint8_t type, uint32_t t_ms, const uint8_t *data, size_t len)
+{
+    if (s_chunk_len > 0 &&
+        (s_chunk_len + REC_HDR_LEN + len > s_chunk_cap || t_ms - s_chunk_t0 > UINT16_MAX)) {
+        flush_chunk();
+    }
+
+    if (s_chunk_len == 0) {
+        portENTER_CRITICAL(&s_lock);
+        s_chunk_cap = chunk_capacity(s_transport);
+        portEXIT_CRITICAL(&s_lock);
+        if (s_chunk_cap < CHUNK_HDR_LEN + REC_HDR_LEN) return;
+
+        s_chunk[0] = MONITOR_CHUNK_MAGIC;
+        s_chunk[1] = MONITOR_CHUNK_VERSION;
+        s_chunk[2] = s_chunk_seq & 0xFF;
+        s_chunk[3] = (s_chunk_seq >> 8) & 0xFF;
+        memcpy(&s_chunk[4], &t_ms, sizeof(t_ms));
+        s_chunk_seq++;
+        s_chunk_t0 = t_ms;
+        s_chunk_open_us = esp_timer_get_time();
+        s_chunk_len = CHUNK_HDR_LEN;
+    }
+
+    // 전송 중 MTU가 줄어든 경우 잘라서라도 전송
+    if (s_chunk_len + REC_HDR_LEN + len > s_chunk_cap) {
+        len = s_chunk_cap - s_chunk_len - REC_HDR_LEN;
+    }
+
+    uint16_t dt = (t_ms > s_chunk_t0) ? (uint16_t)(t_ms - s_chunk_t0) : 0;
+    uint8_t *rec = &s_chunk[s_chunk_len];
+    rec[0] = type;
+    rec[1] = dt & 0xFF;
+    rec[2] = (dt >> 8) & 0xFF;
+    rec[3] = len & 0xFF;
+    rec[4] = (len >> 8) & 0xFF;
+    if (len > 0) memcpy(&rec[REC_HDR_LEN], data, len);
+    s_chunk_len += REC_HDR_LEN + len;
+}
+
+static void append_event(monitor_event_t event, uint32_t arg, bool with_arg)
+{
+    uint8_t data[5] = { event };
+    memcpy(&data[1], &arg, sizeof(arg));
+    append_record(MONITOR_REC_EVENT, now_ms(), data, with_arg ? 5 : 1);
+}
+
+static void monitor_task(void *arg)
+{
+    ESP_LOGI(TAG, "Monitor task started");
+
+    while (1) {
+        // 자동 종료
+        if (s_active) {
+            int64_t end_us;
+            portENTER_CRITICAL(&s_lock);
+            end_us = s_end_us;
+            portEXIT_CRITICAL(&s_lock);
+            if (esp_timer_get_time() >= end_us) {
+                ESP_LOGI(TAG, "Duration elapsed, stopping");
+                s_active = false;
+            }
+        }
+
+        uint32_t dropped;
+        portENTER_CRITICAL(&s_lock);
+        dropped = s_dropped;
+        s_dropped = 0;
+        portEXIT_CRITICAL(&s_lock);
+        if (dropped > 0) {
+            stats_add(s_stat_dropped, dropped);
+            append_event(MONITOR_EVT_DROPPED, dropped, true);
+        }
+
+        size_t size = 0;
+        uint8_t *item = xRingbufferReceive(s_ring, &size, pdMS_TO_TICKS(MONITOR_FLUSH_MS));
+        if (item) {
+            uint32_t t_ms;
+            memcpy(&t_ms, &item[1], sizeof(t_ms));
+            append_record(item[0], t_ms, &item[ITEM_HDR_LEN], size - ITEM_HDR_LEN);
+            vRingbufferReturnItem(s_ring, item);
+        }
+
+        if (s_chunk_len > 0 &&
+            (!item || esp_timer_get_time() - s_chunk_open_us >= MONITOR_FLUSH_MS * 1000LL)) {
+            flush_chunk();
+        }
+
+        // 중지 후 ring이 비면 종료 (그 사이 다시 시작되면 계속)
+        if (!item && !s_active) {
+            append_event(MONITOR_EVT_STOPPED, 0, false);
+            flush_chunk();
+
+            bool exit;
+            portENTER_CRITICAL(&s_lock);
+            exit = !s_active;
+            if (exit) s_task_running = false;
+            portEXIT_CRITICAL(&s_lock);
+            if (exit) break;
+        }
+    }
+
+    stats_set(s_stat_active, 0);
+    ESP_LOGI(TAG, "Monitor task stopped");
+    vTaskDelete(NULL);
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+esp_err_t serial_monitor_start(monitor_transport_t transport, uint16_t duration_s,
+                               uint8_t capture, uint32_t rate_bps)
+{
+    if (duration_s == 0) duration_s = MONITOR_DEFAULT_DURATION_S;
+    if (duration_s > MONITOR_MAX_DURATION_S) duration_s = MONITOR_MAX_DURATION_S;
+    if (capture == 0) capture = MONITOR_CAPTURE_ALL;
+    if (rate_bps == 0) {
+        rate_bps = (transport == MONITOR_TRANSPORT_BLE) ? MONITOR_RATE_BLE : MONITOR_RATE_MQTT;
+    }
+
+    if (transport == MONITOR_TRANSPORT_BLE && !ble_service_is_connected()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // 한 chunk에 record 헤더 + 최소 조각이 들어가야 함 (BLE 기본 MTU 23은 불가)
+    size_t cap = chunk_capacity(transport);
+    if (cap < CHUNK_HDR_LEN + REC_HDR_LEN + SEGMENT_MIN) {
+        ESP_LOGW(TAG, "Chunk capacity too small: %d", cap);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    size_t segment = cap - CHUNK_HDR_LEN - REC_HDR_LEN;
+    if (segment > SEGMENT_MAX) segment = SEGMENT_MAX;
+
+    if (!s_ring) {
+        s_chunk = malloc(MONITOR_CHUNK_MAX);
+        s_ring = xRingbufferCreate(MONITOR_RING_SIZE, RINGBUF_TYPE_NOSPLIT);
+        if (!s_ring || !s_chunk) {
+            free(s_chunk);
+            s_chunk = NULL;
+            s_ring = NULL;
+            return ESP_ERR_NO_MEM;
+        }
+        s_stat_active = stats_register("monitor.active", STATS_GAUGE);
+        s_stat_bytes = stats_register("monitor.bytes", STATS_COUNTER);
+        s_stat_dropped = stats_register("monitor.dropped", STATS_COUNTER);
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    bool create;
+    portENTER_CRITICAL(&s_lock);
+    if (!s_task_running) {
+        s_start_us = now_us;
+        s_dropped = 0;
+    }
+    s_transport = transport;
+    s_capture = capture;
+    s_rate_bps = rate_bps;
+    s_segment = segment;
+    s_end_us = now_us + (int64_t)duration_s * 1000000;
+    s_active = true;
+    create = !s_task_running;
+    s_task_running = true;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (create) {
+        s_chunk_len = 0;
+        s_chunk_seq = 0;
+        s_tokens = rate_bps;
+        s_refill_us = now_us;
+        if (xTaskCreate(monitor_task, "monitor", TASK_STACK_MONITOR,
+                        NULL, TASK_PRIORITY_MONITOR, NULL) != pdPASS) {
+            portENTER_CRITICAL(&s_lock);
+            s_active = false;
+            s_task_running = false;
+            portEXIT_CRITICAL(&s_lock);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    uint8_t started = MONITOR_EVT_STARTED;
+    push(MONITOR_REC_EVENT, &started, 1);
+    stats_set(s_stat_active, 1);
+
+    ESP_LOGI(TAG, "Started: %s, %ds, capture=0x%02X, %lu B/s",
+             transport == MONITOR_TRANSPORT_BLE ? "BLE" : "MQTT",
+             duration_s, capture, (unsigned long)rate_bps);
+    return ESP_OK;
+}
+
+void serial_monitor_stop(void)
+{
+    if (s_active) {
+        s_active = false;
+        ESP_LOGI(TAG, "Stop requested");
+    }
+}
+
+bool serial_monitor_is_active(void)
+{
+    return s_active;
+}
+
+void serial_monitor_on_rx(const uint8_t *data, size_t len)
+{
+    if (!s_active || !(s_capture & MONITOR_CAPTURE_RX)) return;
+    push(MONITOR_REC_RX, data, len);
+}
+
+void serial_monitor_on_frame(const uint8_t *data, size_t len, bool crc_valid)
+{
+    if (!s_active || !(s_capture & MONITOR_CAPTURE_FRAMES)) return;
+    push(crc_valid ? MONITOR_REC_FRAME : MONITOR_REC_FRAME_ERR, data, len);
+}
+
+void serial_monitor_on_event(monitor_event_t event)
+{
+    if (!s_active) return;
+    uint8_t code = (uint8_t)event;
+    push(MONITOR_REC_EVENT, &code, 1);
+}
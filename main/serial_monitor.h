@@ -0,0 +1,103 @@
+/**
+ * @file serial_monitor.h
+ * @brief Raw Serial Monitor Stream
+ *
+ * 현장 노트북/스니퍼 없이 라인을 진단할 수 있도록 UART 트래픽을
+ * 타임스탬프가 붙은 바이너리 chunk로 BLE(RSP_MONITOR) 또는 MQTT({base}/monitor)에 전송한다.
+ * - 프레이밍 전 수신 바이트 / 프레이밍 후 프레임(CRC 결과 포함) / 오류 이벤트
+ * - 전송량은 bytes/s 로 제한, 초과분은 UART 태스크에서 버리고 drop 이벤트로 보고
+ * - duration 경과 시 자동 종료
+ *
+ * Chunk 형식 (little endian):
+ *   header  : 'M'(1) version(1) seq(2) t0_ms(4)        - t0 = 모니터 시작 후 경과 ms
+ *   record  : type(1) dt_ms(2) len(2) data(len)        - dt = t0 기준
+ *   type bit7 = 앞 record에 이어지는 조각 (chunk 크기보다 긴 프레임은 나눠 전송)
+ */
+
+#ifndef SERIAL_MONITOR_H
+#define SERIAL_MONITOR_H
+
+#include "protocol_def.h"
+#include "esp_err.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MONITOR_CHUNK_MAGIC     0x4D    // 'M'
+#define MONITOR_CHUNK_VERSION   1
+
+// 캡처 대상
+#define MONITOR_CAPTURE_RX      0x01    // 프레이밍 전 수신 바이트
+#define MONITOR_CAPTURE_FRAMES  0x02    // 프레이밍 후 프레임
+#define MONITOR_CAPTURE_ALL     (MONITOR_CAPTURE_RX | MONITOR_CAPTURE_FRAMES)
+
+typedef enum {
+    MONITOR_TRANSPORT_BLE = 0,
+    MONITOR_TRANSPORT_MQTT,
+} monitor_transport_t;
+
+// Record type
+typedef enum {
+    MONITOR_REC_RX          = 0x01,     // 수신 바이트
+    MONITOR_REC_FRAME       = 0x02,     // 프레임 (CRC OK)
+    MONITOR_REC_FRAME_ERR   = 0x03,     // 프레임 (CRC 오류)
+    MONITOR_REC_EVENT       = 0x04,     // data[0] = monitor_event_t (+ 인자)
+} monitor_rec_type_t;
+
+#define MONITOR_REC_CONTINUED   0x80
+
+// Event code
+typedef enum {
+    MONITOR_EVT_FIFO_OVF    = 0x01,
+    MONITOR_EVT_BUFFER_FULL = 0x02,
+    MONITOR_EVT_PARITY_ERR  = 0x03,
+    MONITOR_EVT_FRAME_ERR   = 0x04,
+    MONITOR_EVT_DISCARDED   = 0x05,     // 타임아웃으로 버린 미완성 프레임
+    MONITOR_EVT_STARTED     = 0x10,
+    MONITOR_EVT_STOPPED     = 0x11,
+    MONITOR_EVT_DROPPED     = 0x12,     // + 버린 바이트 수 (4, LE)
+} monitor_event_t;
+
+/**
+ * @brief 모니터 시작 (이미 동작 중이면 전송 경로/기간/속도만 갱신)
+ * @param transport 전송 경로
+ * @param duration_s 자동 종료까지 시간 (0이면 기본값, 최대 MONITOR_MAX_DURATION_S)
+ * @param capture MONITOR_CAPTURE_* 조합 (0이면 전체)
+ * @param rate_bps 전송 속도 상한 bytes/s (0이면 경로별 기본값)
+ * @return ESP_OK on success
+ */
+esp_err_t serial_monitor_start(monitor_transport_t transport, uint16_t duration_s,
+                               uint8_t capture, uint32_t rate_bps);
+
+/**
+ * @brief 모니터 중지 (남은 record 전송 후 STOPPED 이벤트로 종료)
+ */
+void serial_monitor_stop(void);
+
+/**
+ * @brief 동작 여부
+ */
+bool serial_monitor_is_active(void);
+
+/**
+ * @brief UART 수신 바이트 (UART RX 태스크에서 호출, 비활성 시 즉시 반환)
+ */
+void serial_monitor_on_rx(const uint8_t *data, size_t len);
+
+/**
+ * @brief 프레임 검출 결과 (UART RX 태스크에서 호출)
+ */
+void serial_monitor_on_frame(const uint8_t *data, size_t len, bool crc_valid);
+
+/**
+ * @brief 라인 오류 이벤트 (UART RX 태스크에서 호출)
+ */
+void serial_monitor_on_event(monitor_event_t event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERIAL_MONITOR_H
@@ -0,0 +1,128 @@
+/**
+ * @file stats.c
+ * @brief Pipeline Statistics Registry Implementation
+ *
+ * Counter는 코어별 shard 배열에 기록한다. 각 shard는 cache line 경계에
+ * 정렬되어 서로 다른 코어의 태스크가 같은 line을 두고 경합하지 않는다.
+ * 기록은 lock 없이 relaxed atomic add 한 번이며, 읽기 쪽에서 shard를 합산한다.
+ */
+
+#include "stats.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#define STATS_CACHE_LINE        64
+
+typedef struct {
+    _Atomic uint32_t value[STATS_MAX_METRICS];
+} __attribute__((aligned(STATS_CACHE_LINE))) stats_shard_t;
+
+typedef struct {
+    char name[STATS_NAME_MAX_LEN];
+    stats_kind_t kind;
+} stats_meta_t;
+
+static stats_shard_t s_shards[portNUM_PROCESSORS];
+static stats_meta_t s_meta[STATS_MAX_METRICS];
+static _Atomic uint8_t s_count = 0;
+static portMUX_TYPE s_register_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/*******************************************************************************
+ * Registration
+ ******************************************************************************/
+stats_id_t stats_find(const char *name)
+{
+    if (!name) return STATS_INVALID_ID;
+
+    uint8_t count = atomic_load_explicit(&s_count, memory_order_acquire);
+    for (uint8_t i = 0; i < count; i++) {
+        if (strncmp(s_meta[i].name, name, STATS_NAME_MAX_LEN) == 0) {
+            return i;
+        }
+    }
+    return STATS_INVALID_ID;
+}
+
+stats_id_t stats_register(const char *name, stats_kind_t kind)
+{
+    if (!name) return STATS_INVALID_ID;
+
+    taskENTER_CRITICAL(&s_register_lock);
+
+    stats_id_t id = stats_find(name);
+    if (id == STATS_INVALID_ID) {
+        uint8_t count = atomic_load_explicit(&s_count, memory_order_relaxed);
+        if (count < STATS_MAX_METRICS) {
+            strncpy(s_meta[count].name, name, STATS_NAME_MAX_LEN - 1);
+            s_meta[count].kind = kind;
+            // 메타데이터 기록 후 공개 (reader는 s_count까지만 본다)
+            atomic_store_explicit(&s_count, count + 1, memory_order_release);
+            id = count;
+        }
+    }
+
+    taskEXIT_CRITICAL(&s_register_lock);
+    return id;
+}
+
+/*******************************************************************************
+ * Hot Path
+ ******************************************************************************/
+void stats_add(stats_id_t id, uint32_t n)
+{
+    if (id >= STATS_MAX_METRICS) return;
+    atomic_fetch_add_explicit(&s_shards[xPortGetCoreID()].value[id], n,
+                              memory_order_relaxed);
+}
+
+void stats_inc(stats_id_t id)
+{
+    stats_add(id, 1);
+}
+
+void stats_set(stats_id_t id, uint32_t value)
+{
+    if (id >= STATS_MAX_METRICS) return;
+    // gauge는 shard 0 하나만 사용
+    atomic_store_explicit(&s_shards[0].value[id], value, memory_order_relaxed);
+}
+
+/*******************************************************************************
+ * Read Side
+ ******************************************************************************/
+uint32_t stats_get(stats_id_t id)
+{
+    if (id >= STATS_MAX_METRICS) return 0;
+
+    uint32_t sum = 0;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        sum += atomic_load_explicit(&s_shards[core].value[id], memory_order_relaxed);
+    }
+    return sum;
+}
+
+void stats_reset(stats_id_t id)
+{
+    if (id >= STATS_MAX_METRICS) return;
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        atomic_store_explicit(&s_shards[core].value[id], 0, memory_order_relaxed);
+    }
+}
+
+size_t stats_snapshot(stats_entry_t *out, size_t max_entries)
+{
+    if (!out) return 0;
+
+    uint8_t count = atomic_load_explicit(&s_count, memory_order_acquire);
+    size_t n = (count < max_entries) ? count : max_entries;
+
+    for (size_t i = 0; i < n; i++) {
+        out[i].name = s_meta[i].name;
+        out[i].kind = s_meta[i].kind;
+        out[i].value = stats_get((stats_id_t)i);
+    }
+    return n;
+}
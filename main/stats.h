@@ -0,0 +1,91 @@
+/**
+ * @file stats.h
+ * @brief Pipeline Statistics Registry
+ *
+ * 이름으로 등록하는 counter/gauge 레지스트리.
+ * - counter: 코어별 shard에 atomic 증가, 읽을 때 합산 (hot path = atomic add 1회)
+ * - gauge  : 단일 atomic 값 (마지막 기록 값)
+ * 등록된 모든 항목은 stats_snapshot()으로 한 번에 읽으며,
+ * status 토픽의 "metrics" 객체는 이 스냅샷에서 자동 생성된다.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STATS_MAX_METRICS       48
+#define STATS_NAME_MAX_LEN      24
+#define STATS_INVALID_ID        0xFF
+
+typedef uint8_t stats_id_t;
+
+typedef enum {
+    STATS_COUNTER = 0,
+    STATS_GAUGE = 1,
+} stats_kind_t;
+
+typedef struct {
+    const char *name;
+    stats_kind_t kind;
+    uint32_t value;
+} stats_entry_t;
+
+/**
+ * @brief 항목 등록 (같은 이름이 이미 있으면 기존 ID 반환)
+ * @param name 항목 이름 (예: "uart.rx_frames")
+ * @param kind counter 또는 gauge
+ * @return 항목 ID, 레지스트리가 가득 차면 STATS_INVALID_ID
+ */
+stats_id_t stats_register(const char *name, stats_kind_t kind);
+
+/**
+ * @brief 이름으로 항목 ID 조회
+ * @return 항목 ID, 없으면 STATS_INVALID_ID
+ */
+stats_id_t stats_find(const char *name);
+
+/**
+ * @brief Counter 1 증가
+ */
+void stats_inc(stats_id_t id);
+
+/**
+ * @brief Counter n 증가
+ */
+void stats_add(stats_id_t id, uint32_t n);
+
+/**
+ * @brief Gauge 값 설정
+ */
+void stats_set(stats_id_t id, uint32_t value);
+
+/**
+ * @brief 항목 값 읽기 (counter는 전 코어 합산)
+ */
+uint32_t stats_get(stats_id_t id);
+
+/**
+ * @brief 항목 값을 0으로 초기화
+ */
+void stats_reset(stats_id_t id);
+
+/**
+ * @brief 등록된 전체 항목 스냅샷
+ * @param out 출력 배열
+ * @param max_entries 배열 크기
+ * @return 기록된 항목 수
+ */
+size_t stats_snapshot(stats_entry_t *out, size_t max_entries);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STATS_H
@@ -0,0 +1,199 @@
+/**
+ * @file time_sync.c
+ * @brief SNTP Time Sync Implementation
+ *
+ * 매핑: wall(m) = base_wall + (m - base_mono) x (1 + drift)
+ * 동기화마다 예측 wall과 실제 wall의 차이를 경과 시간으로 나눠 drift를 절반씩 보정하고
+ * (TIME_DRIFT_MAX_PPM 제한), 기준점을 새 동기화 시점으로 옮긴다.
+ * 기준점 갱신 시 1초 이상 차이 나면 (서버 변경, 수동 설정) drift 추정을 초기화한다.
+ */
+
+#include "time_sync.h"
+#include "stats.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_netif_sntp.h"
+#include "esp_sntp.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <time.h>
+
+static const char *TAG = "TimeSync";
+
+#define DRIFT_MIN_INTERVAL_US   (60LL * 1000000)    // 이보다 짧은 간격은 drift 추정에 쓰지 않음
+#define STEP_RESET_US           1000000LL
+
+typedef struct {
+    bool valid;
+    bool synced;                // SNTP 기준점 (RTC 유지 시각은 false)
+    int64_t base_mono_us;
+    int64_t base_wall_us;
+    double drift;               // 단조 시계 대비 비율 오차
+} time_map_t;
+
+static time_config_t s_config = {
+    .server = DEFAULT_TIME_SERVER,
+    .resync_s = DEFAULT_TIME_RESYNC_S,
+};
+static char s_server[TIME_SERVER_MAX_LEN];  // SNTP가 포인터를 보관
+static bool s_started = false;
+
+static time_map_t s_map = { .valid = false };
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static stats_id_t s_stat_syncs = STATS_INVALID_ID;
+static stats_id_t s_stat_correction = STATS_INVALID_ID;
+
+/*******************************************************************************
+ * Mapping
+ ******************************************************************************/
+static void on_sync(struct timeval *tv)
+{
+    int64_t mono_us = esp_timer_get_time();
+    int64_t wall_us = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+    int64_t error_us = 0;
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_map.synced) {
+        int64_t elapsed = mono_us - s_map.base_mono_us;
+        int64_t predicted = s_map.base_wall_us + elapsed + (int64_t)(elapsed * s_map.drift);
+        error_us = wall_us - predicted;
+
+        if (llabs(error_us) >= STEP_RESET_US) {
+            s_map.drift = 0;
+        } else if (elapsed >= DRIFT_MIN_INTERVAL_US) {
+            const double max = TIME_DRIFT_MAX_PPM / 1e6;
+            s_map.drift += ((double)error_us / (double)elapsed) / 2;
+            if (s_map.drift > max) s_map.drift = max;
+            if (s_map.drift < -max) s_map.drift = -max;
+        }
+    }
+    s_map.base_mono_us = mono_us;
+    s_map.base_wall_us = wall_us;
+    s_map.valid = true;
+    s_map.synced = true;
+    double drift_ppm = s_map.drift * 1e6;
+    portEXIT_CRITICAL(&s_lock);
+
+    stats_inc(s_stat_syncs);
+    stats_set(s_stat_correction, (uint32_t)llabs(error_us));
+    ESP_LOGI(TAG, "Synced: correction=%lldus, drift=%.1fppm", (long long)error_us, drift_ppm);
+}
+
+bool time_sync_is_valid(void)
+{
+    return s_map.valid;
+}
+
+int64_t time_sync_wall_ms(int64_t capture_us, bool *valid)
+{
+    portENTER_CRITICAL(&s_lock);
+    time_map_t map = s_map;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (valid) *valid = map.valid;
+    if (!map.valid) {
+        return capture_us / 1000;       // 1970 + 부팅 후 경과 (동기화 전 기존 동작)
+    }
+
+    int64_t elapsed = capture_us - map.base_mono_us;
+    return (map.base_wall_us + elapsed + (int64_t)(elapsed * map.drift)) / 1000;
+}
+
+int64_t time_sync_mono_us(int64_t wall_ms)
+{
+    portENTER_CRITICAL(&s_lock);
+    time_map_t map = s_map;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (!map.valid) return wall_ms * 1000;
+
+    int64_t delta = wall_ms * 1000 - map.base_wall_us;
+    return map.base_mono_us + (int64_t)(delta / (1.0 + map.drift));
+}
+
+double time_sync_timestamp(int64_t capture_us, bool *valid)
+{
+    return (double)time_sync_wall_ms(capture_us, valid) / 1000.0;
+}
+
+double time_sync_now(void)
+{
+    return time_sync_timestamp(esp_timer_get_time(), NULL);
+}
+
+/*******************************************************************************
+ * SNTP
+ ******************************************************************************/
+static esp_err_t start_sntp(void)
+{
+    strncpy(s_server, s_config.server[0] ? s_config.server : DEFAULT_TIME_SERVER,
+            sizeof(s_server) - 1);
+
+    esp_sntp_config_t cfg = ESP_NETIF_SNTP_DEFAULT_CONFIG(s_server);
+    cfg.sync_cb = on_sync;
+    cfg.wait_for_sync = false;
+
+    sntp_set_sync_interval((uint32_t)s_config.resync_s * 1000);
+    esp_err_t ret = esp_netif_sntp_init(&cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "SNTP init failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    s_started = true;
+
+    ESP_LOGI(TAG, "SNTP started: %s (resync %ds)", s_server, s_config.resync_s);
+    return ESP_OK;
+}
+
+esp_err_t time_sync_init(void)
+{
+    if (s_started) return ESP_OK;
+
+    s_stat_syncs = stats_register("time.syncs", STATS_COUNTER);
+    s_stat_correction = stats_register("time.correction_us", STATS_GAUGE);
+
+    // 소프트 재시작 후 RTC 시각 유지 → 동기화 전에도 사용 (drift 추정에는 쓰지 않음)
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    if (now.tv_sec >= TIME_VALID_EPOCH) {
+        portENTER_CRITICAL(&s_lock);
+        s_map.base_mono_us = esp_timer_get_time();
+        s_map.base_wall_us = (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+        s_map.valid = true;
+        portEXIT_CRITICAL(&s_lock);
+        ESP_LOGI(TAG, "RTC time retained across restart");
+    }
+
+    return start_sntp();
+}
+
+void time_sync_set_config(const time_config_t *config)
+{
+    time_config_t cfg = { .server = DEFAULT_TIME_SERVER, .resync_s = DEFAULT_TIME_RESYNC_S };
+    if (config) {
+        memcpy(&cfg, config, sizeof(time_config_t));
+        cfg.server[TIME_SERVER_MAX_LEN - 1] = '\0';
+    }
+    if (cfg.server[0] == '\0') {
+        strncpy(cfg.server, DEFAULT_TIME_SERVER, sizeof(cfg.server) - 1);
+    }
+    if (cfg.resync_s < TIME_RESYNC_MIN_S) cfg.resync_s = TIME_RESYNC_MIN_S;
+
+    bool changed = (strcmp(cfg.server, s_config.server) != 0 || cfg.resync_s != s_config.resync_s);
+    memcpy(&s_config, &cfg, sizeof(time_config_t));
+
+    // 실행 중이면 새 서버/주기로 재시작 (기준점과 drift 추정은 유지)
+    if (s_started && changed) {
+        esp_netif_sntp_deinit();
+        s_started = false;
+        start_sntp();
+    }
+}
+
+const time_config_t* time_sync_get_config(void)
+{
+    return &s_config;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file time_sync.h
+ * @brief SNTP Time Sync and Monotonic-to-Wall-clock Mapping
+ *
+ * SNTP 동기화 시점마다 (esp_timer 단조 시각, wall clock) 기준점을 갱신하고,
+ * 연속된 동기화 사이의 오차로 단조 시계 drift를 추정해 기준점 사이를 보정한다.
+ * record는 수신 시각을 단조 시각(capture_us)으로만 가지며 wall clock 변환은
+ * 인코딩 시점에 하므로, 동기화 전에 수신되어 아직 발행되지 않은 record(큐, 배치,
+ * sample store, 알람 대기)는 동기화 후 올바른 시각으로 다시 계산된다.
+ *
+ * 동기화 전에는 (1970 + 부팅 후 경과 시간)을 반환하고 valid=false 로 표시한다.
+ * 소프트 재시작으로 RTC 시각이 유지된 경우(TIME_VALID_EPOCH 이후)는 첫 동기화 전에도 유효로 본다.
+ */
+
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include "protocol_def.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief SNTP 시작 (esp_netif 초기화 이후 호출, 네트워크 연결 시 동기화)
+ * @return ESP_OK on success
+ */
+esp_err_t time_sync_init(void);
+
+/**
+ * @brief 설정 적용 (서버가 바뀌면 SNTP 재시작)
+ * @param config 설정 (NULL이면 기본값)
+ */
+void time_sync_set_config(const time_config_t *config);
+
+/**
+ * @brief 현재 설정 반환
+ */
+const time_config_t* time_sync_get_config(void);
+
+/**
+ * @brief wall clock 유효 여부 (SNTP 동기화 또는 RTC 유지)
+ */
+bool time_sync_is_valid(void);
+
+/**
+ * @brief 단조 시각 → wall clock (epoch ms)
+ * @param capture_us esp_timer 기준 시각 (us)
+ * @param valid 유효 여부 출력 (NULL 허용)
+ * @return epoch ms
+ */
+int64_t time_sync_wall_ms(int64_t capture_us, bool *valid);
+
+/**
+ * @brief wall clock (epoch ms) → 단조 시각 (esp_timer 기준 us)
+ */
+int64_t time_sync_mono_us(int64_t wall_ms);
+
+/**
+ * @brief 메시지 timestamp (epoch 초, ms 해상도)
+ * @param capture_us esp_timer 기준 시각 (us)
+ * @param valid 유효 여부 출력 (NULL 허용)
+ */
+double time_sync_timestamp(int64_t capture_us, bool *valid);
+
+/**
+ * @brief 현재 시각 timestamp (epoch 초, ms 해상도)
+ */
+double time_sync_now(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIME_SYNC_H
@@ -0,0 +1,183 @@
+/**
+ * @file topic_router.c
+ * @brief Content-based Topic Routing Implementation
+ *
+ * 컴파일 결과: 규칙마다 (값 위치, 비교 연산, 기준값, 토픽 앞/뒤 문자열).
+ * 매칭 시에는 값 하나 읽고 비교 한 번, 토픽은 미리 만든 문자열을 복사한다.
+ */
+
+#include "topic_router.h"
+#include "mqtt_handler.h"
+#include "stats.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "TopicRouter";
+
+#define ROUTE_VALUE_TOKEN       "{v}"
+
+typedef struct {
+    uint8_t source;
+    uint8_t op;
+    uint8_t qos;
+    bool per_value;             // suffix에 {v} 포함
+    uint16_t index;
+    double value;
+    char head[192];             // 전체 토픽 ({v} 앞부분까지)
+    char tail[ROUTE_SUFFIX_MAX_LEN];
+} route_compiled_t;
+
+static route_config_t s_config = {0};
+static route_compiled_t s_compiled[ROUTE_MAX_RULES];
+static uint8_t s_compiled_count = 0;
+static uint8_t s_def_field_count = 0;
+static SemaphoreHandle_t s_mutex = NULL;
+static stats_id_t s_stat_routed = STATS_INVALID_ID;
+
+static void ensure_init(void)
+{
+    if (!s_mutex) {
+        s_mutex = xSemaphoreCreateMutex();
+    }
+    if (s_stat_routed == STATS_INVALID_ID) {
+        s_stat_routed = stats_register("route.matched", STATS_COUNTER);
+    }
+}
+
+// s_mutex 보유 상태에서 호출
+static void compile_rules(void)
+{
+    const mqtt_config_data_t *mqtt = mqtt_handler_get_config();
+    s_compiled_count = 0;
+
+    if (strlen(mqtt->user_id) == 0 || strlen(mqtt->device_id) == 0) {
+        return;
+    }
+
+    for (uint8_t r = 0; r < s_config.rule_count && r < ROUTE_MAX_RULES; r++) {
+        const route_rule_t *rule = &s_config.rules[r];
+        route_compiled_t *c = &s_compiled[s_compiled_count];
+
+        if (rule->source == ROUTE_SOURCE_FIELD && rule->index >= s_def_field_count) {
+            ESP_LOGW(TAG, "Rule %d: field %d not in definition, skipped", r, rule->index);
+            continue;
+        }
+        if (rule->source > ROUTE_SOURCE_RAW_BYTE || rule->op > ROUTE_OP_LE) {
+            ESP_LOGW(TAG, "Rule %d: invalid source/op, skipped", r);
+            continue;
+        }
+
+        char suffix[ROUTE_SUFFIX_MAX_LEN];
+        memcpy(suffix, rule->suffix, sizeof(suffix));
+        suffix[sizeof(suffix) - 1] = '\0';
+        if (suffix[0] == '\0' || strpbrk(suffix, "+#")) {
+            ESP_LOGW(TAG, "Rule %d: invalid suffix, skipped", r);
+            continue;
+        }
+
+        c->source = rule->source;
+        c->op = rule->op;
+        c->qos = (rule->qos > 2) ? DEFAULT_MQTT_QOS : rule->qos;
+        c->index = rule->index;
+        c->value = rule->value;
+        c->tail[0] = '\0';
+
+        char *token = strstr(suffix, ROUTE_VALUE_TOKEN);
+        c->per_value = (token != NULL);
+        if (token) {
+            snprintf(c->tail, sizeof(c->tail), "%s", token + strlen(ROUTE_VALUE_TOKEN));
+            *token = '\0';
+        }
+        mqtt_handler_build_topic(c->head, sizeof(c->head), suffix);
+        s_compiled_count++;
+    }
+
+    ESP_LOGI(TAG, "Compiled %d/%d routing rules", s_compiled_count, s_config.rule_count);
+}
+
+static bool compare(uint8_t op, double v, double ref)
+{
+    switch (op) {
+        case ROUTE_OP_ANY:  return true;
+        case ROUTE_OP_EQ:   return v == ref;
+        case ROUTE_OP_NE:   return v != ref;
+        case ROUTE_OP_GT:   return v > ref;
+        case ROUTE_OP_GE:   return v >= ref;
+        case ROUTE_OP_LT:   return v < ref;
+        case ROUTE_OP_LE:   return v <= ref;
+        default:            return false;
+    }
+}
+
+/*******************************************************************************
+ * Public Functions
+ ******************************************************************************/
+void topic_router_set_config(const route_config_t *config)
+{
+    ensure_init();
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (config) {
+        memcpy(&s_config, config, sizeof(route_config_t));
+        if (s_config.rule_count > ROUTE_MAX_RULES) s_config.rule_count = ROUTE_MAX_RULES;
+    } else {
+        memset(&s_config, 0, sizeof(route_config_t));
+    }
+    compile_rules();
+    xSemaphoreGive(s_mutex);
+}
+
+const route_config_t* topic_router_get_config(void)
+{
+    return &s_config;
+}
+
+void topic_router_set_definition(const data_definition_t *def)
+{
+    if (!def) return;
+
+    ensure_init();
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    s_def_field_count = def->field_count;
+    compile_rules();
+    xSemaphoreGive(s_mutex);
+}
+
+bool topic_router_match(const parsed_field_t *fields, uint8_t field_count,
+                        const uint8_t *raw, size_t raw_len,
+                        char *topic, size_t topic_size, uint8_t *qos)
+{
+    if (s_compiled_count == 0 || !topic || !qos || !s_mutex) return false;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return false;
+
+    bool matched = false;
+    for (uint8_t r = 0; r < s_compiled_count; r++) {
+        const route_compiled_t *c = &s_compiled[r];
+        double v;
+
+        if (c->source == ROUTE_SOURCE_FIELD) {
+            if (!fields || c->index >= field_count) continue;
+            v = fields[c->index].scaled_value;
+        } else {
+            if (!raw || c->index >= raw_len) continue;
+            v = raw[c->index];
+        }
+
+        if (!compare(c->op, v, c->value)) continue;
+
+        if (c->per_value) {
+            snprintf(topic, topic_size, "%s%lld%s", c->head, (long long)v, c->tail);
+        } else {
+            snprintf(topic, topic_size, "%s", c->head);
+        }
+        *qos = c->qos;
+        matched = true;
+        break;
+    }
+    xSemaphoreGive(s_mutex);
+
+    if (matched) stats_inc(s_stat_routed);
+    return matched;
+}
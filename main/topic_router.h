@@ -0,0 +1,58 @@
+/**
+ * @file topic_router.h
+ * @brief Content-based Topic Routing for Data Records
+ *
+ * 규칙 테이블(route_config_t)을 설정/정의 변경 시점에 컴파일해 두고,
+ * 레코드마다 순서대로 직접 비교하여 data 토픽 대신 사용할 토픽과 QoS를 고른다.
+ * 예) 알람 필드 != 0 → .../alarm (QoS 1), raw[0] 슬레이브 주소 → .../slave/{v}
+ */
+
+#ifndef TOPIC_ROUTER_H
+#define TOPIC_ROUTER_H
+
+#include "protocol_def.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 규칙 테이블 적용 (현재 데이터 정의로 즉시 컴파일)
+ * @param config 규칙 (NULL이면 규칙 없음)
+ */
+void topic_router_set_config(const route_config_t *config);
+
+/**
+ * @brief 현재 규칙 테이블 반환
+ */
+const route_config_t* topic_router_get_config(void);
+
+/**
+ * @brief 데이터 정의/MQTT ID 변경 시 규칙 재컴파일
+ *
+ * mqtt_handler_set_data_definition()에서 호출된다.
+ * @param def 데이터 정의
+ */
+void topic_router_set_definition(const data_definition_t *def);
+
+/**
+ * @brief 레코드에 매칭되는 라우팅 규칙 평가
+ * @param fields 파싱된 필드
+ * @param field_count 필드 수
+ * @param raw 원시 프레임
+ * @param raw_len 원시 프레임 길이
+ * @param topic 매칭 시 전체 토픽 출력
+ * @param topic_size topic 버퍼 크기
+ * @param qos 매칭 시 QoS 출력
+ * @return true if a rule matched (false면 기본 data 토픽 사용)
+ */
+bool topic_router_match(const parsed_field_t *fields, uint8_t field_count,
+                        const uint8_t *raw, size_t raw_len,
+                        char *topic, size_t topic_size, uint8_t *qos);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TOPIC_ROUTER_H
@@ -3,11 +3,20 @@
  * @brief UART Data Reception Handler Implementation
  * 
  * 프로토콜별 프레임 검출 및 CRC 검증
+ *
+ * Flow control (RTS/CTS, XON/XOFF):
+ * 하드웨어가 RX FIFO 임계값으로 RTS 해제/XOFF 전송을 처리한다. 파이프라인 backpressure
+ * (uart_handler_set_flow_off)가 걸리면 RX 태스크가 드라이버 ring buffer 읽기를 멈추고,
+ * ring buffer가 차면 드라이버가 FIFO 읽기를 멈춰 FIFO 임계값 → RTS/XOFF로 송신측까지 전파된다.
+ * 해제 시 쌓인 바이트를 이어서 읽으므로 바이트 손실이 없다.
  */
 
 #include "uart_handler.h"
 #include "protocol_def.h"
 #include "crc_utils.h"
+#include "stats.h"
+#include "serial_monitor.h"
+#include "flight_recorder.h"
 #include "driver/uart.h"
 #include "driver/gpio.h"
 #include "esp_intr_alloc.h"
@@ -15,23 +24,39 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include <string.h>
 #include <stdlib.h>
 
 static const char *TAG = "UART";
 
+#define RECEIVING_IDLE_MS       1000    // 이 시간 동안 프레임이 없으면 수신 상태 해제
+#define UART_EVENT_WAKEUP       UART_EVENT_MAX  // stop 시 RX 태스크를 깨우는 내부 이벤트
+#define UART_STOP_RETRY_MS      100     // stop 시 깨우기 재시도 간격
+#define UART_STOP_WARN_MS       500
+#define UART_FLOW_RECHECK_MS    20      // flow-off 대기 중 backlog 재확인 주기
+
 static TaskHandle_t s_task = NULL;
 static QueueHandle_t s_queue = NULL;
 static bool s_running = false;
-static bool s_receiving = false;
-static uint32_t s_rx_count = 0;
-static uint32_t s_error_count = 0;
+static bool s_receiving = false;       // RX 태스크 전용, 외부 공개는 gauge로
+static stats_id_t s_stat_rx = STATS_INVALID_ID;
+static stats_id_t s_stat_errors = STATS_INVALID_ID;
+static stats_id_t s_stat_receiving = STATS_INVALID_ID;
 static uart_frame_cb_t s_callback = NULL;
+static bool s_forward_crc_errors = false;  // raw 정책(on-error)이 요구할 때만 전달
+static uint8_t s_flow_mode = UART_FLOW_NONE;
+static volatile bool s_flow_off = false;    // 파이프라인 backpressure
+static portMUX_TYPE s_flow_lock = portMUX_INITIALIZER_UNLOCKED;
+static uart_flow_check_cb_t s_flow_check = NULL;
+static stats_id_t s_stat_flow_off = STATS_INVALID_ID;
+static stats_id_t s_stat_flow_held = STATS_INVALID_ID;
 
 static protocol_config_data_t s_proto_cfg = {0};
 static uint8_t s_frame_buf[FRAME_BUF_SIZE];
 static size_t s_frame_idx = 0;
 static TickType_t s_last_rx = 0;
+static SemaphoreHandle_t s_exit_sem = NULL;    // RX 태스크 종료 알림
 
 // CRC 검증
 static bool verify_crc(const uint8_t *data, size_t len)
@@ -252,102 +277,236 @@ static void process_frame(const uint8_t *data, size_t len)
     ESP_LOGI(TAG, "Frame received: %d bytes", len);
     ESP_LOG_BUFFER_HEX_LEVEL(TAG, data, len > 32 ? 32 : len, ESP_LOG_DEBUG);
 
-    if (!verify_crc(data, len)) {
+    bool crc_ok = verify_crc(data, len);
+    serial_monitor_on_frame(data, len, crc_ok);
+    flight_recorder_on_frame(len, crc_ok);
+
+    if (!crc_ok) {
         ESP_LOGW(TAG, "CRC error");
-        s_error_count++;
+        stats_inc(s_stat_errors);
+        if (s_forward_crc_errors && s_callback) {
+            s_callback(data, len, false);
+        }
         return;
     }
 
-    s_rx_count++;
-    s_receiving = true;
+    stats_inc(s_stat_rx);
+    if (!s_receiving) {
+        s_receiving = true;
+        stats_set(s_stat_receiving, 1);
+    }
 
     if (s_callback) {
-        s_callback(data, len);
+        s_callback(data, len, true);
+    }
+}
+
+// 미완성 프레임의 타임아웃 (tick)
+static TickType_t frame_timeout_ticks(void)
+{
+    uint16_t timeout = 100;
+
+    if (s_proto_cfg.type == PROTOCOL_CUSTOM) {
+        timeout = s_proto_cfg.config.custom.timeout_ms;
+        if (timeout == 0) timeout = 100;
+    } else if (s_proto_cfg.type == PROTOCOL_MODBUS_RTU) {
+        timeout = s_proto_cfg.config.modbus_rtu.inter_frame_delay;
+        if (timeout == 0) timeout = 10;
+    }
+
+    TickType_t ticks = pdMS_TO_TICKS(timeout);
+    return (ticks > 0) ? ticks : 1;
+}
+
+// 다음 마감(프레임 타임아웃 / 수신 상태 해제)까지 대기 시간
+// 대기할 마감이 없으면 이벤트가 올 때까지 블록
+static TickType_t next_deadline_wait(void)
+{
+    TickType_t now = xTaskGetTickCount();
+    TickType_t elapsed = now - s_last_rx;
+    TickType_t wait = portMAX_DELAY;
+
+    if (s_frame_idx > 0) {
+        TickType_t timeout = frame_timeout_ticks();
+        wait = (elapsed >= timeout) ? 0 : timeout - elapsed;
+    }
+
+    if (s_receiving) {
+        TickType_t idle = pdMS_TO_TICKS(RECEIVING_IDLE_MS);
+        TickType_t idle_wait = (elapsed >= idle) ? 0 : idle - elapsed;
+        if (idle_wait < wait) wait = idle_wait;
     }
+
+    return wait;
+}
+
+// 마감이 지난 타임아웃 처리
+static void check_deadlines(void)
+{
+    TickType_t elapsed = xTaskGetTickCount() - s_last_rx;
+
+    // 프레임 타임아웃 - ETX/길이 필드 없이 끝난 프레임
+    if (s_frame_idx > 0 && elapsed >= frame_timeout_ticks()) {
+        if (s_frame_idx >= 3) {
+            process_frame(s_frame_buf, s_frame_idx);
+        } else {
+            serial_monitor_on_event(MONITOR_EVT_DISCARDED);
+            flight_recorder_on_event(MONITOR_EVT_DISCARDED);
+        }
+        s_frame_idx = 0;
+    }
+
+    // 수신 상태 리셋
+    if (s_receiving && elapsed >= pdMS_TO_TICKS(RECEIVING_IDLE_MS)) {
+        s_receiving = false;
+        stats_set(s_stat_receiving, 0);
+    }
+}
+
+// 드라이버 ring buffer에서 최대 want 바이트를 읽어 프레임 검출에 넣음
+static int read_bytes(size_t want)
+{
+    uint8_t rx_buf[128];
+
+    if (want > sizeof(rx_buf)) want = sizeof(rx_buf);
+    int len = uart_read_bytes(UART_PORT_NUM, rx_buf, want, pdMS_TO_TICKS(100));
+    if (len > 0) {
+        s_last_rx = xTaskGetTickCount();
+        serial_monitor_on_rx(rx_buf, len);
+        flight_recorder_on_rx(rx_buf, len);
+
+        for (int i = 0; i < len && s_frame_idx < FRAME_BUF_SIZE; i++) {
+            s_frame_buf[s_frame_idx++] = rx_buf[i];
+        }
+
+        if (is_frame_complete(s_frame_buf, s_frame_idx)) {
+            process_frame(s_frame_buf, s_frame_idx);
+            s_frame_idx = 0;
+        }
+    }
+    return len;
+}
+
+// ring buffer에 쌓인 바이트를 모두 읽음 (flow-off가 다시 걸리면 중단)
+static void drain_buffered(void)
+{
+    size_t buffered = 0;
+    while (s_running && !s_flow_off &&
+           uart_get_buffered_data_len(UART_PORT_NUM, &buffered) == ESP_OK && buffered > 0) {
+        if (read_bytes(buffered) <= 0) break;
+    }
+}
+
+// flow-off 동안 읽기 중지 → 해제 알림까지 대기 후 쌓인 바이트 처리
+static void hold_for_flow_on(void)
+{
+    ESP_LOGD(TAG, "Flow off");
+    stats_set(s_stat_flow_held, 1);
+
+    // 해제 알림은 flow-off 설정 전에 도착하면 사라지므로 (워커가 먼저 큐를 비운 경우)
+    // 알림만 기다리지 않고 실제 backlog를 주기적으로 확인
+    while (s_running && s_flow_off) {
+        if (s_flow_check && s_flow_check()) {
+            portENTER_CRITICAL(&s_flow_lock);
+            s_flow_off = false;
+            portEXIT_CRITICAL(&s_flow_lock);
+            break;
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(UART_FLOW_RECHECK_MS));
+    }
+
+    stats_set(s_stat_flow_held, 0);
+    if (!s_running) return;
+
+    // 대기 중 쌓인 UART_DATA/BUFFER_FULL 이벤트는 ring buffer 내용으로 대체
+    // 미완성 프레임 타임아웃은 읽기를 재개한 시점부터 계산 (대기 시간은 회선 간격이 아님)
+    xQueueReset(s_queue);
+    s_last_rx = xTaskGetTickCount();
+    drain_buffered();
+    ESP_LOGD(TAG, "Flow on");
 }
 
 // UART 수신 태스크
+// 고정 주기 polling 대신 다음 마감 시각까지만 블록하므로
+// 타임아웃 종료 프레임이 설정된 timeout_ms에 맞춰 전달된다.
 static void uart_rx_task(void *arg)
 {
     uart_event_t event;
-    uint8_t rx_buf[128];
 
     ESP_LOGI(TAG, "RX task started");
 
     while (s_running) {
-        if (xQueueReceive(s_queue, &event, pdMS_TO_TICKS(100))) {
+        if (s_flow_off && s_flow_mode != UART_FLOW_NONE) {
+            hold_for_flow_on();
+            continue;
+        }
+
+        if (xQueueReceive(s_queue, &event, next_deadline_wait())) {
             switch (event.type) {
-                case UART_DATA: {
-                    int len = uart_read_bytes(UART_PORT_NUM, rx_buf,
-                                              event.size, pdMS_TO_TICKS(100));
-                    if (len > 0) {
-                        s_last_rx = xTaskGetTickCount();
-                        
-                        for (int i = 0; i < len && s_frame_idx < FRAME_BUF_SIZE; i++) {
-                            s_frame_buf[s_frame_idx++] = rx_buf[i];
-                        }
-
-                        if (is_frame_complete(s_frame_buf, s_frame_idx)) {
-                            process_frame(s_frame_buf, s_frame_idx);
-                            s_frame_idx = 0;
-                        }
-                    }
+                case UART_DATA:
+                    read_bytes(event.size);
                     break;
-                }
 
-                case UART_FIFO_OVF:
                 case UART_BUFFER_FULL:
+                    if (s_flow_mode != UART_FLOW_NONE) {
+                        // 드라이버가 FIFO 읽기를 멈춤 → 송신측은 RTS/XOFF로 대기 중, 손실 없음
+                        drain_buffered();
+                        break;
+                    }
+                    // fall through
+                case UART_FIFO_OVF: {
                     ESP_LOGW(TAG, "Buffer overflow");
+                    monitor_event_t evt = (event.type == UART_FIFO_OVF) ?
+                                          MONITOR_EVT_FIFO_OVF : MONITOR_EVT_BUFFER_FULL;
+                    serial_monitor_on_event(evt);
+                    flight_recorder_on_event(evt);
                     uart_flush_input(UART_PORT_NUM);
                     xQueueReset(s_queue);
                     s_frame_idx = 0;
-                    s_error_count++;
+                    stats_inc(s_stat_errors);
                     break;
+                }
 
                 case UART_PARITY_ERR:
-                case UART_FRAME_ERR:
+                case UART_FRAME_ERR: {
                     ESP_LOGW(TAG, "UART error");
-                    s_error_count++;
-                    break;
-
-                default:
+                    monitor_event_t evt = (event.type == UART_PARITY_ERR) ?
+                                          MONITOR_EVT_PARITY_ERR : MONITOR_EVT_FRAME_ERR;
+                    serial_monitor_on_event(evt);
+                    flight_recorder_on_event(evt);
+                    stats_inc(s_stat_errors);
                     break;
-            }
-        } else {
-            // 타임아웃 - 프레임 타임아웃 체크
-            if (s_frame_idx > 0) {
-                TickType_t now = xTaskGetTickCount();
-                uint16_t timeout = 100;
-
-                if (s_proto_cfg.type == PROTOCOL_CUSTOM) {
-                    timeout = s_proto_cfg.config.custom.timeout_ms;
-                    if (timeout == 0) timeout = 100;
-                } else if (s_proto_cfg.type == PROTOCOL_MODBUS_RTU) {
-                    timeout = s_proto_cfg.config.modbus_rtu.inter_frame_delay;
-                    if (timeout == 0) timeout = 10;
                 }
 
-                if ((now - s_last_rx) >= pdMS_TO_TICKS(timeout)) {
-                    if (s_frame_idx >= 3) {
-                        process_frame(s_frame_buf, s_frame_idx);
-                    }
-                    s_frame_idx = 0;
-                }
-            }
+                case UART_EVENT_WAKEUP:
+                    // uart_handler_stop() - 루프 조건에서 종료
+                    break;
 
-            // 수신 상태 리셋
-            if (s_receiving && (xTaskGetTickCount() - s_last_rx) > pdMS_TO_TICKS(1000)) {
-                s_receiving = false;
+                default:
+                    break;
             }
         }
+
+        check_deadlines();
     }
 
     ESP_LOGI(TAG, "RX task stopped");
+    xSemaphoreGive(s_exit_sem);
     vTaskDelete(NULL);
 }
 
 esp_err_t uart_handler_init(void)
 {
+    if (!s_exit_sem) {
+        s_exit_sem = xSemaphoreCreateBinary();
+        if (!s_exit_sem) return ESP_ERR_NO_MEM;
+    }
+
+    s_stat_rx = stats_register("uart.rx_frames", STATS_COUNTER);
+    s_stat_errors = stats_register("uart.errors", STATS_COUNTER);
+    s_stat_receiving = stats_register("uart.receiving", STATS_GAUGE);
+    s_stat_flow_off = stats_register("uart.flow_off", STATS_COUNTER);
+    s_stat_flow_held = stats_register("uart.flow_held", STATS_GAUGE);
     ESP_LOGI(TAG, "Initialized");
     return ESP_OK;
 }
@@ -370,6 +529,7 @@ esp_err_t uart_handler_start(const uart_config_data_t *uart_cfg,
         .parity = UART_PARITY_DISABLE,
         .stop_bits = (uart_cfg->stop_bits == 2) ? UART_STOP_BITS_2 : UART_STOP_BITS_1,
         .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .rx_flow_ctrl_thresh = UART_RTS_FIFO_THRESH,
         .source_clk = UART_SCLK_DEFAULT,
     };
 
@@ -378,9 +538,21 @@ esp_err_t uart_handler_start(const uart_config_data_t *uart_cfg,
         case 2: cfg.parity = UART_PARITY_EVEN; break;
     }
 
-    ESP_LOGI(TAG, "Config: %lu-%d-%d-%d",
+    s_flow_mode = uart_cfg->flow_control;
+    if (s_flow_mode == UART_FLOW_RTS_CTS) {
+        if (UART_RTS_PIN < 0 || UART_CTS_PIN < 0) {
+            ESP_LOGW(TAG, "RTS/CTS pins not assigned, flow control disabled");
+            s_flow_mode = UART_FLOW_NONE;
+        } else {
+            cfg.flow_ctrl = UART_HW_FLOWCTRL_CTS_RTS;
+        }
+    } else if (s_flow_mode != UART_FLOW_XON_XOFF) {
+        s_flow_mode = UART_FLOW_NONE;
+    }
+
+    ESP_LOGI(TAG, "Config: %lu-%d-%d-%d, flow=%d",
              (unsigned long)uart_cfg->baudrate,
-             uart_cfg->data_bits, uart_cfg->parity, uart_cfg->stop_bits);
+             uart_cfg->data_bits, uart_cfg->parity, uart_cfg->stop_bits, s_flow_mode);
 
     // Install UART driver
     esp_err_t ret = uart_driver_install(UART_PORT_NUM, UART_BUF_SIZE * 2,
@@ -391,13 +563,24 @@ esp_err_t uart_handler_start(const uart_config_data_t *uart_cfg,
     }
 
     uart_param_config(UART_PORT_NUM, &cfg);
-    uart_set_pin(UART_PORT_NUM, UART_TX_PIN, UART_RX_PIN,
-                 UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    if (s_flow_mode == UART_FLOW_RTS_CTS) {
+        uart_set_pin(UART_PORT_NUM, UART_TX_PIN, UART_RX_PIN, UART_RTS_PIN, UART_CTS_PIN);
+    } else {
+        uart_set_pin(UART_PORT_NUM, UART_TX_PIN, UART_RX_PIN,
+                     UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    }
+    if (s_flow_mode == UART_FLOW_XON_XOFF) {
+        uart_set_sw_flow_ctrl(UART_PORT_NUM, true, UART_XON_FIFO_THRESH, UART_XOFF_FIFO_THRESH);
+    }
 
-    s_rx_count = 0;
-    s_error_count = 0;
+    stats_reset(s_stat_rx);
+    stats_reset(s_stat_errors);
     s_frame_idx = 0;
     s_receiving = false;
+    stats_set(s_stat_receiving, 0);
+    s_flow_off = false;
+    stats_set(s_stat_flow_held, 0);
+    xSemaphoreTake(s_exit_sem, 0);     // 이전 태스크의 늦은 종료 알림이 남아 있으면 비움
     s_running = true;
 
     xTaskCreate(uart_rx_task, "uart_rx", TASK_STACK_UART,
@@ -414,7 +597,19 @@ void uart_handler_stop(void)
         s_running = false;
 
         if (s_task) {
-            vTaskDelay(pdMS_TO_TICKS(200));
+            // RX 태스크는 마감이 없으면 무기한 블록하므로 직접 깨운 뒤 종료 대기
+            // 종료가 확인될 때까지 드라이버를 지우지 않는다 (이벤트 큐가 가득 차 깨우기가
+            // 실패할 수 있으므로 반복, RX 태스크의 블록 지점은 모두 깨우기 가능하거나 시간 제한 있음)
+            uart_event_t wakeup = { .type = UART_EVENT_WAKEUP };
+            int waited_ms = 0;
+            do {
+                xQueueSend(s_queue, &wakeup, 0);
+                xTaskNotifyGive(s_task);    // flow-off 대기 중인 경우
+                if (waited_ms == UART_STOP_WARN_MS) {
+                    ESP_LOGW(TAG, "RX task slow to exit, still waiting");
+                }
+                waited_ms += UART_STOP_RETRY_MS;
+            } while (xSemaphoreTake(s_exit_sem, pdMS_TO_TICKS(UART_STOP_RETRY_MS)) != pdTRUE);
             s_task = NULL;
         }
 
@@ -426,17 +621,17 @@ void uart_handler_stop(void)
 
 bool uart_handler_is_receiving(void)
 {
-    return s_receiving;
+    return stats_get(s_stat_receiving) != 0;
 }
 
 uint32_t uart_handler_get_rx_count(void)
 {
-    return s_rx_count;
+    return stats_get(s_stat_rx);
 }
 
 uint32_t uart_handler_get_error_count(void)
 {
-    return s_error_count;
+    return stats_get(s_stat_errors);
 }
 
 void uart_handler_set_callback(uart_frame_cb_t cb)
@@ -444,6 +639,37 @@ void uart_handler_set_callback(uart_frame_cb_t cb)
     s_callback = cb;
 }
 
+void uart_handler_set_forward_crc_errors(bool enable)
+{
+    s_forward_crc_errors = enable;
+}
+
+void uart_handler_set_flow_off(bool off)
+{
+    portENTER_CRITICAL(&s_flow_lock);
+    bool changed = (s_flow_off != off);
+    s_flow_off = off;
+    portEXIT_CRITICAL(&s_flow_lock);
+
+    if (!changed || s_flow_mode == UART_FLOW_NONE) return;
+
+    if (off) {
+        stats_inc(s_stat_flow_off);
+    } else if (s_task) {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+void uart_handler_set_flow_check(uart_flow_check_cb_t cb)
+{
+    s_flow_check = cb;
+}
+
+bool uart_handler_flow_control_enabled(void)
+{
+    return s_flow_mode != UART_FLOW_NONE;
+}
+
 esp_err_t uart_handler_update_protocol(const protocol_config_data_t *cfg)
 {
     if (!cfg) return ESP_ERR_INVALID_ARG;
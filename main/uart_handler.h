@@ -13,7 +13,16 @@
 extern "C" {
 #endif
 
-typedef void (*uart_frame_cb_t)(const uint8_t *data, size_t length);
+/**
+ * @brief 프레임 수신 콜백
+ * @param crc_valid CRC 검증 결과 (false는 forward_crc_errors 설정 시에만 전달)
+ */
+typedef void (*uart_frame_cb_t)(const uint8_t *data, size_t length, bool crc_valid);
+
+/**
+ * @brief flow-off 해제 조건 확인 콜백 (파이프라인이 다시 받을 수 있으면 true)
+ */
+typedef bool (*uart_flow_check_cb_t)(void);
 
 /**
  * @brief UART 초기화
@@ -51,6 +60,35 @@ uint32_t uart_handler_get_error_count(void);
  */
 void uart_handler_set_callback(uart_frame_cb_t cb);
 
+/**
+ * @brief CRC 실패 프레임도 콜백으로 전달할지 설정 (기본: 버림)
+ */
+void uart_handler_set_forward_crc_errors(bool enable);
+
+/**
+ * @brief 파이프라인 backpressure에 따른 flow-off/on
+ *
+ * flow control 사용 시 flow-off 동안 수신 바이트 읽기를 멈춰 드라이버 버퍼와
+ * RX FIFO를 채우고, 하드웨어가 RTS 해제/XOFF로 송신측을 멈추게 한다.
+ * flow control 미사용 시에는 상태만 기록한다 (기존처럼 큐 가득 참 시 프레임 폐기).
+ * 히스테리시스는 호출자가 정한다 (high/low watermark).
+ * @param off true = 수신 중지 요청, false = 재개
+ */
+void uart_handler_set_flow_off(bool off);
+
+/**
+ * @brief flow-off 대기 중 해제 조건을 직접 확인하는 콜백 설정
+ *
+ * 호출자의 flow-on 알림이 flow-off 설정과 엇갈려 사라져도 RX 태스크가 주기적으로
+ * 실제 backlog를 확인해 스스로 해제한다 (수신이 영구히 멈추지 않음).
+ */
+void uart_handler_set_flow_check(uart_flow_check_cb_t cb);
+
+/**
+ * @brief flow control (RTS/CTS 또는 XON/XOFF) 사용 여부
+ */
+bool uart_handler_flow_control_enabled(void);
+
 /**
  * @brief 프로토콜 설정 업데이트
  */
@@ -30,6 +30,7 @@ static const char *TAG = "WiFi";
 #define BACKOFF_MAX_MS          30000   // 최대 30초
 #define BACKOFF_MULTIPLIER      2       // 2배씩 증가
 #define INITIAL_CONNECT_MAX_RETRY  5    // 초기 연결 시 최대 재시도 (connect() 호출 시)
+#define INITIAL_RETRY_DELAY_MS  1000
 
 static EventGroupHandle_t s_wifi_event_group = NULL;
 static esp_netif_t *s_netif = NULL;
@@ -39,10 +40,7 @@ static bool s_initial_connecting = false;  // connect() 호출 중인지 여부
 static int s_retry_count = 0;
 static uint32_t s_backoff_ms = BACKOFF_INITIAL_MS;
 static wifi_event_cb_t s_callback = NULL;
-static TimerHandle_t s_reconnect_timer = NULL;
-
-// Forward declaration
-static void reconnect_timer_callback(TimerHandle_t timer);
+static TimerHandle_t s_reconnect_timer = NULL;  // 단발, FreeRTOS 타이머 서비스에서 실행
 
 /*******************************************************************************
  * Reconnect Timer (지수 백오프)
@@ -53,29 +51,24 @@ static void reconnect_timer_callback(TimerHandle_t timer)
     esp_wifi_connect();
 }
 
+static void start_reconnect_timer(uint32_t delay_ms)
+{
+    if (!s_reconnect_timer) return;
+    // 단발 타이머: 주기 변경이 곧 (재)시작
+    xTimerChangePeriod(s_reconnect_timer, pdMS_TO_TICKS(delay_ms), 0);
+}
+
 static void schedule_reconnect(void)
 {
-    if (!s_reconnect_timer) {
-        s_reconnect_timer = xTimerCreate("wifi_reconnect", 
-                                          pdMS_TO_TICKS(s_backoff_ms),
-                                          pdFALSE,  // one-shot
-                                          NULL,
-                                          reconnect_timer_callback);
-    }
-    
-    if (s_reconnect_timer) {
-        // Update timer period to current backoff
-        xTimerChangePeriod(s_reconnect_timer, pdMS_TO_TICKS(s_backoff_ms), 0);
-        xTimerStart(s_reconnect_timer, 0);
-        
-        ESP_LOGW(TAG, "Reconnect scheduled in %lu ms (attempt %d)", 
-                 (unsigned long)s_backoff_ms, s_retry_count);
-        
-        // Exponential backoff: double the interval, capped at max
-        s_backoff_ms *= BACKOFF_MULTIPLIER;
-        if (s_backoff_ms > BACKOFF_MAX_MS) {
-            s_backoff_ms = BACKOFF_MAX_MS;
-        }
+    start_reconnect_timer(s_backoff_ms);
+
+    ESP_LOGW(TAG, "Reconnect scheduled in %lu ms (attempt %d)", 
+             (unsigned long)s_backoff_ms, s_retry_count);
+
+    // Exponential backoff: double the interval, capped at max
+    s_backoff_ms *= BACKOFF_MULTIPLIER;
+    if (s_backoff_ms > BACKOFF_MAX_MS) {
+        s_backoff_ms = BACKOFF_MAX_MS;
     }
 }
 
@@ -85,9 +78,7 @@ static void reset_backoff(void)
     s_retry_count = 0;
     
     // Stop any pending reconnect timer
-    if (s_reconnect_timer) {
-        xTimerStop(s_reconnect_timer, 0);
-    }
+    if (s_reconnect_timer) xTimerStop(s_reconnect_timer, 0);
 }
 
 /*******************************************************************************
@@ -115,8 +106,8 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
                 if (s_initial_connecting) {
                     // 초기 연결 시: 제한된 재시도 후 포기 (connect() 블로킹 해제)
                     if (s_retry_count < INITIAL_CONNECT_MAX_RETRY) {
-                        vTaskDelay(pdMS_TO_TICKS(1000));
-                        esp_wifi_connect();
+                        // 이벤트 루프를 막지 않도록 지연 재시도는 타이머로
+                        start_reconnect_timer(INITIAL_RETRY_DELAY_MS);
                     } else {
                         ESP_LOGE(TAG, "Initial connection failed after %d attempts", 
                                  INITIAL_CONNECT_MAX_RETRY);
@@ -165,6 +156,13 @@ esp_err_t wifi_manager_init(void)
 
     ESP_LOGI(TAG, "Initializing (v3.0 - exponential backoff)...");
 
+    s_reconnect_timer = xTimerCreate("wifi_reconnect", pdMS_TO_TICKS(BACKOFF_INITIAL_MS),
+                                     pdFALSE, NULL, reconnect_timer_callback);
+    if (!s_reconnect_timer) {
+        ESP_LOGE(TAG, "Failed to create reconnect timer");
+        return ESP_ERR_NO_MEM;
+    }
+
     s_wifi_event_group = xEventGroupCreate();
     if (!s_wifi_event_group) {
         ESP_LOGE(TAG, "Failed to create event group");